@@ -0,0 +1,236 @@
+//
+//  ccarchive: C++ class for appending files to compressed archives.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "ccarchive.hpp"
+using namespace std;
+
+namespace ccuty {
+
+static const size_t TarBlock = 512;
+
+static bool writeAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if (n < 0) {if (errno == EINTR) continue; return false;}
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// compresses data in a gzip member.
+
+class GzipMember {
+public:
+  GzipMember() {
+    ok_ = ::deflateInit2(&z_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  ~GzipMember() {if (ok_) ::deflateEnd(&z_);}
+
+  /// compressed data (the end of the member is added by finish()).
+  const string& data() const {return out_;}
+
+  bool write(const char* data, size_t len) {
+    // avail_in is an unsigned int
+    for (size_t pos = 0; pos < len; pos += 1<<20) {
+      if (!deflate(data + pos, min<size_t>(len - pos, 1<<20), Z_NO_FLUSH)) return false;
+    }
+    return true;
+  }
+
+  bool finish() {return deflate(nullptr, 0, Z_FINISH);}
+
+private:
+  bool deflate(const char* data, size_t len, int flush) {
+    if (!ok_) return false;
+    z_.next_in = (Bytef*)data;
+    z_.avail_in = uInt(len);
+    char buf[64*1024];
+    int rc;
+    do {
+      z_.next_out = (Bytef*)buf;
+      z_.avail_out = sizeof(buf);
+      if ((rc = ::deflate(&z_, flush)) == Z_STREAM_ERROR) return false;
+      out_.append(buf, sizeof(buf) - z_.avail_out);
+    } while (z_.avail_out == 0);
+    return flush != Z_FINISH || rc == Z_STREAM_END;
+  }
+
+  z_stream z_{};
+  string out_;
+  bool ok_{false};
+};
+
+// end of the tar archive (two empty blocks) in a gzip member.
+static const string& endMember() {
+  static string member = [] {
+    GzipMember gz;
+    char zeros[2*TarBlock] = {};
+    gz.write(zeros, sizeof(zeros));
+    gz.finish();
+    return gz.data();
+  }();
+  return member;
+}
+
+static void octal(char* field, size_t len, uint64_t value) {  // len includes the final 0
+  field[len-1] = 0;
+  for (size_t k = len-1; k > 0; --k) {
+    field[k-1] = char('0' + (value & 7));
+    value >>= 3;
+  }
+}
+
+// ustar header of a regular file.
+static void tarHeader(char* h, const string& name, uint64_t size, time_t mtime) {
+  ::memset(h, 0, TarBlock);
+  ::strncpy(h, name.c_str(), 99);
+  octal(h+100, 8, 0644);     // mode
+  octal(h+108, 8, 0);        // uid
+  octal(h+116, 8, 0);        // gid
+  octal(h+124, 12, size);
+  octal(h+136, 12, uint64_t(mtime));
+  h[156] = '0';              // regular file
+  ::memcpy(h+257, "ustar", 6);
+  ::memcpy(h+263, "00", 2);
+  ::memset(h+148, ' ', 8);   // the checksum is computed with spaces in its field
+  unsigned int sum = 0;
+  for (size_t k = 0; k < TarBlock; ++k) sum += (unsigned char)h[k];
+  octal(h+148, 7, sum);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+TarArchive::TarArchive(const string& path) :
+path_(path), indexPath_(path + ".idx") {
+  ifstream index(indexPath_);
+  Entry e;
+  while (index >> e.offset >> e.csize >> e.size && index.get() == ' ' && getline(index, e.name)) {
+    entries_.push_back(e);
+  }
+
+  struct stat st;
+  if (::stat(path_.c_str(), &st) < 0 || st.st_size == 0) {
+    entries_.clear();    // the index (if any) is obsolete
+    return;
+  }
+
+  // the archive must end with endMember() just after the last indexed member
+  uint64_t end = entries_.empty() ? 0 : entries_.back().offset + entries_.back().csize;
+  auto& member = endMember();
+  appendable_ = false;
+  if (uint64_t(st.st_size) != end + member.size()) return;
+  int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  string tail(member.size(), 0);
+  appendable_ = ::pread(fd, &tail[0], tail.size(), off_t(end)) == ssize_t(tail.size()) && tail == member;
+  ::close(fd);
+}
+
+bool TarArchive::append(const string& file, const string& name) {
+  int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  bool ok = appendMember(fd, name, nullptr);
+  ::close(fd);
+  return ok;
+}
+
+bool TarArchive::appendData(const string& data, const string& name) {
+  return appendMember(-1, name, &data);
+}
+
+bool TarArchive::appendMember(int in, const string& name, const string* data) {
+  if (!appendable_) return false;
+
+  // compresses the file (the archive is not modified if this fails)
+  struct stat st;
+  uint64_t size = data ? data->size() : 0;
+  time_t mtime = ::time(nullptr);
+  if (in >= 0) {
+    if (::fstat(in, &st) < 0) return false;
+    size = uint64_t(st.st_size);
+    mtime = st.st_mtime;
+  }
+  GzipMember gz;
+  char block[64*1024];
+  tarHeader(block, name, size, mtime);
+  if (!gz.write(block, TarBlock)) return false;
+  if (data) {
+    if (!gz.write(data->data(), data->size())) return false;
+  }
+  else {
+    for (uint64_t remaining = size; remaining > 0; ) {
+      ssize_t n = ::read(in, block, size_t(min<uint64_t>(remaining, sizeof(block))));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;   // the file was truncated
+      if (!gz.write(block, size_t(n))) return false;
+      remaining -= uint64_t(n);
+    }
+  }
+  ::memset(block, 0, TarBlock);
+  if ((size % TarBlock != 0 && !gz.write(block, TarBlock - size % TarBlock)) || !gz.finish())
+    return false;
+
+  // replaces the end of the archive by the new member and a new end
+  uint64_t end = entries_.empty() ? 0 : entries_.back().offset + entries_.back().csize;
+  int out = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (out < 0) return false;
+  bool ok = ::ftruncate(out, off_t(end)) == 0 && ::lseek(out, off_t(end), SEEK_SET) >= 0
+  && writeAll(out, gz.data().data(), gz.data().size())
+  && writeAll(out, endMember().data(), endMember().size());
+  ok = (::close(out) == 0) && ok;
+
+  Entry e;
+  e.name = name;
+  e.offset = end;
+  e.csize = gz.data().size();
+  e.size = size;
+  string line = to_string(e.offset) + ' ' + to_string(e.csize) + ' ' + to_string(e.size) + ' ' + name + '\n';
+  int idx = ok ? ::open(indexPath_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (end ? O_APPEND : O_TRUNC), 0644) : -1;
+  ok = idx >= 0 && writeAll(idx, line.data(), line.size());
+  if (idx >= 0) ok = (::close(idx) == 0) && ok;
+
+  if (ok) entries_.push_back(e);
+  else appendable_ = false;   // the archive and the index may not match anymore
+  return ok;
+}
+
+bool TarArchive::extract(const string& name, string& data) const {
+  for (auto e = entries_.rbegin(); e != entries_.rend(); ++e) {
+    if (e->name != name) continue;
+    int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    string member(size_t(e->csize), 0);
+    bool ok = ::pread(fd, &member[0], member.size(), off_t(e->offset)) == ssize_t(member.size());
+    ::close(fd);
+    if (!ok) return false;
+
+    z_stream z{};
+    if (::inflateInit2(&z, 15+16) != Z_OK) return false;
+    data.assign(size_t(TarBlock + e->size), 0);
+    z.next_in = (Bytef*)&member[0];
+    z.avail_in = uInt(member.size());
+    z.next_out = (Bytef*)&data[0];
+    z.avail_out = uInt(data.size());
+    int rc = ::inflate(&z, Z_SYNC_FLUSH);
+    ok = (rc == Z_OK || rc == Z_STREAM_END) && z.avail_out == 0;
+    ::inflateEnd(&z);
+    data.erase(0, TarBlock);    // the tar header
+    return ok;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,71 @@
+//
+//  ccarchive: C++ class for appending files to compressed archives.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for appending files to compressed archives.
+ *  - TarArchive: .tar.gz archive to which files can be appended without recompressing it.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccarchive
+#define ccuty_ccarchive
+/// @file.
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief .tar.gz archive to which files can be appended.
+   * Each file is compressed in its own gzip member and the end of the tar archive
+   * (two empty blocks) in a last member. Appending a file replaces this last member,
+   * so that its cost only depends on the size of the file (the archive is neither
+   * decompressed nor recompressed). As concatenated gzip members are a valid gzip
+   * stream, the archive can be read by tar, gunzip, etc.
+   *
+   * The position of the members is stored in an index file (the path of the archive
+   * followed by ".idx"), so that files can be extracted without decompressing the
+   * whole archive. Archives that were not created by this class, or whose index
+   * does not match, can't be appended to (see isAppendable()).
+   */
+  class TarArchive {
+  public:
+    /// member of the archive.
+    struct Entry {
+      std::string name;
+      uint64_t offset{}, csize{}, size{};  ///< position and compressed size in the archive, file size.
+    };
+
+    /// opens the archive (it is created when the first file is appended).
+    TarArchive(const std::string& path);
+
+    /// true if files can be appended to this archive (or if it does not exist).
+    bool isAppendable() const {return appendable_;}
+
+    /// files in the archive.
+    const std::vector<Entry>& entries() const {return entries_;}
+
+    /// appends the content of _file_ with this _name_, returns false on error.
+    bool append(const std::string& file, const std::string& name);
+
+    /// appends _data_ as a file with this _name_, returns false on error.
+    bool appendData(const std::string& data, const std::string& name);
+
+    /// retrieves the content of the last file with this _name_, returns false if not found.
+    bool extract(const std::string& name, std::string& data) const;
+
+  private:
+    bool appendMember(int fd, const std::string& name, const std::string* data);
+    std::string path_, indexPath_;
+    std::vector<Entry> entries_;
+    bool appendable_{true};
+  };
+
+}
+
+#endif
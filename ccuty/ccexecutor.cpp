@@ -0,0 +1,100 @@
+//
+//  ccexecutor: C++ class for executing tasks in a pool of threads.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <algorithm>
+#include "ccexecutor.hpp"
+using namespace std;
+
+namespace ccuty {
+
+Executor::Executor(unsigned int workers, size_t capacity) :
+nworkers_(max(workers, 1u)), capacity_(capacity) {}
+
+Executor::~Executor() {
+  cancelAll();
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  for (auto& w : workers_) w.join();
+}
+
+unsigned long Executor::submit(Task task, int lane, Done done) {
+  unsigned long id;
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (stopped_ || jobs_.size() >= capacity_) return 0;
+    if (workers_.empty()) {
+      for (unsigned int k = 0; k < nworkers_; ++k) workers_.emplace_back(&Executor::work, this);
+    }
+    id = ++lastid_;
+    jobs_.push_back(Job{id, lane, std::move(task), std::move(done)});
+  }
+  cond_.notify_one();
+  return id;
+}
+
+bool Executor::cancel(unsigned long id) {
+  Done done;
+  {
+    lock_guard<mutex> lock(mutex_);
+    auto it = find_if(jobs_.begin(), jobs_.end(), [id](const Job& j) {return j.id == id;});
+    if (it == jobs_.end()) return false;
+    done = std::move(it->done);
+    jobs_.erase(it);
+  }
+  if (done) done(false);
+  return true;
+}
+
+void Executor::cancelAll() {
+  deque<Job> jobs;
+  {
+    lock_guard<mutex> lock(mutex_);
+    jobs.swap(jobs_);
+  }
+  for (auto& j : jobs) if (j.done) j.done(false);
+}
+
+size_t Executor::pending() const {
+  lock_guard<mutex> lock(mutex_);
+  return jobs_.size();
+}
+
+void Executor::work() {
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    // the first task whose lane is not busy (so that the tasks of a lane stay in order)
+    auto job = jobs_.end();
+    cond_.wait(lock, [this, &job] {
+      job = find_if(jobs_.begin(), jobs_.end(), [this](const Job& j) {
+        return j.lane == AnyLane || busy_.count(j.lane) == 0;
+      });
+      return stopped_ || job != jobs_.end();
+    });
+    if (stopped_) return;
+
+    Job j = std::move(*job);
+    jobs_.erase(job);
+    if (j.lane != AnyLane) busy_.insert(j.lane);
+    lock.unlock();
+
+    bool completed = true;
+    try {j.task();}
+    catch (...) {completed = false;}
+    if (j.done) j.done(completed);
+    j.task = nullptr;   // releases what the task holds without locking
+    j.done = nullptr;
+
+    lock.lock();
+    if (j.lane != AnyLane) {
+      busy_.erase(j.lane);
+      cond_.notify_all();   // a task of this lane may be waiting
+    }
+  }
+}
+
+}
@@ -0,0 +1,88 @@
+//
+//  ccexecutor: C++ class for executing tasks in a pool of threads.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for executing tasks in a pool of threads.
+ *  - Executor: bounded queue of tasks executed by worker threads, in order if needed.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccexecutor
+#define ccuty_ccexecutor
+/// @file.
+
+#include <deque>
+#include <vector>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Bounded queue of tasks executed by a pool of worker threads.
+   * Tasks are started in the order they were submitted. Tasks submitted with the
+   * same _lane_ are executed one after the other (e.g. for tasks whose effects must
+   * occur in order), tasks submitted with AnyLane may be executed simultaneously
+   * by different workers. The workers are started when the first task is submitted.
+   */
+  class Executor {
+  public:
+    using Task = std::function<void()>;
+
+    /// called when a task was executed (_completed_ is true) or cancelled or threw
+    /// an exception (_completed_ is false).
+    using Done = std::function<void(bool completed)>;
+
+    static const int AnyLane = -1;
+
+    /// _workers_ threads, at most _capacity_ tasks waiting to be executed.
+    Executor(unsigned int workers, size_t capacity);
+
+    /// cancels the waiting tasks and waits for the tasks being executed.
+    ~Executor();
+
+    /// adds a task, returns its id, or 0 if the queue is full.
+    /// _done_ is called by the worker thread, or by the thread that cancels the task.
+    unsigned long submit(Task task, int lane = AnyLane, Done done = nullptr);
+
+    /// cancels this task if it is not yet started, returns false otherwise.
+    bool cancel(unsigned long id);
+
+    /// cancels all the tasks that are not yet started.
+    void cancelAll();
+
+    /// number of tasks waiting to be executed.
+    size_t pending() const;
+
+  private:
+    struct Job {
+      unsigned long id;
+      int lane;
+      Task task;
+      Done done;
+    };
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+    void work();
+
+    unsigned int nworkers_;
+    size_t capacity_;
+    unsigned long lastid_{0};
+    bool stopped_{false};
+    std::deque<Job> jobs_;
+    std::set<int> busy_;      // lanes that have a task being executed
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+  };
+
+}
+
+#endif
@@ -0,0 +1,336 @@
+//
+//  cclauncher: C++ class for launching processes without a shell.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <chrono>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "cclauncher.hpp"
+using namespace std;
+
+extern char** environ;
+
+namespace ccuty {
+
+// messages exchanged with the helper
+struct Request {
+  uint64_t id;
+  uint32_t size;      // followed by _size_ bytes: the NUL-terminated arguments
+};
+
+struct Reply {
+  uint64_t id;
+  int32_t status;     // exit status (see waitpid())
+  int32_t error;      // errno if the program could not be started
+};
+
+static const size_t MaxRequest = 1 << 16, MaxArgs = 1024, MaxChildren = 512;
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;   // no SIGPIPE if the other side died
+#else
+static const int SendFlags = 0;              // see SO_NOSIGPIPE
+#endif
+
+static void initSocket(int fd) {
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+static bool readAll(int fd, void* data, size_t len) {
+  char* p = static_cast<char*>(data);
+  while (len > 0) {
+    ssize_t n = ::read(fd, p, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    len -= size_t(n);
+  }
+  return true;
+}
+
+static bool sendAll(int fd, const void* data, size_t len) {
+  const char* p = static_cast<const char*>(data);
+  while (len > 0) {
+    ssize_t n = ::send(fd, p, len, SendFlags);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    len -= size_t(n);
+  }
+  return true;
+}
+
+// the programs get the default signal mask and handlers (whatever the caller did)
+struct SpawnAttr {
+  posix_spawnattr_t attr;
+
+  SpawnAttr() {
+    sigset_t mask, defaults;
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGCHLD);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+  }
+
+  ~SpawnAttr() {posix_spawnattr_destroy(&attr);}
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Helper process
+
+static int sigchldPipe[2] = {-1, -1};
+
+static void onSigchld(int) {
+  int e = errno;
+  char c = 0;
+  if (::write(sigchldPipe[1], &c, 1) < 0) {}  // the pipe is full: a byte is already there
+  errno = e;
+}
+
+// main loop of the helper: starts the requested programs and sends their exit status.
+// Only uses system calls and static or stack memory.
+static void runHelper(int sock) {
+  static char buf[MaxRequest];
+  static char* args[MaxArgs + 1];
+  static struct {pid_t pid; uint64_t id;} children[MaxChildren];
+  size_t nchildren = 0;
+
+  if (::pipe(sigchldPipe) < 0) ::_exit(1);
+  for (int fd : sigchldPipe) {
+    ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+  }
+  struct sigaction sa;
+  ::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSigchld;
+  sa.sa_flags = SA_NOCLDSTOP;
+  sigemptyset(&sa.sa_mask);
+  ::sigaction(SIGCHLD, &sa, nullptr);
+  sigset_t mask;
+  sigemptyset(&mask);
+  ::sigprocmask(SIG_SETMASK, &mask, nullptr);
+  SpawnAttr attr;
+
+  struct pollfd fds[2] = {{sock, POLLIN, 0}, {sigchldPipe[0], POLLIN, 0}};
+  while (true) {
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[1].revents) {    // reaps the programs that exited
+      char c[64];
+      while (::read(sigchldPipe[0], c, sizeof(c)) > 0) {}
+      int status;
+      pid_t pid;
+      while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+        for (size_t k = 0; k < nchildren; ++k) {
+          if (children[k].pid != pid) continue;
+          Reply r{children[k].id, status, 0};
+          children[k] = children[--nchildren];
+          if (!sendAll(sock, &r, sizeof(r))) ::_exit(0);
+          break;
+        }
+      }
+    }
+
+    if (fds[0].revents) {    // starts a program
+      Request q;
+      // the connection is closed when the Launcher is destroyed
+      if (!readAll(sock, &q, sizeof(q)) || q.size > MaxRequest || !readAll(sock, buf, q.size))
+        break;
+      size_t argc = 0;
+      for (size_t pos = 0; pos < q.size && argc < MaxArgs; ++argc) {
+        args[argc] = buf + pos;
+        pos += ::strnlen(buf + pos, q.size - pos) + 1;
+      }
+      args[argc] = nullptr;
+
+      int err = 0;
+      pid_t pid;
+      if (argc == 0 || buf[q.size-1] != 0) err = EINVAL;
+      else if (nchildren >= MaxChildren) err = EAGAIN;
+      else if ((err = ::posix_spawnp(&pid, args[0], nullptr, &attr.attr, args, environ)) == 0) {
+        children[nchildren].pid = pid;
+        children[nchildren].id = q.id;
+        nchildren++;
+      }
+      Reply r{q.id, -1, err};
+      if (err != 0 && !sendAll(sock, &r, sizeof(r))) break;
+    }
+  }
+  ::_exit(0);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Launcher::Launcher(bool usehelper) {
+  if (!usehelper) return;
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return;
+  initSocket(fds[0]);
+  initSocket(fds[1]);
+
+  pid_t pid = ::fork();
+  if (pid < 0) {
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return;
+  }
+  if (pid == 0) {
+    ::close(fds[0]);
+    runHelper(fds[1]);   // never returns
+  }
+  ::close(fds[1]);
+  helper_ = fds[0];
+  helperpid_ = pid;
+  helperok_ = true;
+}
+
+Launcher::~Launcher() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  if (helper_ >= 0) ::shutdown(helper_, SHUT_RDWR);   // the helper and reader_ stop
+  if (reader_.joinable()) reader_.join();
+  if (reaper_.joinable()) reaper_.join();
+  if (helper_ >= 0) {
+    ::close(helper_);
+    ::waitpid(helperpid_, nullptr, 0);
+  }
+}
+
+bool Launcher::hasHelper() const {
+  lock_guard<mutex> lock(mutex_);
+  return helperok_;
+}
+
+size_t Launcher::running() const {
+  lock_guard<mutex> lock(mutex_);
+  return helperjobs_.size() + directjobs_.size();
+}
+
+bool Launcher::spawn(const vector<string>& argv, Done done) {
+  if (argv.empty() || argv[0].empty()) return false;
+  unique_lock<mutex> lock(mutex_);
+  if (stopped_) return false;
+
+  if (helperok_) {
+    Request q{++lastid_, 0};
+    string data(sizeof(q), 0);
+    for (auto& a : argv) data.append(a.c_str(), a.size() + 1);  // with the NUL
+    q.size = uint32_t(data.size() - sizeof(q));
+
+    if (q.size <= MaxRequest) {
+      ::memcpy(&data[0], &q, sizeof(q));
+      if (!reader_.joinable()) reader_ = thread(&Launcher::readHelper, this);
+      helperjobs_[q.id] = std::move(done);   // before sending: the reply may come at once
+      lock.unlock();
+
+      bool sent;
+      {
+        lock_guard<mutex> wlock(writemutex_);
+        sent = sendAll(helper_, data.data(), data.size());
+      }
+      lock.lock();
+      if (sent) return true;
+
+      // the helper died: the program is started directly
+      auto it = helperjobs_.find(q.id);
+      if (it == helperjobs_.end()) return true;   // already reported by readHelper()
+      done = std::move(it->second);
+      helperjobs_.erase(it);
+      helperok_ = false;
+    }
+  }
+  return spawnDirect(argv, done);
+}
+
+// mutex_ must be locked
+bool Launcher::spawnDirect(const vector<string>& argv, Done& done) {
+  static SpawnAttr attr;
+  vector<char*> args;
+  for (auto& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+  args.push_back(nullptr);
+
+  pid_t pid;
+  if (::posix_spawnp(&pid, args[0], nullptr, &attr.attr, args.data(), environ) != 0) return false;
+  directjobs_[pid] = std::move(done);
+  if (!reaper_.joinable()) reaper_ = thread(&Launcher::reapDirect, this);
+  cond_.notify_all();
+  return true;
+}
+
+void Launcher::readHelper() {
+  Reply r;
+  while (readAll(helper_, &r, sizeof(r))) {
+    Done done;
+    {
+      lock_guard<mutex> lock(mutex_);
+      auto it = helperjobs_.find(r.id);
+      if (it == helperjobs_.end()) continue;
+      done = std::move(it->second);
+      helperjobs_.erase(it);
+    }
+    if (done) done(r.error ? -1 : r.status);
+  }
+
+  // the helper died (or the Launcher is destroyed): the status of its programs is unknown
+  map<unsigned long, Done> jobs;
+  {
+    lock_guard<mutex> lock(mutex_);
+    helperok_ = false;
+    if (!stopped_) jobs.swap(helperjobs_);
+  }
+  for (auto& j : jobs) if (j.second) j.second(-1);
+}
+
+// the programs are polled because waitpid(-1) would also reap the children
+// that were started by other means (e.g. by system())
+void Launcher::reapDirect() {
+  unique_lock<mutex> lock(mutex_);
+  vector<pair<Done,int>> exited;
+  while (!stopped_) {
+    if (directjobs_.empty()) {
+      cond_.wait(lock);
+      continue;
+    }
+    for (auto it = directjobs_.begin(); it != directjobs_.end(); ) {
+      int status = 0;
+      pid_t pid = ::waitpid(it->first, &status, WNOHANG);
+      if (pid == 0 || (pid < 0 && errno == EINTR)) ++it;
+      else {
+        exited.emplace_back(std::move(it->second), pid > 0 ? status : -1);
+        it = directjobs_.erase(it);
+      }
+    }
+    if (!exited.empty()) {
+      lock.unlock();
+      for (auto& e : exited) if (e.first) e.first(e.second);
+      exited.clear();
+      lock.lock();
+    }
+    else cond_.wait_for(lock, chrono::milliseconds(20));
+  }
+}
+
+}
@@ -0,0 +1,85 @@
+//
+//  cclauncher: C++ class for launching processes without a shell.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for launching processes without a shell.
+ *  - Launcher: starts programs with posix_spawn() and reaps them asynchronously.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_cclauncher
+#define ccuty_cclauncher
+/// @file.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/types.h>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Starts programs with posix_spawn() and reaps them asynchronously.
+   * Programs are started with an argument vector: there is no shell, hence no
+   * quoting problem (use {"/bin/sh", "-c", command} if a shell is really needed).
+   * spawn() does not wait for the program, which is reaped by a background thread.
+   *
+   * If _usehelper_ is true, a helper process is forked by the constructor and the
+   * programs are started and reaped by this helper. This avoids duplicating the
+   * (possibly big) calling process and is faster on platforms where posix_spawn()
+   * is implemented with fork(). As the helper is a fork, such Launchers should be
+   * created before the program starts threads (e.g. as global variables).
+   * Programs are started directly if the helper could not be created or died.
+   */
+  class Launcher {
+  public:
+    /// called when the program exits with the status returned by waitpid(),
+    /// or with -1 if it could not be started.
+    using Done = std::function<void(int status)>;
+
+    Launcher(bool usehelper);
+
+    /// stops the helper and the background thread, the programs keep running.
+    ~Launcher();
+
+    /// starts _argv[0]_ with these arguments (_argv[0]_ is searched in the PATH
+    /// if it does not contain a /). _done_ is called by a background thread.
+    /// returns false (and _done_ is not called) if the program could not be started.
+    /// When the helper is used, errors are reported later by calling _done_ with -1.
+    bool spawn(const std::vector<std::string>& argv, Done done = nullptr);
+
+    /// true if the programs are started by the helper.
+    bool hasHelper() const;
+
+    /// number of programs that did not exit yet.
+    size_t running() const;
+
+  private:
+    Launcher(const Launcher&) = delete;
+    Launcher& operator=(const Launcher&) = delete;
+    bool spawnDirect(const std::vector<std::string>& argv, Done& done);
+    void readHelper();
+    void reapDirect();
+
+    int helper_{-1};          // socket connected to the helper, -1 if none
+    pid_t helperpid_{-1};
+    bool helperok_{false}, stopped_{false};
+    unsigned long lastid_{0};
+    std::map<unsigned long, Done> helperjobs_;   // programs started by the helper
+    std::map<pid_t, Done> directjobs_;           // programs started directly
+    std::thread reader_, reaper_;
+    mutable std::mutex mutex_;
+    std::mutex writemutex_;   // for writing to the helper (without locking mutex_)
+    std::condition_variable cond_;
+  };
+
+}
+
+#endif
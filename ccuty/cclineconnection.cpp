@@ -0,0 +1,354 @@
+//
+//  cclineconnection: C++ class for sending lines of text to a server through a persistent connection.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "cclineconnection.hpp"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace ccuty {
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;   // no SIGPIPE if the server closed the connection
+#else
+static const int SendFlags = 0;              // see SO_NOSIGPIPE
+#endif
+
+static const int IdlePoll = 50;   // ms, if the pipe could not be created
+
+static void setNonBlocking(int fd) {
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static int remaining(Clock::time_point deadline) {
+  auto ms = chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()).count();
+  return ms > 0 ? int(ms) : 0;
+}
+
+static bool wouldBlock(int err) {
+  return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+}
+
+// waits for these events on _fd_ (ignored if -1) or for a wake up (the pipe is then
+// emptied, so the caller must check the state), returns the events of _fd_.
+static short waitFor(int wakefd, int fd, short events, int timeout) {
+  struct pollfd p[2] = {{wakefd, POLLIN, 0}, {fd, events, 0}};
+  if (wakefd < 0 && (timeout < 0 || timeout > IdlePoll)) timeout = IdlePoll;
+  if (::poll(p, 2, timeout) <= 0) return 0;
+  if (p[0].revents & POLLIN) {
+    char buf[64];
+    while (::read(wakefd, buf, sizeof(buf)) > 0) {}
+  }
+  return p[1].revents;
+}
+
+// the delay is doubled after each failure, the actual delay is between half and all
+// of it, so that clients that failed at the same time do not retry at the same time.
+static int retryDelay(int failures, int minDelay, int maxDelay, mt19937& random) {
+  long delay = max(minDelay, 1);
+  for (int k = 1; k < failures && delay < maxDelay; ++k) delay *= 2;
+  delay = min(delay, long(max(maxDelay, 1)));
+  return int(delay / 2 + uniform_int_distribution<long>(0, delay - delay / 2)(random));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+LineConnection::LineConnection(const string& host, int port, size_t capacity) :
+host_(host), port_(port), capacity_(capacity) {}
+
+LineConnection::~LineConnection() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopped_ = true;
+    wake();
+  }
+  if (thread_.joinable()) thread_.join();
+  for (int fd : wakefds_) if (fd >= 0) ::close(fd);
+}
+
+void LineConnection::open() {
+  lock_guard<mutex> lock(mutex_);
+  if (wanted_) return;
+  wanted_ = true;
+  start();
+  wake();
+}
+
+void LineConnection::close() {
+  lock_guard<mutex> lock(mutex_);
+  wanted_ = false;
+  session_++;     // the I/O thread closes the socket
+  lines_.clear();
+  state_ = Closed;
+  wake();
+}
+
+bool LineConnection::send(const string& line) {
+  lock_guard<mutex> lock(mutex_);
+  if (lines_.size() >= capacity_) return false;
+  lines_.push_back(line);
+  wanted_ = true;
+  start();
+  wake();
+  return true;
+}
+
+void LineConnection::setListener(Listener listener) {
+  lock_guard<mutex> lock(mutex_);
+  listener_ = listener;
+}
+
+void LineConnection::setConnectTimeout(int connectTimeout) {
+  lock_guard<mutex> lock(mutex_);
+  connectTimeout_ = connectTimeout;
+}
+
+void LineConnection::setRetryDelays(int minRetryDelay, int maxRetryDelay, int maxRetries) {
+  lock_guard<mutex> lock(mutex_);
+  minRetryDelay_ = minRetryDelay;
+  maxRetryDelay_ = maxRetryDelay;
+  maxRetries_ = maxRetries;
+}
+
+void LineConnection::setSeparator(char separator) {
+  lock_guard<mutex> lock(mutex_);
+  separator_ = separator;
+}
+
+LineConnection::State LineConnection::state() const {
+  lock_guard<mutex> lock(mutex_);
+  return state_;
+}
+
+size_t LineConnection::pending() const {
+  lock_guard<mutex> lock(mutex_);
+  return lines_.size();
+}
+
+// start() and wake() must be called with mutex locked.
+void LineConnection::start() {
+  if (thread_.joinable()) return;
+  if (::pipe(wakefds_) == 0) {
+    for (int fd : wakefds_) setNonBlocking(fd);
+  }
+  else wakefds_[0] = wakefds_[1] = -1;   // the I/O thread then polls
+  thread_ = thread(&LineConnection::run, this);
+}
+
+void LineConnection::wake() {
+  char c = 0;
+  if (wakefds_[1] >= 0 && ::write(wakefds_[1], &c, 1) < 0) {}  // full: will wake up anyway
+}
+
+// changes the state unless close() was called since _session_ started.
+// Closed means that the I/O thread gives up, the waiting lines are then discarded.
+bool LineConnection::setState(State state, unsigned long session, const string& error) {
+  Listener listener;
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (session != session_) return false;
+    if (state == Closed) {
+      wanted_ = false;
+      lines_.clear();
+    }
+    if (state == state_ && error.empty()) return true;
+    state_ = state;
+    listener = listener_;
+  }
+  if (listener) listener(state, error);
+  return true;
+}
+
+// puts the lines of _out_ that were not written at all back at the front of the queue
+// (the line that was partially written is lost with the connection).
+void LineConnection::requeue(unsigned long session, const string& out, bool partial,
+                             char separator) {
+  size_t pos = 0;
+  if (partial) {
+    pos = out.find(separator);
+    pos = pos == string::npos ? out.size() : pos + 1;
+  }
+  deque<string> lines;
+  while (pos < out.size()) {
+    size_t end = out.find(separator, pos);
+    if (end == string::npos) end = out.size();
+    lines.push_back(out.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  lock_guard<mutex> lock(mutex_);
+  if (session == session_) lines_.insert(lines_.begin(), lines.begin(), lines.end());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void LineConnection::run() {
+  mt19937 random(random_device{}());
+  int wakefd = wakefds_[0];      // set before the thread was started
+  int fd = -1, failures = 0;
+  unsigned long session = 0;
+  Clock::time_point retry;       // when to connect again
+  string out;                    // lines being written
+  bool partial = false;          // out starts with the end of a line
+
+  while (true) {
+    bool wanted;
+    int connectTimeout, minDelay, maxDelay, maxRetries;
+    char separator;
+    {
+      lock_guard<mutex> lock(mutex_);
+      if (stopped_) break;
+      if (session != session_) {     // close() was called
+        session = session_;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        failures = 0;
+        retry = Clock::time_point();
+        out.clear();
+        partial = false;
+      }
+      wanted = wanted_;
+      connectTimeout = connectTimeout_;
+      minDelay = minRetryDelay_;
+      maxDelay = maxRetryDelay_;
+      maxRetries = maxRetries_;
+      separator = separator_;
+      if (fd >= 0) {                 // the lines are written together
+        for (auto& l : lines_) {
+          out += l;
+          out += separator_;
+        }
+        lines_.clear();
+      }
+    }
+
+    if (!wanted) {                   // closed, or gave up
+      failures = 0;
+      retry = Clock::time_point();
+      waitFor(wakefd, -1, 0, -1);
+      continue;
+    }
+
+    if (fd < 0) {
+      if (Clock::now() < retry) {
+        waitFor(wakefd, -1, 0, remaining(retry));
+        continue;
+      }
+      if (!setState(Connecting, session)) continue;
+      string error;
+      fd = connectSocket(session, connectTimeout, error);
+      if (fd >= 0) {
+        if (setState(Connected, session)) failures = 0;
+        else {                       // closed meanwhile
+          ::close(fd);
+          fd = -1;
+        }
+      }
+      else if (++failures >= maxRetries) {
+        setState(Closed, session, error);
+      }
+      else {
+        retry = Clock::now() + chrono::milliseconds(retryDelay(failures, minDelay, maxDelay, random));
+        setState(Waiting, session, error);
+      }
+      continue;
+    }
+
+    // writes what it can without blocking, reads and ignores what the server sends
+    string error;
+    if (!out.empty()) {
+      ssize_t n = ::send(fd, out.data(), out.size(), SendFlags);
+      if (n > 0) {
+        partial = out[size_t(n) - 1] != separator;
+        out.erase(0, size_t(n));
+      }
+      else if (n < 0 && !wouldBlock(errno)) error = strerror(errno);
+    }
+    if (error.empty()) {
+      short events = waitFor(wakefd, fd, out.empty() ? POLLIN : POLLIN|POLLOUT, -1);
+      if (events & (POLLIN|POLLHUP|POLLERR)) {
+        char buf[1024];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n == 0) error = "closed by server";
+        else if (n < 0 && !wouldBlock(errno)) error = strerror(errno);
+      }
+    }
+    if (!error.empty()) {            // lost: the lines that were not written are kept
+      ::close(fd);
+      fd = -1;
+      requeue(session, out, partial, separator);
+      out.clear();
+      partial = false;
+      failures = 1;
+      retry = Clock::now() + chrono::milliseconds(retryDelay(failures, minDelay, maxDelay, random));
+      setState(Waiting, session, "Connection to " + host_ + " lost: " + error);
+    }
+  }
+
+  if (fd >= 0) ::close(fd);
+}
+
+// resolves the host and connects without blocking, so that close() and the
+// destructor can interrupt it.
+int LineConnection::connectSocket(unsigned long session, int timeout, string& error) {
+  string target = host_ + ":" + to_string(port_);
+  struct addrinfo hints, *addrs = nullptr;
+  ::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int err = ::getaddrinfo(host_.c_str(), to_string(port_).c_str(), &hints, &addrs);
+  if (err != 0) {
+    error = "Unknown host " + target + ": " + gai_strerror(err);
+    return -1;
+  }
+
+  auto deadline = Clock::now() + chrono::milliseconds(timeout);
+  int fd = -1;
+  for (auto a = addrs; a && fd < 0; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    setNonBlocking(fd);
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));   // lines are sent at once
+#ifdef SO_NOSIGPIPE
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    int code = ::connect(fd, a->ai_addr, a->ai_addrlen) == 0 ? 0 : errno;
+    while (code == EINPROGRESS || code == EINTR) {
+      int ms = remaining(deadline);
+      if (ms <= 0) {
+        code = ETIMEDOUT;
+        break;
+      }
+      if (waitFor(wakefds_[0], fd, POLLOUT, ms)) {
+        socklen_t len = sizeof(code);
+        if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &code, &len) < 0) code = errno;
+        break;
+      }
+      lock_guard<mutex> lock(mutex_);
+      if (stopped_ || session != session_) code = ECANCELED;
+    }
+    if (code != 0) {
+      error = "Can't connect to " + target + ": " + strerror(code);
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  ::freeaddrinfo(addrs);
+  return fd;
+}
+
+}
@@ -0,0 +1,114 @@
+//
+//  cclineconnection: C++ class for sending lines of text to a server through a persistent connection.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for sending lines of text to a server through a persistent connection.
+ *  - LineConnection: bounded queue of lines sent in order by an I/O thread that owns the socket.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_cclineconnection
+#define ccuty_cclineconnection
+/// @file.
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Persistent TCP connection to a server that receives lines of text.
+   * send() queues a line and returns immediately: the lines are sent in order by
+   * an I/O thread, which resolves the host name, connects and writes without
+   * blocking the callers. The lines that are queued while a line is being written
+   * are sent together (the socket has TCP_NODELAY so that short lines are not
+   * delayed). What the server sends is ignored.
+   *
+   * The connection is opened by the first send() (or by open()). If it fails or
+   * is lost, it is opened again after a delay that is doubled after each failure
+   * (from minRetryDelay to maxRetryDelay) and randomized, so that clients do not
+   * all retry at the same time. The lines that are waiting meanwhile are sent
+   * when the connection is restored (except the one that was being written when
+   * it was lost). After _maxRetries_ failures in a row, the waiting lines are
+   * discarded and the connection stays closed until the next send().
+   */
+  class LineConnection {
+  public:
+    enum State {Closed, Connecting, Connected, Waiting};
+
+    /// called by the I/O thread when the state changes, _error_ is not empty if the
+    /// connection failed or was lost.
+    using Listener = std::function<void(State, const std::string& error)>;
+
+    /// at most _capacity_ lines are waiting to be sent.
+    LineConnection(const std::string& host, int port, size_t capacity = 256);
+
+    /// closes the connection and stops the I/O thread.
+    ~LineConnection();
+
+    /// opens the connection if it is closed (does not block).
+    void open();
+
+    /// closes the connection and discards the lines that are not sent.
+    void close();
+
+    /// queues this line (without separator) and opens the connection if needed.
+    /// returns false if the queue is full.
+    bool send(const std::string& line);
+
+    /// the listener is called by the I/O thread (see Listener).
+    void setListener(Listener);
+
+    /// _connectTimeout_ is in milliseconds (default is 3000).
+    void setConnectTimeout(int connectTimeout);
+
+    /// delays in milliseconds before reconnecting (defaults are 100, 10000 and 5 retries).
+    void setRetryDelays(int minRetryDelay, int maxRetryDelay, int maxRetries);
+
+    /// the separator that is added to each line (default is '\\n').
+    void setSeparator(char separator);
+
+    State state() const;
+    bool isConnected() const {return state() == Connected;}
+
+    /// number of lines waiting to be sent (not including those being written).
+    size_t pending() const;
+
+    const std::string& host() const {return host_;}
+    int port() const {return port_;}
+
+  private:
+    LineConnection(const LineConnection&) = delete;
+    LineConnection& operator=(const LineConnection&) = delete;
+    void start();
+    void wake();
+    void run();
+    int connectSocket(unsigned long session, int timeout, std::string& error);
+    bool setState(State, unsigned long session, const std::string& error = "");
+    void requeue(unsigned long session, const std::string& out, bool partial, char separator);
+
+    std::string host_;
+    int port_;
+    size_t capacity_;
+    int connectTimeout_{3000}, minRetryDelay_{100}, maxRetryDelay_{10000}, maxRetries_{5};
+    char separator_{'\n'};
+    State state_{Closed};
+    bool wanted_{false};         // the connection must be opened
+    bool stopped_{false};        // the I/O thread must stop
+    unsigned long session_{0};   // incremented by close()
+    std::deque<std::string> lines_;
+    Listener listener_;
+    int wakefds_[2]{-1, -1};     // pipe that wakes up the I/O thread
+    std::thread thread_;
+    mutable std::mutex mutex_;
+  };
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+//
+//  ccring: C++ lock-free queue for exchanging data between two threads.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Lock-free queue for exchanging data between two threads.
+ *  - SpscRing: fixed-size queue with a single producer and a single consumer.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccring
+#define ccuty_ccring
+/// @file.
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Lock-free queue with a single producer and a single consumer.
+   * push() must always be called by the same thread, and pop() by another thread
+   * (or the same). They never block nor allocate memory, so that push() can be
+   * called from threads that must not be delayed: it returns false if the queue
+   * is full. _T_ must be trivially copyable and _Capacity_ a power of 2.
+   */
+  template <class T, size_t Capacity>
+  class SpscRing {
+    static_assert((Capacity & (Capacity-1)) == 0, "SpscRing: Capacity must be a power of 2");
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing: T must be trivially copyable");
+
+  public:
+    /// adds a copy of _item_, returns false if the queue is full (producer thread).
+    bool push(const T& item) {
+      size_t head = head_.load(std::memory_order_relaxed);
+      if (head - tail_.load(std::memory_order_acquire) >= Capacity) return false;
+      items_[head & (Capacity-1)] = item;
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// removes the oldest item and copies it in _item_, returns false if the queue is empty (consumer thread).
+    bool pop(T& item) {
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail == head_.load(std::memory_order_acquire)) return false;
+      item = items_[tail & (Capacity-1)];
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// true if the queue is empty.
+    bool empty() const {
+      return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    // head_ and tail_ are on different cache lines (they are written by different threads)
+    std::atomic<size_t> head_{0};
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_{0};
+    char pad2_[64 - sizeof(std::atomic<size_t>)];
+    T items_[Capacity];
+  };
+
+}
+
+#endif
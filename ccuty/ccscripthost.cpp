@@ -0,0 +1,310 @@
+//
+//  ccscripthost: C++ class for running scripts in a persistent interpreter.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "ccscripthost.hpp"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+extern char** environ;
+
+namespace ccuty {
+
+static const int MaxFailures = 3;
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;   // no SIGPIPE if the host died
+#else
+static const int SendFlags = 0;              // see SO_NOSIGPIPE
+#endif
+
+static uint64_t hashOf(const string& s) {    // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static string header(char kind, uint64_t hash, size_t count) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%c %016llx %zu\n", kind, (unsigned long long)hash, count);
+  return buf;
+}
+
+ScriptHost::ScriptHost(const vector<string>& argv, int timeout, int hosts) :
+argv_(argv), timeout_(timeout) {
+  for (int k = 0; k < max(hosts, 1); ++k) hosts_.emplace_back(new Host);
+}
+
+ScriptHost::~ScriptHost() {
+  unique_lock<mutex> lock(mutex_);
+  released_.wait(lock, [this] {
+    return none_of(hosts_.begin(), hosts_.end(), [](const unique_ptr<Host>& h) {return h->busy;});
+  });
+  for (auto& h : hosts_) stop(*h);
+}
+
+bool ScriptHost::isAvailable() const {
+  return failures_ < MaxFailures;
+}
+
+bool ScriptHost::run(const string& script, const vector<string>& args, string& output) {
+  uint64_t hash = hashOf(script);
+  size_t lines = 1;
+  for (char c : script) if (c == '\n') lines++;
+  return exec(hash, header('S', hash, lines) + script + '\n', args, output);
+}
+
+bool ScriptHost::runFile(const string& path, const vector<string>& args, string& output) {
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0) {
+    output = "Can't read script: " + path;
+    return false;
+  }
+  // the file is compiled again if it was modified
+  uint64_t hash = hashOf(path + '\n' + to_string(st.st_size) + '\n' + to_string(st.st_mtime));
+  return exec(hash, header('F', hash, 1) + path + '\n', args, output);
+}
+
+bool ScriptHost::exec(uint64_t hash, const string& definition, const vector<string>& args,
+                      string& output) {
+  output.clear();
+  string run = header('R', hash, args.size());
+  for (auto& a : args) {
+    string arg = a;
+    for (auto& c : arg) if (c == '\n') c = ' ';
+    run += arg + '\n';
+  }
+  Host& h = acquire(hash);
+  bool ok = request(h, hash, definition, run, output);
+  release(h);
+  return ok;
+}
+
+// waits for a host that is not busy, preferably one that has compiled the script,
+// otherwise one that is started
+ScriptHost::Host& ScriptHost::acquire(uint64_t hash) {
+  unique_lock<mutex> lock(mutex_);
+  Host* host = nullptr;
+  auto rank = [hash](const Host& h) {return h.defined.count(hash) ? 2 : h.sock >= 0 ? 1 : 0;};
+  released_.wait(lock, [&] {
+    for (auto& h : hosts_) {
+      if (!h->busy && (!host || rank(*h) > rank(*host))) host = h.get();
+    }
+    return host != nullptr;
+  });
+  host->busy = true;
+  return *host;
+}
+
+void ScriptHost::release(Host& h) {
+  lock_guard<mutex> lock(mutex_);
+  h.busy = false;
+  released_.notify_all();
+}
+
+// the host is not locked during the request, only its user (see acquire()) accesses it
+bool ScriptHost::request(Host& h, uint64_t hash, const string& definition, const string& run,
+                         string& output) {
+  // the host may have died since the last script: it is then restarted once
+  bool sent = false, define = false;
+  for (int attempt = 0; attempt < 2 && !sent; ++attempt) {
+    if (h.sock < 0 && !start(h, output)) return false;
+    define = h.defined.count(hash) == 0;
+    string request = define ? definition + run : run;   // both requests are sent at once
+    const char* p = request.data();
+    size_t len = request.size();
+    while (len > 0) {
+      ssize_t n = ::send(h.sock, p, len, SendFlags);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      p += n;
+      len -= size_t(n);
+    }
+    if (len == 0) sent = true;
+    else stop(h);
+  }
+  if (!sent) {
+    output = "Can't send script to host";
+    return false;
+  }
+
+  bool ok = false, defok = true;
+  string deferror;
+  if (define && !readReply(h, defok, deferror)) {
+    output = deferror;
+    return false;
+  }
+  if (!readReply(h, ok, output)) return false;
+  if (!defok) {          // the script could not be compiled
+    output = deferror;
+    return false;
+  }
+  if (define) h.defined.insert(hash);
+  return ok;
+}
+
+bool ScriptHost::start(Host& h, string& error) {
+  {
+    // the hosts that did not reply in time are waited for once they have exited
+    lock_guard<mutex> lock(mutex_);
+    abandoned_.erase(remove_if(abandoned_.begin(), abandoned_.end(), [](pid_t pid) {
+      return ::waitpid(pid, nullptr, WNOHANG) != 0;
+    }), abandoned_.end());
+  }
+  if (failures_ >= MaxFailures) {
+    error = "Script host is not available";
+    return false;
+  }
+  if (argv_.empty()) {
+    failures_ = MaxFailures;
+    error = "No script host";
+    return false;
+  }
+
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    failures_++;
+    error = string("Can't start script host: ") + strerror(errno);
+    return false;
+  }
+  ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);   // not for 0 and 1 (which are dup2'ed)
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  ::setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  vector<char*> args;
+  for (auto& a : argv_) args.push_back(const_cast<char*>(a.c_str()));
+  args.push_back(nullptr);
+
+  // the host reads and writes the socket, gets the default signal mask and handlers
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], 0);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+  posix_spawnattr_t attr;
+  sigset_t mask, defaults;
+  sigemptyset(&mask);
+  sigemptyset(&defaults);
+  sigaddset(&defaults, SIGCHLD);
+  sigaddset(&defaults, SIGPIPE);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  posix_spawnattr_setsigdefault(&attr, &defaults);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+  int err = ::posix_spawnp(&h.pid, args[0], &actions, &attr, args.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  ::close(fds[1]);
+
+  if (err != 0) {
+    ::close(fds[0]);
+    h.pid = -1;
+    failures_ = MaxFailures;   // e.g. the host does not exist: no need to try again
+    error = "Can't start script host " + argv_[0] + ": " + strerror(err);
+    return false;
+  }
+  h.sock = fds[0];
+  h.buffer.clear();
+  h.defined.clear();
+  return true;
+}
+
+// the host is killed as it may be blocked (e.g. if it does not read its requests)
+void ScriptHost::stop(Host& h) {
+  if (h.sock >= 0) ::close(h.sock);
+  h.sock = -1;
+  if (h.pid > 0) {
+    ::kill(h.pid, SIGKILL);
+    while (::waitpid(h.pid, nullptr, 0) < 0 && errno == EINTR) {}
+  }
+  h.pid = -1;
+  h.buffer.clear();
+  h.defined.clear();
+}
+
+// the host is probably running a long script: it is not killed, it exits when it
+// has finished it, as its standard input is then closed
+void ScriptHost::abandon(Host& h) {
+  if (h.sock >= 0) ::close(h.sock);
+  h.sock = -1;
+  if (h.pid > 0) {
+    lock_guard<mutex> lock(mutex_);
+    abandoned_.push_back(h.pid);
+  }
+  h.pid = -1;
+  h.buffer.clear();
+  h.defined.clear();
+}
+
+// reads "<status> <n>" and _n_ lines, replaces the host on error or timeout
+bool ScriptHost::readReply(Host& h, bool& ok, string& output) {
+  auto deadline = Clock::now() + chrono::milliseconds(timeout_);
+  string line;
+  int status = -1;
+  size_t count = 0;
+  bool valid = readLine(h, line, deadline)
+  && sscanf(line.c_str(), "%d %zu", &status, &count) == 2;
+  for (size_t k = 0; valid && k < count; ++k) {
+    valid = readLine(h, line, deadline);
+    if (k > 0) output += '\n';
+    output += line;
+  }
+  if (!valid) {
+    bool timeout = Clock::now() >= deadline;
+    if (timeout) abandon(h);
+    else {
+      stop(h);
+      failures_++;   // the host died
+    }
+    output = timeout ? "Script host timeout" : "Script host failed";
+    return false;
+  }
+  failures_ = 0;
+  ok = (status == 0);
+  return true;
+}
+
+bool ScriptHost::readLine(Host& h, string& line, Clock::time_point deadline) {
+  while (true) {
+    size_t pos = h.buffer.find('\n');
+    if (pos != string::npos) {
+      line.assign(h.buffer, 0, pos);
+      h.buffer.erase(0, pos + 1);
+      return true;
+    }
+    auto now = Clock::now();
+    if (now >= deadline) return false;
+    auto ms = chrono::duration_cast<chrono::milliseconds>(deadline - now).count() + 1;  // rounded up
+    struct pollfd p = {h.sock, POLLIN, 0};
+    int n = ::poll(&p, 1, int(ms));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    char buf[4096];
+    ssize_t len = ::read(h.sock, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR) continue;
+    if (len <= 0) return false;
+    h.buffer.append(buf, size_t(len));
+  }
+}
+
+}
@@ -0,0 +1,107 @@
+//
+//  ccscripthost: C++ class for running scripts in a persistent interpreter.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for running scripts in a persistent interpreter.
+ *  - ScriptHost: sends scripts to a long-lived host process which keeps them compiled.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccscripthost
+#define ccuty_ccscripthost
+/// @file.
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sys/types.h>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Runs scripts in persistent host processes.
+   * A host is started when a script is run and the other hosts are busy (there
+   * are at most _hosts_ of them, so that a long script does not block the others).
+   * Each script is sent once to a host and is identified by a hash of its source
+   * (or of the path, size and date of its file), the host compiles it and keeps it,
+   * so that running it again only costs a request and its reply. A host that dies
+   * is restarted and the scripts are then sent again. A host that does not reply
+   * in time is not killed, as it is probably running a long script: it is left
+   * to finish it (it then exits) and it is replaced by a new host.
+   *
+   * Protocol (on the standard input and output of the host, one request at a time):
+   * - "S <hash> <n>" followed by _n_ lines: defines a script from its source,
+   * - "F <hash> 1" followed by a line containing a path: defines a script from a file,
+   * - "R <hash> <n>" followed by _n_ lines: runs a script with _n_ arguments;
+   *
+   * the host replies "<status> <n>" followed by _n_ lines of output (or of error
+   * message) to each request, _status_ is 0 on success. Arguments can't contain
+   * newlines (they are replaced by spaces). <hash> is made of 16 hex digits.
+   * The host can be any program that implements this protocol, for instance
+   * resources/scripthost.sh for shell scripts.
+   */
+  class ScriptHost {
+  public:
+    /// _argv_ is the command that starts a host, a script fails if the host does
+    /// not reply within _timeout_ milliseconds, at most _hosts_ scripts run at once.
+    ScriptHost(const std::vector<std::string>& argv, int timeout = 10000, int hosts = 1);
+
+    /// stops the hosts.
+    ~ScriptHost();
+
+    /// false if the host could not be started, or died several times in a row.
+    bool isAvailable() const;
+
+    /// runs the script whose source is _script_ with these arguments.
+    /// returns true and the output of the script, false and an error message otherwise.
+    bool run(const std::string& script, const std::vector<std::string>& args,
+             std::string& output);
+
+    /// runs the script in this file with these arguments (see run()).
+    bool runFile(const std::string& path, const std::vector<std::string>& args,
+                 std::string& output);
+
+  private:
+    struct Host {
+      int sock{-1};            // connected to the standard input and output of the host
+      pid_t pid{-1};
+      bool busy{false};        // running a script
+      std::string buffer;      // data read from the host
+      std::unordered_set<uint64_t> defined;   // scripts that the host has compiled
+    };
+
+    ScriptHost(const ScriptHost&) = delete;
+    ScriptHost& operator=(const ScriptHost&) = delete;
+    bool exec(uint64_t hash, const std::string& definition, const std::vector<std::string>& args,
+              std::string& output);
+    Host& acquire(uint64_t hash);
+    void release(Host&);
+    bool request(Host&, uint64_t hash, const std::string& definition, const std::string& run,
+                 std::string& output);
+    bool start(Host&, std::string& error);
+    void stop(Host&);
+    void abandon(Host&);
+    bool readReply(Host&, bool& ok, std::string& output);
+    bool readLine(Host&, std::string& line, std::chrono::steady_clock::time_point deadline);
+
+    std::vector<std::string> argv_;
+    int timeout_;
+    std::vector<std::unique_ptr<Host>> hosts_;
+    std::vector<pid_t> abandoned_;   // hosts that did not reply in time, not yet exited
+    std::atomic<int> failures_{0};   // number of times a host died in a row
+    mutable std::mutex mutex_;       // protects all but the I/O of a busy host
+    std::condition_variable released_;
+  };
+
+}
+
+#endif
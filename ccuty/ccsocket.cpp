@@ -46,7 +46,7 @@ int Socket::setLocalAddress(struct sockaddr_in& addr, int port) {
 }
 
 // for INET4 sockets
-int Socket::setAddress(struct sockaddr_in& addr, const string& host, int port) {
+static int setInetAddress(struct sockaddr_in& addr, const string& host, int port) {
   addr = {};
   struct hostent* hent = NULL;
   // gethostbyname() is obsolete!
@@ -60,6 +60,10 @@ int Socket::setAddress(struct sockaddr_in& addr, const string& host, int port) {
   return 0;
 }
 
+int Socket::setAddress(struct sockaddr_in& addr, const string& host, int port) {
+  return setInetAddress(addr, host, port);
+}
+
 int Socket::bind(int port) {
   if (_sockfd < 0) return InvalidSocket;
   // for INET4 sockets
@@ -157,7 +161,17 @@ int ServerSocket::bind(int port, int backlog) {
   addr.sin_family = AF_INET;
   addr.sin_port = htons(port);
   addr.sin_addr.s_addr = INADDR_ANY;
-  
+  return listen(addr, backlog);
+}
+
+int ServerSocket::bind(const string& host, int port, int backlog) {
+  if (_sockfd < 0) return Socket::InvalidSocket;
+  struct sockaddr_in addr;
+  if (setInetAddress(addr, host, port) < 0) return Socket::UnknownHost;
+  return listen(addr, backlog);
+}
+
+int ServerSocket::listen(struct sockaddr_in& addr, int backlog) {
   if (::bind(_sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) return -1;
   // verifications sur le serveur
   socklen_t taille = sizeof addr;
@@ -180,6 +194,13 @@ int ServerSocket::close() {
   return stat;
 }
 
+int ServerSocket::getLocalPort() const {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (_sockfd < 0 || ::getsockname(_sockfd, (struct sockaddr*)&addr, &len) < 0) return -1;
+  return ntohs(addr.sin_port);
+}
+
 Socket* ServerSocket::accept() {
   int sock_com = -1;
   // cf. man -s 3n accept, attention EINTR ou EWOULBLOCK ne sont pas geres!
@@ -220,6 +220,16 @@ namespace ccuty {
      */
     virtual int bind(int port, int backlog = 50);
     
+    /** @brief Assigns the socket to this address.
+     * _host_ can be "localhost" so that only local clients can connect, _port_ can
+     * be 0 so that the system chooses a free port (see getLocalPort()).
+     * @return 0 on success or a negative value on error which is one of Socket::Errors
+     */
+    virtual int bind(const std::string& host, int port, int backlog = 50);
+    
+    /// Returns the port the socket is bound to, or a negative value on error.
+    int getLocalPort() const;
+    
     /// Closes the socket.
     virtual int close();
     
@@ -245,6 +255,7 @@ namespace ccuty {
     virtual Socket* createSocket(int sockfd);
     
   private:
+    int listen(struct sockaddr_in& addr, int backlog);
     int _sockfd;  // listening socket.
     ServerSocket(const ServerSocket&) = delete;
     ServerSocket& operator=(const ServerSocket&) = delete;
@@ -15,6 +15,7 @@
 #include <vector>
 #include <sstream>
 #include <cctype>
+#include <cstring>
 #include <cstdlib>
 #include <cerrno>
 #include <regex>
@@ -40,7 +41,11 @@ namespace ccuty {
    *   }
    * @endcode
    *
+   * @note Strings that have the same last 8 characters have the same ID.
+   *
    * @see ccuty::strid(const std::string&) for C++ strings.
+   * @see ccuty::stringswitch, which is also computed at compile time but takes all
+   * characters into account.
    * @see ccuty:stringset, which provides similar functionality but takes all 
    * characters into account.
    */
@@ -0,0 +1,178 @@
+//
+//  ccstringswitch: compile-time perfect hash for comparing strings in switch statements.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Compile-time perfect hash for comparing strings in switch statements.
+ *  - stringswitch: a constexpr set of strings whose IDs can be used as case labels.
+ *  - make_stringswitch(): creates a stringswitch from its keys.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccstringswitch
+#define ccuty_ccstringswitch
+/// @file.
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /// FNV-1a hash of the _len_ first characters of _str_ (can be computed at compile time).
+  inline constexpr uint64_t strhash(const char* str, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t k = 0; k < len; ++k) {
+      h ^= static_cast<unsigned char>(str[k]);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  /// length of a C string (can be computed at compile time).
+  inline constexpr size_t strlength(const char* str) {
+    size_t len = 0;
+    while (str[len]) ++len;
+    return len;
+  }
+
+  /// size of the table of a stringswitch with _n_ keys: a power of 2, at least 4 times _n_.
+  inline constexpr size_t stringswitch_size(size_t n) {
+    size_t size = 8;
+    while (size < 4 * n) size *= 2;
+    return size;
+  }
+
+  /** @brief Set of strings whose IDs can be used in switch statements.
+   * The strings (here named keys) are given at compile time, their ID is their
+   * position in the list (starting from 0). Unlike ccuty::strid(), all characters
+   * are taken into account: a perfect hash is computed at compile time, so that
+   * finding the ID of a string only requires hashing it and comparing it with
+   * one of the keys. Duplicate keys (and, in theory, keys with the same 64-bit hash)
+   * are compile-time errors.
+   *
+   * Example:
+   * @code
+   *   static constexpr auto colors = ccuty::make_stringswitch("red", "green", "blue");
+   *
+   *   int getRGB(const std::string& color) {
+   *     switch (colors(color)) {
+   *       case colors.id("red"): return 0xf00;
+   *       case colors.id("green"): return 0x0f0;
+   *       case colors.id("blue"): return 0x00f;
+   *       default: return 0;   // not a key (-1)
+   *     }
+   *   }
+   * @endcode
+   * id() is a compile-time error if its argument is not a key. The object must
+   * be `constexpr` for these checks to happen at compile time.
+   *
+   * @see ccuty::stringset, which provides similar functionality at runtime.
+   */
+  template <size_t N>
+  class stringswitch {
+  public:
+    static constexpr size_t TableSize = stringswitch_size(N);
+
+    /// _keys_ are C strings (normally literals, that are not copied).
+    template <class... Keys>
+    constexpr stringswitch(const Keys&... keys) : keys_{keys...} {
+      static_assert(sizeof...(Keys) == N, "stringswitch: wrong number of keys");
+      init();
+    }
+
+    /// _keys_ is an array of C strings (e.g. computed at compile time from a table).
+    constexpr stringswitch(const char* const (&keys)[N]) : keys_{} {
+      for (size_t k = 0; k < N; ++k) keys_[k] = keys[k];
+      init();
+    }
+
+    /// returns the ID of this string, -1 if it is not a key.
+    constexpr int operator()(const char* str, size_t len) const {
+      uint64_t h = strhash(str, len);
+      int k = slots_[slot(h)];
+      if (k < 0 || hashes_[k] != h || lengths_[k] != len) return -1;
+      for (size_t i = 0; i < len; ++i) {
+        if (keys_[k][i] != str[i]) return -1;
+      }
+      return k;
+    }
+
+    /// returns the ID of this string, -1 if it is not a key.
+    constexpr int operator()(const char* str) const {
+      return (*this)(str, strlength(str));
+    }
+
+    /// returns the ID of this string, -1 if it is not a key.
+    int operator()(const std::string& str) const {
+      return (*this)(str.data(), str.size());
+    }
+
+    /// returns the ID of this key, for case labels (compile-time error if not a key).
+    constexpr int id(const char* key) const {
+      int k = (*this)(key);
+      if (k < 0) throw "stringswitch: not a key";
+      return k;
+    }
+
+    /// returns the key that has this ID (which must be valid).
+    constexpr const char* key(int id) const {return keys_[id];}
+
+    /// returns the number of keys.
+    static constexpr size_t size() {return N;}
+
+  private:
+    static constexpr uint32_t MaxAttempts = 10000;
+
+    constexpr void init() {
+      for (size_t k = 0; k < N; ++k) {
+        lengths_[k] = strlength(keys_[k]);
+        hashes_[k] = strhash(keys_[k], lengths_[k]);
+        for (size_t j = 0; j < k; ++j) {
+          if (hashes_[j] == hashes_[k]) throw "stringswitch: duplicate key";
+        }
+      }
+      // searches a seed such that all keys have a different slot
+      uint32_t stamps[TableSize] = {};
+      for (uint32_t attempt = 1; attempt <= MaxAttempts; ++attempt) {
+        seed_ = uint64_t(attempt) * 0x2545F4914F6CDD1DULL;
+        bool perfect = true;
+        for (size_t k = 0; k < N && perfect; ++k) {
+          size_t s = slot(hashes_[k]);
+          if (stamps[s] == attempt) perfect = false;
+          else stamps[s] = attempt;
+        }
+        if (perfect) {
+          for (auto& s : slots_) s = -1;
+          for (size_t k = 0; k < N; ++k) slots_[slot(hashes_[k])] = int16_t(k);
+          return;
+        }
+      }
+      throw "stringswitch: no perfect hash found";
+    }
+
+    constexpr size_t slot(uint64_t h) const {
+      return size_t(((h ^ seed_) * 0x9E3779B97F4A7C15ULL) >> 40) & (TableSize - 1);
+    }
+
+    const char* keys_[N];
+    size_t lengths_[N]{};
+    uint64_t hashes_[N]{};
+    int16_t slots_[TableSize]{};
+    uint64_t seed_{0};
+  };
+
+  /** @brief Creates a stringswitch from its keys.
+   * @see ccuty::stringswitch.
+   */
+  template <class... Keys>
+  constexpr stringswitch<sizeof...(Keys)> make_stringswitch(const Keys&... keys) {
+    return stringswitch<sizeof...(Keys)>(keys...);
+  }
+
+}
+
+#endif
@@ -0,0 +1,243 @@
+//
+//  ccwatcher: C++ class for watching changes of files.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+#include <chrono>
+#include <map>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include "ccwatcher.hpp"
+#if defined(__linux__)
+#  include <sys/inotify.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#  include <sys/event.h>
+#  define CCUTY_KQUEUE 1
+#endif
+using namespace std;
+
+namespace ccuty {
+
+static string dirName(const string& path) {
+  auto pos = path.find_last_of('/');
+  return pos == string::npos ? "." : pos == 0 ? "/" : path.substr(0, pos);
+}
+
+static string baseName(const string& path) {
+  auto pos = path.find_last_of('/');
+  return pos == string::npos ? path : path.substr(pos+1);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Impl::wait() returns the files that may have changed, or false if the thread
+// must stop (or if the system does not support file watching).
+
+#if defined(__linux__)
+
+struct FileWatcher::Impl {
+  int fd{-1};
+  map<int, string> dirs;   // watch descriptor -> directory
+
+  Impl() {fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);}
+  ~Impl() {if (fd >= 0) ::close(fd);}
+
+  bool watch(const vector<string>& paths) {
+    if (fd < 0) return false;
+    for (auto& p : paths) {
+      // the directory is watched: the file may be replaced by another file
+      int wd = ::inotify_add_watch(fd, dirName(p).c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+      if (wd >= 0) dirs[wd] = dirName(p);
+    }
+    return true;
+  }
+
+  bool wait(int wakefd, int timeout, const vector<string>& paths, vector<string>& changed) {
+    struct pollfd fds[2] = {{wakefd, POLLIN, 0}, {fd, POLLIN, 0}};
+    int n = ::poll(fds, 2, timeout);
+    if (n < 0 && errno != EINTR) return false;
+    if (n <= 0) return true;
+    if (fds[0].revents) return false;
+
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len;
+    while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+      for (char* p = buf; p < buf + len; ) {
+        auto ev = reinterpret_cast<struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + ev->len;
+        auto dir = dirs.find(ev->wd);
+        if (dir == dirs.end() || ev->len == 0) continue;
+        for (auto& path : paths) {
+          if (dirName(path) == dir->second && baseName(path) == ev->name) changed.push_back(path);
+        }
+      }
+    }
+    return true;
+  }
+};
+
+#elif defined(CCUTY_KQUEUE)
+
+struct FileWatcher::Impl {
+  int kq{-1};
+  struct Watched {string path; int fd; bool isdir;};
+  vector<Watched> watched;
+
+  Impl() {kq = ::kqueue();}
+
+  ~Impl() {
+    for (auto& w : watched) if (w.fd >= 0) ::close(w.fd);
+    if (kq >= 0) ::close(kq);
+  }
+
+  static int openEvents(const string& path) {
+#ifdef O_EVTONLY
+    return ::open(path.c_str(), O_EVTONLY | O_CLOEXEC);  // does not prevent unmounting
+#else
+    return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+  }
+
+  void add(Watched& w) {
+    if (w.fd >= 0) ::close(w.fd);
+    w.fd = openEvents(w.path);
+    if (w.fd < 0) return;
+    struct kevent ev;
+    unsigned int flags = w.isdir ? NOTE_WRITE
+    : NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME;
+    EV_SET(&ev, w.fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, flags, 0, &w);
+    ::kevent(kq, &ev, 1, nullptr, 0, nullptr);
+  }
+
+  bool watch(const vector<string>& paths) {
+    if (kq < 0) return false;
+    for (auto& w : watched) if (w.fd >= 0) ::close(w.fd);
+    watched.clear();
+    // the directory is watched: the file may be replaced by another file
+    watched.reserve(paths.size() * 2);   // addresses must not change (see add())
+    for (auto& p : paths) {
+      watched.push_back(Watched{p, -1, false});
+      watched.push_back(Watched{dirName(p), -1, true});
+    }
+    for (auto& w : watched) add(w);
+    return true;
+  }
+
+  bool wait(int wakefd, int timeout, const vector<string>& paths, vector<string>& changed) {
+    struct kevent wake;
+    EV_SET(&wake, wakefd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    struct kevent evs[16];
+    struct timespec ts{timeout / 1000, (timeout % 1000) * 1000000L};
+    int n = ::kevent(kq, &wake, 1, evs, 16, timeout < 0 ? nullptr : &ts);
+    if (n < 0 && errno != EINTR) return false;
+
+    for (int k = 0; k < n; ++k) {
+      if (evs[k].filter == EVFILT_READ) return false;
+      auto w = static_cast<Watched*>(evs[k].udata);
+      if (!w->isdir) {
+        changed.push_back(w->path);
+        if (evs[k].fflags & (NOTE_DELETE | NOTE_RENAME)) add(*w);  // replaced
+      }
+      else {
+        // a file of the directory was created, removed or renamed
+        for (auto& f : watched) {
+          if (f.isdir || dirName(f.path) != w->path) continue;
+          struct stat st, fst;
+          if (::stat(f.path.c_str(), &st) < 0) continue;
+          if (f.fd < 0 || ::fstat(f.fd, &fst) < 0 || st.st_ino != fst.st_ino) {
+            add(f);
+            changed.push_back(f.path);
+          }
+        }
+      }
+    }
+    return true;
+  }
+};
+
+#else
+
+struct FileWatcher::Impl {
+  bool watch(const vector<string>&) {return false;}
+  bool wait(int, int, const vector<string>&, vector<string>&) {return false;}
+};
+
+#endif
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+FileWatcher::FileWatcher(Callback callback, int delay) :
+callback_(callback), delay_(delay) {
+}
+
+FileWatcher::~FileWatcher() {
+  stop();
+}
+
+void FileWatcher::add(const string& path) {
+  lock_guard<mutex> lock(mutex_);
+  paths_.push_back(path);
+  if (wakefds_[1] >= 0) {char c = 'a'; (void)::write(wakefds_[1], &c, 1);}
+}
+
+bool FileWatcher::start() {
+  if (thread_.joinable()) return true;
+  {
+    Impl impl;
+    if (!impl.watch({})) return false;   // not supported
+  }
+  if (::pipe(wakefds_) < 0) return false;
+  for (int fd : wakefds_) ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+  thread_ = thread(&FileWatcher::run, this);
+  return true;
+}
+
+void FileWatcher::stop() {
+  if (!thread_.joinable()) return;
+  char c = 'q';
+  (void)::write(wakefds_[1], &c, 1);
+  thread_.join();
+  ::close(wakefds_[0]);
+  ::close(wakefds_[1]);
+  wakefds_[0] = wakefds_[1] = -1;
+}
+
+void FileWatcher::run() {
+  using Clock = chrono::steady_clock;
+  map<string, Clock::time_point> pending;  // changed files and when they were last changed
+  vector<string> paths, changed;
+
+  while (true) {
+    Impl impl;
+    {
+      lock_guard<mutex> lock(mutex_);
+      paths = paths_;
+    }
+    impl.watch(paths);
+
+    // waits for changes until the thread is woken up (to stop or to add a file)
+    while (true) {
+      changed.clear();
+      int timeout = pending.empty() ? -1 : delay_;
+      if (!impl.wait(wakefds_[0], timeout, paths, changed)) break;
+      auto now = Clock::now();
+      for (auto& p : changed) pending[p] = now;
+
+      for (auto it = pending.begin(); it != pending.end(); ) {
+        if (now - it->second >= chrono::milliseconds(delay_)) {
+          callback_(it->first);
+          it = pending.erase(it);
+        }
+        else ++it;
+      }
+    }
+
+    char c = 0;
+    if (::read(wakefds_[0], &c, 1) <= 0 || c == 'q') return;
+  }
+}
+
+}
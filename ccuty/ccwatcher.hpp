@@ -0,0 +1,75 @@
+//
+//  ccwatcher: C++ class for watching changes of files.
+//  (c) Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+//
+
+/** @file
+ *  Class for watching changes of files.
+ *  - FileWatcher: calls a function when files are changed by any program.
+ *
+ * @author Eric Lecolinet 2017/2020 - https://www.telecom-paristech.fr/~elc
+ */
+
+#ifndef ccuty_ccwatcher
+#define ccuty_ccwatcher
+/// @file.
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+/// C++ Utilities.
+namespace ccuty {
+
+  /** @brief Calls a function when files are changed.
+   * Files are watched by a thread which uses inotify on Linux and kqueue on BSD
+   * and MacOSX. The directory of each file is also watched so that changes are
+   * detected when files are replaced (e.g. when a file is written in a temporary
+   * file which is then renamed, as many editors do).
+   *
+   * Bursts of changes are coalesced: the callback is called once, in the watching
+   * thread, when a file was not changed since _delay_ milliseconds. The callback
+   * may be called for files that were not modified (e.g. when the file was only
+   * touched): comparing the modification time or the content is up to the caller.
+   */
+  class FileWatcher {
+  public:
+    /// called with the path of the file that was changed.
+    using Callback = std::function<void(const std::string& path)>;
+
+    /// _delay_ is in milliseconds.
+    FileWatcher(Callback callback, int delay = 200);
+
+    /// stops watching.
+    ~FileWatcher();
+
+    /// adds a file to be watched (can be called before or after start()).
+    void add(const std::string& path);
+
+    /// starts the watching thread, returns false if files can't be watched on this system.
+    bool start();
+
+    /// stops the watching thread.
+    void stop();
+
+    /// true if the watching thread is running.
+    bool isWatching() const {return thread_.joinable();}
+
+  private:
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    struct Impl;
+    void run();
+
+    Callback callback_;
+    int delay_{200}, wakefds_[2]{-1, -1};
+    std::vector<std::string> paths_;
+    std::mutex mutex_;
+    std::thread thread_;
+  };
+
+}
+
+#endif
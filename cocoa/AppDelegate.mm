@@ -17,6 +17,7 @@
 #import "AWL.h"
 #import "Editor.h"
 #import "Settings.h"
+#import "Journal.h"
 using namespace std;
 
 static GUI& gui = GUI::instance;
@@ -63,7 +64,7 @@ public:
     return btn;
   }
   
-  NSButton* newActionButton(AWPanel* pane, Action& a, SEL sel) {
+  NSButton* newActionButton(AWPanel* pane, const Action& a, SEL sel) {
     NSButton* btn = [NSButton buttonWithImage: AWL::newImage(Conf::imageDir() + a.icon)
                                        target: del
                                        action: sel];
@@ -210,7 +211,7 @@ public:
   for (auto& a : Actions::instance.getActions()) {
     [buttons[k] addTrackingRect: NSRect{0., 0., size, size}
                           owner: self
-                       userData: &a
+                       userData: (void*)&a
                    assumeInside: NO];
     k++;
   }
@@ -249,7 +250,7 @@ public:
   << " track: " << (unsigned long)e.trackingArea
   << " data: " << (unsigned long)e.userData <<endl;
    */
-  gui.edit.showActionTip((Action*)e.userData, true);
+  gui.edit.showActionTip((const Action*)e.userData, true);
 }
 
 // called when an icon button is exited
@@ -259,7 +260,7 @@ public:
   << " track: " << (unsigned long)e.trackingArea
   << " data: " << (unsigned long)e.userData <<endl;
    */
-  gui.edit.showActionTip((Action*)e.userData, false);
+  gui.edit.showActionTip((const Action*)e.userData, false);
 }
 
 - (void)actionCallback:(id)sender {
@@ -473,14 +474,16 @@ static MTPoint mousePos;
     // forme some reason les items ne changent pas d'état tout seuls !
     if (sender == touchOpenMenu) {
       touchOpenMenu.state = s->touchOpenMenu_ = !s->touchOpenMenu_;
-      Conf::mustSave();
+      Journal::instance.record(Journal::Modes, *s);
+      Conf::mustSave(s->parentMenu());
     }
     else if (sender == touchFromBorder) {
       touchFromBorder.state = s->touchFromBorder_ = !s->touchFromBorder_;
       if (!s->touchFromBorder_) {
         touchOpenMenu.state = s->touchOpenMenu_ = false;
-        Conf::mustSave();
+        Conf::mustSave(s->parentMenu());
       }
+      Journal::instance.record(Journal::Modes, *s);
     }
   }
 }
@@ -8,14 +8,19 @@
 //
 
 #include <iostream>
+#include <memory>
+#include <cstring>
 #include "ccuty/ccstring.hpp"
 #include "ccuty/ccpath.hpp"
+#include "ccuty/ccexecutor.hpp"
+#include "ccuty/ccstringswitch.hpp"
 #include "MarkPad.h"
 #include "Actions.h"
 #include "CurrentAction.h"
 #include "GUI.h"
 #include "Conf.h"
 #include "Services.h"
+#include "Journal.h"
 using namespace std;
 using namespace ccuty;
 
@@ -30,9 +35,10 @@ void Actions::setCurrentFileOrURL(Shortcut* s, bool openURL) {
   string path, title;
 
   if (openURL) {
-    if (Services::getBrowserUrl(path) && !path.empty()) {
+    // URL and title in a single query (not cached: the user wants the current page)
+    if (Services::getBrowserPage(path, title) && !path.empty()) {
       s->setArg(path);
-      if (Services::getBrowserTitle(title) && !title.empty()) {
+      if (!title.empty()) {
         if (title.size() > 30) {title = title.substr(0,30); title += "...";}
         s->setName(title, true, false);
       }
@@ -49,7 +55,7 @@ void Actions::setCurrentFileOrURL(Shortcut* s, bool openURL) {
     s->setArg("<No Selection>");
     // setText(del->actionCommand, "<No Selection>");
   }
-  Conf::mustSave();
+  Conf::mustSave(s->parentMenu());
   GUI::instance.updateShortcut(s);
 }
 
@@ -60,9 +66,9 @@ void Actions::quitBrowser() {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-// menus must be defined before Actions::instance
+// menus must be defined before Actions::instance (they are used by the commands)
 
-static Helper* fileMenu = new Helper {
+static Helper fileMenu {
   "Choose File",
   {
     {"Current File in Finder"},
@@ -70,7 +76,7 @@ static Helper* fileMenu = new Helper {
     {"Show Desktop"},
     //{"Open Chosen File"}
   },
-  [] (Helper& h, Shortcut* s, const Command* c, int index) {
+  [] (Helper& /*h*/, Shortcut* s, const Command* c, int index) {
     if (!s || !c || index < 0) return;
     switch (index) {
       case 0:
@@ -90,7 +96,7 @@ static Helper* fileMenu = new Helper {
   }
 };
 
-static Helper* appMenu = new Helper {
+static Helper appMenu {
   "Choose App",
   {
     {"Current App in Finder"},
@@ -100,7 +106,7 @@ static Helper* appMenu = new Helper {
     //"[Will Open Current File]",
     //"[Will Open Custom File]",
   },
-  [] (Helper& h, Shortcut* s, const Command* c, int index) {
+  [] (Helper& /*h*/, Shortcut* s, const Command* c, int index) {
     if (!s || !c || index < 0) return;
     switch (index) {
       case 0:
@@ -132,7 +138,7 @@ static Helper* appMenu = new Helper {
   }
 };
 
-static Helper* urlMenu = new Helper {
+static Helper urlMenu {
   "Choose URL",
   {
     {"Current URL in Web Browser"},
@@ -160,14 +166,14 @@ static Helper* urlMenu = new Helper {
   }
 };
 
-static Helper* dirMenu = new Helper {
+static Helper dirMenu {
   "Choose Directory",
   {
     //"Parent Directory (⌘  )",
     {"Recent Files (⇧⌘F)","⇧⌘F"},
     {"Documents (⇧⌘O)","⇧⌘O"},
     {"Desktop (⇧⌘D)","⇧⌘D"},
-    {"Downloads (⌥⌘L)" "⌥⌘L"},
+    {"Downloads (⌥⌘L)","⌥⌘L"},
     {"Home (⇧⌘H)", "⇧⌘H"},
     {"Library (⇧⌘L)","⇧⌘L"},
     {"Computer (⇧⌘C)","⇧⌘C"},
@@ -185,7 +191,7 @@ static Helper* dirMenu = new Helper {
   }
 };
 
-static Helper* volMenu = new Helper {
+static Helper volMenu {
   "Choose Volume",
   {
     {"Volume +20","+20"},
@@ -204,7 +210,7 @@ static Helper* volMenu = new Helper {
   }
 };
 
-static Helper* moveMenu = new Helper {
+static Helper moveMenu {
   "Choose Area",
   {
     {"Left","left"},
@@ -222,7 +228,7 @@ static Helper* moveMenu = new Helper {
   }
 };
 
-static Helper* commandMenu = new Helper {
+static Helper commandMenu {
   "Choose App",
   {
     {"iTunes","iTunes"},
@@ -235,185 +241,213 @@ static Helper* commandMenu = new Helper {
   [] (Helper& h, Shortcut* s, const Command* c, int index) {
     if (!s || !c || index < 0) return;
     string cmd = h.menu[index].command;
-    if (c->name == "command") s->setArg(cmd + " : ");
+    if (strcmp(c->name, "command") == 0) s->setArg(cmd + " : ");
     else s->setArg(cmd);
   }
 };
 
-static Helper* configMenu = new Helper {
+static Helper configMenu {
   "Choose Menu",
   {  // automatically created, will contain all menu names
   },
   [] (Helper& h, Shortcut* s, const Command* c, int index) {
-    if (!s || !c || index < 0 || index >= h.menu.size()) return;
+    if (!s || !c || index < 0 || size_t(index) >= h.menu.size()) return;
     s->setArg(h.menu[index].item);
   }
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-Actions Actions::instance;  // Actions singleton
+// The actions and their commands are constant tables, so that nothing is done
+// at startup. Note that command names must be lowercased!
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static constexpr Command openCommands[] {
+  {"openurl",    "Open URL", "", "?", &urlMenu},
+  {"openfile",   "Open File or Directory", "", "?", &fileMenu},
+  {"openhideapp","Open/Hide Application", "", "?", &appMenu},
+  //{"openapp",    "Open Application", "", "?", &appMenu},
+  {"opensysdir", "Open Predefined Directory", "", "?", &dirMenu},
+};
 
-Actions::Actions() :
-current(*new CurrentAction()),
-actions
-{    // note that command names must be lowercased!
-  
+static constexpr Command windowCommands[] {
+  {"nextwin", "Show Next App Window"},
+  {"appwins", "Show All App Windows"},
+  {"resize", "Move Window at Location", "", "?", &moveMenu},
+  {"fullscreen", "App in Full Screen"},
+  {"zoom", "Zoom Current App"},
+  {"unzoom", "Unzoom Current App"},
+};
+
+static constexpr Command mediaCommands[] {
+  {"next",    "Next Track or Page", "", "?", &commandMenu},
+  {"previous", "Previous Track or Page", "", "?", &commandMenu},
+  {"showhide", "Show/Hide", "", "?", &commandMenu},
+  {"playpause", "Play/Pause", "", "?", &commandMenu},
+  {"quitapp", "Quit", "", "?", &commandMenu},
+  {"command",  "Custom Command", "(ex: iTunes : PlayPause)", "?", &commandMenu},
+};
+
+static constexpr Command clipboardCommands[] {
+  //{"copyws", "Copy Without Style"},
+  {"pastews", "Paste Without Style"},
+  {"write", "Paste this String", "(type string to be pasted)", "?"},
+  {"store", "Copy to Alt. Clipboard", "(number or any name)", "?"},  // textfield shown if arg is "?"
+  {"retrieve","Paste from Alt. Clipboard","(number or any name)", "?"},
+  {"cut",  "Cut"},
+  {"copy", "Copy"},
+  {"paste","Paste"},
+};
+
+static constexpr Command hotkeyCommands[] {
+  {"keystroke", "Custom Hotkey", "(select modifiers and enter key)", "?"},  // textfield shown if arg is "?"
+  {"redo", "Redo (⌘⇧Z/⌘Y)","(hotkey adapts to app)"},
+  {"undo", "Undo (⌘Z)", "", "⌘z"},
+  {"colors", "Colors (⌘⇧C)", "", "⌘⇧c"},
+  {"fonts", "Fonts (⌘T)", "", "⌘t"},
+  {"find", "Find (⌘F)", "", "⌘f"},
+  {"hide", "Hide (⌘H)", "", "⌘h"},
+  {"highlight", "Highlight (⌘⇧H)", "", "⌘⇧h"},
+  {"new", "New (⌘N)", "", "⌘n"},
+  {"open", "Open ⌘O)", "", "⌘o"},
+  {"quit", "Quit (⌘Q)", "", "⌘q"},
+  {"run", "Run (⌘R)",  "", "⌘r"},
+  {"save", "Save (⌘S)", "", "⌘s"},
+};
+
+static constexpr Command desktopCommands[] {
+  {"volume", "Volume", "", "?", &volMenu},
+  {"grabselect", "Grab Screen Area"},
+  {"grabscreen", "Grab Entire Screen"},
+  {"mcontrol", "Mission Control"},
+  {"desktop", "Show Desktop"},
+  {"dock", "Show/Hide Dock"},
+};
+
+static constexpr Command scriptCommands[] {
+  {"appcmd", "Application Command", "(ex: iTunes : PlayPause)", "?"},
+  {"applecmd", "AppleScript", "(ex: tell application \"iTunes\" to playPause)", "?"},
+  {"unixcmd", "Unix", "(ex: ls /Applications | open -f)", "?"},
+  {"scriptfile", "Script File", "(Unix or Apple script)", "?", &fileMenu}
+};
+
+/*
+static constexpr Command editorCommands[] {
+  {"edit", "Open Main Menu in Editing Mode", ""},
+  {"editmenu", "Open Submenu in Editing Mode", "", "?", &configMenu},
+};
+*/
+
+static constexpr Action actionTable[] {
   {  // must be first!
     "Menu", "menu.png", "menu-selected.png", Action::SubMenu,
   },
-  
   {
     "Open URL, File or Application", "app.png", "app-selected.png", Action::Standard,
-    [this](){current.doOpen();},
-    {
-      {"openurl",    "Open URL", "", "?", urlMenu},
-      {"openfile",   "Open File or Directory", "", "?", fileMenu},
-      {"openhideapp","Open/Hide Application", "", "?", appMenu},
-      //{"openapp",    "Open Application", "", "?", appMenu},
-      {"opensysdir", "Open Predefined Directory", "", "?", dirMenu},
-    }
+    openCommands
   },
-
   {
-    "Zoom and Windows", "resize.png", "resize-selected.png", Action::Standard,
-    [this](){current.doWindow();},
-    {
-      {"nextwin", "Show Next App Window"},
-      {"appwins", "Show All App Windows"},
-      {"resize", "Move Window at Location", "", "?", moveMenu},
-      {"fullscreen", "App in Full Screen"},
-      {"zoom", "Zoom Current App"},
-      {"unzoom", "Unzoom Current App"},
-    }
+    "Zoom and Windows", "resize.png", "resize-selected.png", Action::SendsKeys,
+    windowCommands
   },
-
   {
     "Commands for iTunes, Chrome, Safari, etc.", "media.png", "media-selected.png",
-    Action::Standard, [this]{current.doCommand();},
-    {
-      {"next",    "Next Track or Page", "", "?", commandMenu},
-      {"previous", "Previous Track or Page", "", "?", commandMenu},
-      {"showhide", "Show/Hide", "", "?", commandMenu},
-      {"playpause", "Play/Pause", "", "?", commandMenu},
-      {"quitapp", "Quit", "", "?", commandMenu},
-      {"command",  "Custom Command", "(ex: iTunes : PlayPause)", "?", commandMenu},
-    }
+    Action::Standard,
+    mediaCommands
   },
-
   {
     "Extended Copy & Paste", "clipboard.png", "clipboard-selected.png",
-    Action::Standard, [this](){current.doClipboard();},
-    {
-      //{"copyws", "Copy Without Style"},
-      {"pastews", "Paste Without Style"},
-      {"write", "Paste this String", "(type string to be pasted)", "?"},
-      {"store", "Copy to Alt. Clipboard", "(number or any name)", "?"},  // textfield shown if arg is "?"
-      {"retrieve","Paste from Alt. Clipboard","(number or any name)", "?"},
-      {"cut",  "Cut"},
-      {"copy", "Copy"},
-      {"paste","Paste"},
-    }
+    Action::SendsKeys,
+    clipboardCommands
   },
-
   {
-    "Application Hotkeys", "keyboard.png", "keyboard-selected.png", Action::Hotkey,
-    [this](){current.doHotkey();},
-    {
-      {"keystroke", "Custom Hotkey", "(select modifiers and enter key)", "?"},  // textfield shown if arg is "?"
-      {"redo", "Redo (⌘⇧Z/⌘Y)","(hotkey adapts to app)"},
-      {"undo", "Undo (⌘Z)", "", "⌘z"},
-      {"colors", "Colors (⌘⇧C)", "", "⌘⇧c"},
-      {"fonts", "Fonts (⌘T)", "", "⌘t"},
-      {"find", "Find (⌘F)", "", "⌘f"},
-      {"hide", "Hide (⌘H)", "", "⌘h"},
-      {"highlight", "Highlight (⌘⇧H)", "", "⌘⇧h"},
-      {"new", "New (⌘N)", "", "⌘n"},
-      {"open", "Open ⌘O)", "", "⌘o"},
-      {"quit", "Quit (⌘Q)", "", "⌘q"},
-      {"run", "Run (⌘R)",  "", "⌘r"},
-      {"save", "Save (⌘S)", "", "⌘s"},
-    },
+    "Application Hotkeys", "keyboard.png", "keyboard-selected.png", Action::Hotkey|Action::SendsKeys,
+    hotkeyCommands
   },
-
   {
-    "Desktop Commands", "view.png", "view-selected.png", Action::Standard,
-    [this](){current.doWindow();},
-    {
-      {"volume", "Volume", "", "?", volMenu},
-      {"grabselect", "Grab Screen Area"},
-      {"grabscreen", "Grab Entire Screen"},
-      {"mcontrol", "Mission Control"},
-      {"desktop", "Show Desktop"},
-      {"dock", "Show/Hide Dock"},
-    }
+    "Desktop Commands", "view.png", "view-selected.png", Action::SendsKeys,
+    desktopCommands
   },
-
   {
     "AppleScript and Unix Commands", "script.png", "script-selected.png",
-    Action::Standard, [this](){current.doCommand();},
-    {
-      {"appcmd", "Application Command", "(ex: iTunes : PlayPause)", "?"},
-      {"applecmd", "AppleScript", "(ex: tell application \"iTunes\" to playPause)", "?"},
-      {"unixcmd", "Unix", "(ex: ls /Applications | open -f)", "?"},
-      {"scriptfile", "Script File", "(Unix or Apple script)", "?", fileMenu}
-    }
+    Action::Standard,
+    scriptCommands
   },
   /*
   {
     "Open Menu in Editing Mode", "edit.png", "edit-selected.png",
-    Action::Config, [this]{current.openEditor();},
-    {
-      {"edit", "Open Main Menu in Editing Mode", ""},
-      {"editmenu", "Open Submenu in Editing Mode", "", "?", configMenu},
-    }
-   }
-   */
+    Action::Config,
+    editorCommands
+  },
+  {
+    "Click Mouse", "click.png", "click-selected.png",
+    Action::Standard,
+  },
+  */
+};
 
-  /*
-   {
-   "Click Mouse", "click.png", "click-selected.png",
-   Action::Standard,
-   [this]{current.doClicks();},
-   {}
-   },
-   */
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// index of the commands, computed at compile time: commandNames gives the position
+// of a command in this index, which gives its action and its index in the action.
+
+static constexpr size_t countCommands() {
+  size_t count = 0;
+  for (auto& a : actionTable) count += a.commands.size();
+  return count;
 }
-{
-  int index = 0;
-  
-  for (auto& a : actions) {
-    a.actionID = index++;
+
+static constexpr size_t CommandCount = countCommands();
+
+struct CommandIndex {
+  struct Entry {int8_t action, command;};
+  const char* names[CommandCount]{};
+  Entry entries[CommandCount]{};
   
-    for (auto& c : a.commands) {
-      c.action = &a;
-      auto it = commandmap.find(c.name);
-      if (it == commandmap.end()) commandmap[c.name] = &c;
-      else MarkPad::warning("Duplicate command name '"+c.name+"'");
+  constexpr CommandIndex() {
+    size_t k = 0;
+    for (size_t a = 0; a < sizeof(actionTable)/sizeof(actionTable[0]); ++a) {
+      for (size_t c = 0; c < actionTable[a].commands.size(); ++c, ++k) {
+        names[k] = actionTable[a].commands[c].name;
+        entries[k] = {int8_t(a), int8_t(c)};
+      }
     }
   }
+};
+
+static constexpr CommandIndex commandIndex;
+
+// a compile-time error if two commands have the same name
+static constexpr ccuty::stringswitch<CommandCount> commandNames(commandIndex.names);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+Actions Actions::instance;  // Actions singleton
+
+Actions::Actions() :
+current(*new CurrentAction()),
+executor(*new Executor(3, 32)) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-std::vector<Action> & Actions::getActions()  {return actions;}
+ConstArray<Action> Actions::getActions() const {return actionTable;}
 
-Action* Actions::getActionFromIndex(int index) {
-  if (index < 0 || index >= int(actions.size())) return nullptr;
-  else return &actions[index];
+const Action* Actions::getActionFromIndex(int index) const {
+  if (index < 0 || index >= int(getActions().size())) return nullptr;
+  else return &actionTable[index];
 }
 
-Action* Actions::getActionFromCommand(const string& cmd) {
-  auto it = commandmap.find(cmd);
-  if (it == commandmap.end()) return nullptr;
-  else return it->second->action;
+const Action* Actions::getActionFromCommand(const string& cmd) const {
+  int k = commandNames(cmd);
+  if (k < 0) return nullptr;
+  else return &actionTable[commandIndex.entries[k].action];
+}
+
+int Action::actionID() const {
+  return int(this - actionTable);
 }
 
 const Command* Action::command(const Shortcut& s) const {
-  if (s.comindex_ < 0 || s.comindex_ >= int(commands.size())) return nullptr;
-  return &commands[s.comindex_];
+  return command(s.comindex_);
 }
 
 const Command* Action::command(int index) const {
@@ -421,23 +455,19 @@ const Command* Action::command(int index) const {
   return &commands[index];
 }
 
-const string& Action::commandName(int index) const {
-  static const string empty, menu("menu");
-  if (type & Action::SubMenu) return menu;
-  if (index < 0 || index >= int(commands.size())) return empty;
+const char* Action::commandName(int index) const {
+  if (type & Action::SubMenu) return "menu";
+  if (index < 0 || index >= int(commands.size())) return "";
   else return commands[index].name;
 }
 
 int Action::findCommandFromName(const string& confname) const {
-  if (confname.empty()) return -1;
-  for (int k = 0; k < int(commands.size()); ++k) {
-    if (commands[k].name == confname) return k;
-  }
-  return -1;
+  int k = commandNames(confname);
+  if (k < 0 || commandIndex.entries[k].action != actionID()) return -1;
+  return commandIndex.entries[k].command;
 }
 
 int Action::findCommandFromTitle(const string& atitle) const {
-  if (title.empty()) return -1;
   for (int k = 0; k < (int)commands.size(); ++k) {
     if (commands[k].title == atitle) return k;
   }
@@ -446,12 +476,39 @@ int Action::findCommandFromTitle(const string& atitle) const {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
+// actions are executed by the executor so that touch handling is never blocked.
+// Each execution has its own ActionContext, so that they can overlap.
+static const int KeysLane = 0, MediaLane = 1;
+
 void Actions::run(bool state) {
-  if (state) current.connect(); else current.disconnect();
+  executor.submit([this, state] {
+    if (state) current.connect(); else current.disconnect();
+  }, MediaLane);
 }
 
-void Actions::exec(Shortcut& s, const MTTouch& touch, Shortcut::State touchState) {
-  current.exec(s, touch, touchState);
+unsigned long Actions::exec(Shortcut& s, const MTTouch& touch, Shortcut::State touchState,
+                            Done done) {
+  if (!s.action()) return 0;
+  
+  // the shortcut may be changed or deleted by the editor before the action is executed
+  auto context = make_shared<const ActionContext>(s, touch, touchState);
+  
+  auto id = executor.submit([this, context, done] {
+    ActionResult result;
+    bool ok = current.exec(*context, result);
+    if (done) Services::postpone([done, ok, result] {done(ok, result.feedback);});
+  },
+  s.action()->sendsKeys() ? KeysLane : Executor::AnyLane,
+  [done](bool completed) {     // cancelled or failed
+    if (!completed && done) Services::postpone([done] {done(false, "");});
+  });
+  
+  if (id == 0) MarkPad::warning("Too many pending actions, can't execute: " + s.name());
+  return id;
+}
+
+bool Actions::cancel(unsigned long id) {
+  return executor.cancel(id);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -480,7 +537,7 @@ static void convertHotkey(const string& from, uint8_t& modifiers, string& to) {
 bool Actions::setShortcutAction(Shortcut&s,
                                 std::string const& command,
                                 std::string const& arg) {
-  Action* a = getActionFromCommand(command);
+  const Action* a = getActionFromCommand(command);
   if (!a) return false;
   s.action_ = a;
   s.arg_ = arg;
@@ -489,9 +546,35 @@ bool Actions::setShortcutAction(Shortcut&s,
   uint8_t modifiers = 0;
   if (command == "keystroke") convertHotkey(arg, modifiers, s.arg_ );
   s.modifiers_ = modifiers;
+  resolveShortcutAction(s);
+  Journal::instance.record(Journal::Action, s);
   return true;
 }
 
+void Actions::resolveShortcutAction(Shortcut& s) const {
+  const Command* c = s.command();
+  s.args_ = ActionArgs();
+  s.handler_ = c ? CurrentAction::resolve(*s.action_, *c, s.arg_, s.args_) : nullptr;
+}
+
+
+string Actions::getShortcutActionForConfFile(const Shortcut& s) const {
+  const Action* a = s.action();
+  if (!a || s.submenu_) return "";
+  else if (!a->isHotkey() || s.modifiers() == 0) {
+    return string("!") + s.commandName() + " " + s.arg();
+  }
+  else {
+    string mod_string;
+    Services::modifiersToModString(s.modifiers(), mod_string);
+    return string("!") + s.commandName() + " " + mod_string + s.arg();
+  }
+}
+
+// keywords of previous versions of the configuration file
+static constexpr auto confKeywords = ccuty::make_stringswitch
+("hotkey", "resize", "volume", "openurl", "open", "openapp", "quitapp", "app",
+ "keystroke", "keycode", "script", "tellapp", "osascript", "system", "applescript");
 
 bool Actions::setShortcutActionFromConfFile(Shortcut& s,
                                             const string& keyword,
@@ -507,54 +590,54 @@ bool Actions::setShortcutActionFromConfFile(Shortcut& s,
     // compatibility
     Conf::mustSave();
 
-    switch (strid(keyword)) {
-      case strid("hotkey"):
+    switch (confKeywords(keyword)) {
+      case confKeywords.id("hotkey"):
         ccuty::strsplit(cmd, args, confarg, "");
         //if (cmd=="keystroke") convertHotkey(args, modifiers, args);
         break;
-      case strid("resize"):
+      case confKeywords.id("resize"):
         cmd = "resize";
         args = confarg;
         break;
-      case strid("volume"):
+      case confKeywords.id("volume"):
         cmd = "volume";
         args = confarg;
         break;
-      case strid("openurl"):
+      case confKeywords.id("openurl"):
         cmd = "openurl";
         args = confarg;
         break;
-      case strid("open"):
+      case confKeywords.id("open"):
         cmd = "openfile";
         args = confarg;
         break;
-      case strid("openapp"):
+      case confKeywords.id("openapp"):
         cmd = "openhideapp";
         args = confarg;
         break;
-      case strid("quitapp"):
+      case confKeywords.id("quitapp"):
         cmd = "quitapp";
         args = confarg;
         break;
-      case strid("app"):
+      case confKeywords.id("app"):
         ccuty::strsplit(cmd, args, confarg, "");
         if (cmd=="openhide") cmd = "openhideapp";
         else if (cmd=="open") cmd = "openapp";
         else if (cmd=="quit") cmd = "quitapp";
         break;
-      case strid("keystroke"): {
+      case confKeywords.id("keystroke"): {
         uint8_t modifiers = 0;
         cmd = "keystroke";
         Services::appleModStringToModifiers("keystroke "+confarg, modifiers, args);
         Conf::mustSave();
       } break;
-      case strid("keycode"): {
+      case confKeywords.id("keycode"): {
         uint8_t modifiers = 0;
         cmd = "keystroke";
         Services::appleModStringToModifiers("keycode "+confarg, modifiers, args);
         Conf::mustSave();
       } break;
-      case strid("script"):
+      case confKeywords.id("script"):
         ccuty::strsplit(cmd, args, confarg, "");
         if (cmd == "simple") cmd = "appcmd";
         else if (cmd == "regular") cmd = "applecmd";
@@ -563,22 +646,22 @@ bool Actions::setShortcutActionFromConfFile(Shortcut& s,
         args = confarg;
         break;
 
-      case strid("tellapp"):
+      case confKeywords.id("tellapp"):
         cmd = "appcmd";
         args = confarg;
         Conf::mustSave();
         break;
-      case strid("osascript"):
+      case confKeywords.id("osascript"):
         cmd = "applecmd";
         args = confarg;
         Conf::mustSave();
         break;
-      case strid("system"):
+      case confKeywords.id("system"):
         cmd = "unixcmd";
         args = confarg;
         Conf::mustSave();
         break;
-      case strid("applescript"):
+      case confKeywords.id("applescript"):
         cmd = "scriptfile";
         args = confarg;
         Conf::mustSave();
@@ -11,17 +11,20 @@
 #define MarkPad_Actions
 
 #include <string>
-#include <map>
+#include <cstddef>
 #include <vector>
 #include <functional>
 #include "Shortcut.h"
 
+namespace ccuty {class Executor;}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 class Helper {
 public:
   struct Item {
-    std::string item, command;
+    std::string item;
+    std::string command{};   // empty if the item is not a command
   };
   std::string title;
   std::vector<Item> menu;
@@ -30,32 +33,77 @@ public:
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
+/// an array of the compile-time tables of Actions.
+template <class T>
+class ConstArray {
+public:
+  constexpr ConstArray() = default;
+  template <size_t N> constexpr ConstArray(const T (&array)[N]) : first_(array), size_(N) {}
+  constexpr const T* begin() const {return first_;}
+  constexpr const T* end() const {return first_ + size_;}
+  constexpr size_t size() const {return size_;}
+  constexpr bool empty() const {return size_ == 0;}
+  constexpr const T& operator[](size_t k) const {return first_[k];}
+private:
+  const T* first_{nullptr};
+  size_t size_{0};
+};
+
+/// command of an Action (the commands are defined at compile time, see Actions.cpp).
 class Command {
 public:
-  std::string name, title, help, arg;
+  const char* name;          ///< as in the conf file, must be lowercased.
+  const char* title;
+  const char* help{""};
+  const char* arg{""};       ///< "?" if the argument is provided by the user.
   Helper* helper{nullptr};
-  class Action* action{nullptr};
-  int index{0};
+};
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+/// state of an execution of an action, which is passed to the action handlers.
+/// It is created for each execution and is not modified, so that actions can be
+/// executed simultaneously.
+class ActionContext {
+public:
+  ActionContext(const Shortcut&, const MTTouch&, Shortcut::State);
+  const std::string name, arg;    ///< of the shortcut (which may change during the execution).
+  const uint8_t modifiers;        ///< of the shortcut.
+  const class Action* const action;
+  const Command* const command;   ///< null if the command is undefined.
+  const ActionHandler handler;    ///< null if the action can't be executed.
+  const ActionArgs args;          ///< the argument of the shortcut, parsed.
+  const MTTouch touch;
+  const Shortcut::State touchstate;
+};
+
+/// result of an execution of an action.
+struct ActionResult {
+  enum Status {OK, NoFeedback, Error} status{OK};
+  std::string feedback;           ///< empty if the action does not change the feedback.
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 class Action {
 public:
-  enum Type {Standard=0, SubMenu=1<<1, Config=1<<2, Hotkey=1<<3};
+  enum Type {Standard=0, SubMenu=1<<1, Config=1<<2, Hotkey=1<<3, SendsKeys=1<<4};
 
   bool isHotkey() const {return (type & Hotkey) != 0;}
+  /// true if this action sends keystrokes (such actions are executed in order).
+  bool sendsKeys() const {return (type & SendsKeys) != 0;}
   const Command* command(const Shortcut&) const;
   const Command* command(int index) const;
-  const string& commandName(int index) const;
+  const char* commandName(int index) const;
   int findCommandFromName(const string& confname) const;
   int findCommandFromTitle(const string& title) const;
+  /// index in the list of actions.
+  int actionID() const;
 
-  std::string title, icon, selectedIcon;
+  const char* title;
+  const char* icon;
+  const char* selectedIcon;
   unsigned int type{Standard};
-  std::function<void()> fun{nullptr};
-  std::vector<Command> commands;
-  int actionID{0};     // index in the list of actions
+  ConstArray<Command> commands{};
 };
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -70,21 +118,37 @@ public:
   /// run or pause depending on _state_.
   void run(bool state);
   
-  /// executes the action of this Shortcut.
-  /// the shortcut name is displayed as feedback, except if changed by the action.
-  void exec(Shortcut&, const MTTouch&, Shortcut::State);
+  /// called in the main thread when an action was executed, with its feedback (empty
+  /// if none); _ok_ is false if the action failed or was cancelled.
+  using Done = std::function<void(bool ok, const std::string& feedback)>;
+
+  /// executes the action of this Shortcut in a worker thread.
+  /// Actions that send keystrokes are executed in order, the others may be executed
+  /// simultaneously. Returns an id for cancel(), 0 if the action can't be executed.
+  unsigned long exec(Shortcut&, const MTTouch&, Shortcut::State, Done = nullptr);
+
+  /// cancels this action if its execution has not started, returns false otherwise.
+  bool cancel(unsigned long id);
 
   static void setCurrentFileOrURL(Shortcut*, bool openURL);
 
-  std::vector<Action> & getActions();
-  Action* getActionFromCommand(const string& command);
-  Action* getActionFromIndex(int actionindex);
+  /// the actions and their commands are defined at compile time.
+  ConstArray<Action> getActions() const;
+  const Action* getActionFromCommand(const string& command) const;
+  const Action* getActionFromIndex(int actionindex) const;
 
   bool setShortcutAction(Shortcut&s,
                          std::string const& command, std::string const& args);
 
+  /// finds the handler of the action of this Shortcut and parses its argument, so
+  /// that exec() does not have to (called when the action, command or arg is changed).
+  void resolveShortcutAction(Shortcut&) const;
+
   bool setShortcutActionFromConfFile(Shortcut&, const string& keyword,
                                      const string& config);
+
+  /// returns the action of this Shortcut as written in the conf file (empty if none).
+  string getShortcutActionForConfFile(const Shortcut&) const;
   void quitBrowser();
 
 private:
@@ -92,8 +156,7 @@ private:
   Actions(const Actions&) = delete;       // can't be copied.
   Actions& operator=(Actions&) = delete;  // can't be copied.
   class CurrentAction& current;
-  std::vector<Action> actions;
-  std::map<std::string,Command*> commandmap;
+  ccuty::Executor& executor;
 };
 
 #endif
@@ -12,9 +12,22 @@
 #include <locale>
 #include <clocale>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "ccuty/ccstring.hpp"
+#include "ccuty/ccwatcher.hpp"
 #include "jsonserial/jsonserial.hpp"
 #include "jsonserial/map.hpp"
 #include "jsonserial/list.hpp"
@@ -26,22 +39,30 @@
 #include "Actions.h"
 #include "Services.h"
 #include "DataLogger.h"
+#include "Journal.h"
 using namespace ccuty;
  
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
+/// where the content of a submenu that was not read is in the configuration file.
+struct LazyMenu {
+  std::shared_ptr<const std::string> text;  // content of the file
+  size_t begin, end, line;
+};
+
 class ConfImpl : public JsonClasses {
   friend class Conf;
   friend class CConf;
-  static std::istringstream iss;
   static std::ostringstream oss;
 
 public:
   static ConfImpl impl;
   
+  // the action is read from a file, so it is not a change to record in the journal.
   static void readAction(Shortcut& s, JsonSerial&, const string& val) {
     if (val.empty()) return;
-    else if (val[0]=='!') {
+    Journal::pause(true);
+    if (val[0]=='!') {
       Actions::instance.setShortcutActionFromConfFile(s, "!", val.substr(1));
     }
     else {
@@ -49,20 +70,12 @@ public:
       strsplit(keyword, args, val, strdelim().spaces());
       Actions::instance.setShortcutActionFromConfFile(s, keyword, args);
     }
+    Journal::pause(false);
   }
   
   static void writeAction(const Shortcut& s, JsonSerial& js) {
-    const Action* a = s.action();
-    if (a && !s.submenu_) {
-      if (!a->isHotkey() || s.modifiers() == 0) {
-        js.writeMember("!" + s.commandName() + " " + s.arg());
-      }
-      else {
-        string mod_string;
-        Services::modifiersToModString(s.modifiers(), mod_string);
-        js.writeMember("!" + s.commandName() + " " + mod_string + s.arg());
-      }
-    }
+    string val = Actions::instance.getShortcutActionForConfFile(s);
+    if (!val.empty()) js.writeMember(val);
   }
   
   static void readModes(Shortcut& s, JsonSerial& js, const string& val) {
@@ -90,23 +103,39 @@ public:
   }
   
   static void readSubmenu(Shortcut& s, JsonSerial& js, const string& val) {
-    if (!val.empty()) js.readMember(s.submenu_, val);
+    size_t begin, end, line;
+    if (lazy && js.skipMember(val, begin, end, line)) {
+      // the submenu will be read when needed (see readLazyMenu())
+      s.submenu_ = js.arena_ ? newMenuInArena(*js.arena_) : newMenu();
+      s.submenu_->lazy_ = new LazyMenu{lazy->text, lazy->base + begin, lazy->base + end, line};
+      lazy->created.push_back(s.submenu_);
+    }
+    else if (!val.empty()) js.readMember(s.submenu_, val);
   }
   
   static void writeSubmenu(const Shortcut& s, JsonSerial& js) {
-    if (s.submenu_) js.writeMember(s.submenu_);
+    if (s.submenu_) {
+      s.submenu_->load();
+      js.writeMember(s.submenu_);
+    }
   }
   
-  static void readArea(Shortcut& s, JsonSerial&, const string& val) {
+  // one stream per thread because files are also read by the file watcher.
+  static std::istringstream& input(const string& val) {
+    thread_local std::istringstream iss;
+    thread_local bool classic = false;
+    if (!classic) {iss.imbue(std::locale::classic()); classic = true;}
     iss.clear();
     iss.str(val);
-    iss >> s.area_.x >> s.area_.y >> s.area_.width >> s.area_.height;
+    return iss;
+  }
+  
+  static void readArea(Shortcut& s, JsonSerial&, const string& val) {
+    input(val) >> s.area_.x >> s.area_.y >> s.area_.width >> s.area_.height;
   }
   
   static void readNameArea(Shortcut& s, JsonSerial&, const string& val) {
-    iss.clear();
-    iss.str(val);
-    iss >> s.namearea_.x >> s.namearea_.y;
+    input(val) >> s.namearea_.x >> s.namearea_.y;
   }
   
   static void writeArea(const Shortcut& s, JsonSerial& js) {
@@ -123,12 +152,150 @@ public:
     js.writeMember(oss.str());
   }
   
+  // shortcuts and menus are allocated in the arena of the file they are read from
+  // (see CConf::read()), which is a MenuArena.
+  static Shortcut* newShortcut() {return new Shortcut();}
+  static Shortcut* newShortcutInArena(JsonArena& a) {return new (static_cast<MenuArena&>(a)) Shortcut();}
+  static ShortcutMenu* newMenu() {return new ShortcutMenu();}
+  static ShortcutMenu* newMenuInArena(JsonArena& a) {return new (static_cast<MenuArena&>(a)) ShortcutMenu();}
+  
   static void completeShortcut(Shortcut& s) {
     s.namearea_.x += s.area_.x;
     s.namearea_.y += s.area_.y;
     if (s.submenu_) s.submenu_->opener_ = &s;
   }
   
+  // - - - - - -
+  // Submenus are not read with the configuration file if Conf::lazyMenus is true:
+  // readSubmenu() creates empty menus that are read when needed (see ShortcutMenu::load()).
+  
+  struct LazyReader {
+    std::shared_ptr<const std::string> text;  // content of the configuration file
+    size_t base;                              // position of what is read in this text
+    std::vector<ShortcutMenu*> created;       // submenus that were not read
+  };
+  
+  static thread_local LazyReader* lazy;   // not null while reading with lazy submenus
+  
+  // true in the threads that read files in the background (see fileChanged()) and
+  // while reading a lazy menu (see UnreadMenus): Conf::mustSave() is then called by
+  // the main thread.
+  static thread_local bool background;
+  
+  // must not be called by several threads at the same time (see UnreadMenus).
+  static void readLazyMenu(ShortcutMenu& menu, std::vector<ShortcutMenu*>& created) {
+    LazyMenu* l = menu.lazy_;
+    if (!l) return;   // already read
+    LazyReader reader{l->text, l->begin, {}};
+    LazyReader* previous = lazy;
+    lazy = &reader;   // its submenus are not read either
+    
+    std::istringstream in(l->text->substr(l->begin, l->end - l->begin));
+    ShortcutMenu content;
+    ostringstream errors;
+    JsonSerial js(impl, [&errors](const JsonError& e){e.print(errors); errors<<"\n";});
+    if (!js.read(content, in, Conf::shortcutFile(), l->line)) {
+      MarkPad::warning("while reading menu\nIn file: "+Conf::shortcutFile()+"\n"+errors.str());
+    }
+    lazy = previous;
+    
+    for (auto s : content.shortcuts_) s->parentmenu_ = &menu;
+    menu.shortcuts_.swap(content.shortcuts_);
+    menu.lazy_ = nullptr;
+    delete l;
+    created.insert(created.end(), reader.created.begin(), reader.created.end());
+  }
+  
+  static void dropLazyMenu(ShortcutMenu& menu) {
+    delete menu.lazy_.exchange(nullptr);
+  }
+  
+  // - - - - - -
+  // Menus read from a file that was changed by another program are compared with
+  // the live menus, which are patched. Shortcuts are matched by name, those that
+  // still exist are kept so that pointers to them remain valid.
+  
+  struct Patch {
+    size_t changes{0};
+    std::vector<Shortcut*> removed;        // deleted once the patch is applied
+    std::vector<ShortcutMenu*> removedMenus;
+  };
+  
+  static bool sameRect(const MTRect& a, const MTRect& b) {
+    // files contain 4 digits after the decimal point
+    return std::fabs(a.x - b.x) < 5e-5f && std::fabs(a.y - b.y) < 5e-5f
+    && std::fabs(a.width - b.width) < 5e-5f && std::fabs(a.height - b.height) < 5e-5f;
+  }
+  
+  static void patchShortcut(Shortcut& cur, Shortcut& next, Patch& p) {
+    bool samefeedback = cur.feedback_ ? next.feedback_ && *cur.feedback_ == *next.feedback_
+    : !next.feedback_;
+    if (cur.action_ != next.action_ || cur.comindex_ != next.comindex_ || cur.arg_ != next.arg_
+        || !samefeedback
+        || cur.touchOpenMenu_ != next.touchOpenMenu_ || cur.touchFromBorder_ != next.touchFromBorder_
+        || !sameRect(cur.area_, next.area_) || !sameRect(cur.namearea_, next.namearea_)) {
+      cur.action_ = next.action_;
+      cur.comindex_ = next.comindex_;
+      cur.arg_ = next.arg_;
+      cur.handler_ = next.handler_;
+      std::swap(cur.args_, next.args_);
+      std::swap(cur.feedback_, next.feedback_);
+      cur.touchOpenMenu_ = next.touchOpenMenu_;
+      cur.touchFromBorder_ = next.touchFromBorder_;
+      cur.area_ = next.area_;
+      cur.namearea_ = next.namearea_;
+      p.changes++;
+    }
+    
+    if (cur.submenu_ && next.submenu_) patchMenu(*cur.submenu_, *next.submenu_, p);
+    else if (next.submenu_) {   // new submenu
+      cur.submenu_ = next.submenu_;
+      cur.submenu_->opener_ = &cur;
+      next.submenu_ = nullptr;
+      p.changes++;
+    }
+    else if (cur.submenu_) {    // removed submenu
+      cur.submenu_->opener_ = nullptr;
+      p.removedMenus.push_back(cur.submenu_);
+      cur.submenu_ = nullptr;
+      p.changes++;
+    }
+  }
+  
+  // _next_ keeps the shortcuts that were not moved to _cur_ and must then be deleted.
+  static void patchMenu(ShortcutMenu& cur, ShortcutMenu& next, Patch& p) {
+    Shortcuts& olds = cur.shortcuts();
+    Shortcuts shortcuts;
+    std::vector<bool> kept(olds.size(), false);
+    
+    for (size_t k = 0; k < next.shortcuts_.size(); ++k) {
+      Shortcut* n = next.shortcuts_[k];
+      // same name, preferably at the same position
+      size_t i = (k < olds.size() && !kept[k] && olds[k]->name_ == n->name_) ? k : olds.size();
+      for (size_t j = 0; i == olds.size() && j < olds.size(); ++j) {
+        if (!kept[j] && olds[j]->name_ == n->name_) i = j;
+      }
+      if (i < olds.size()) {
+        kept[i] = true;
+        patchShortcut(*olds[i], *n, p);
+        shortcuts.push_back(olds[i]);
+      }
+      else {  // new shortcut
+        n->parentmenu_ = &cur;
+        next.shortcuts_[k] = nullptr;
+        shortcuts.push_back(n);
+      }
+    }
+    
+    for (size_t i = 0; i < olds.size(); ++i) {
+      if (!kept[i]) p.removed.push_back(olds[i]);
+    }
+    if (shortcuts != olds) {
+      olds.swap(shortcuts);
+      p.changes++;
+    }
+  }
+  
   // - - - - - -
   
   ConfImpl() {
@@ -141,8 +308,7 @@ public:
     std::cout << 1000.01 << "\n\n";
     */
     
-    // iss and oss must use the C locale otherwise 1000.01 would be written/read 1000,01
-    iss.imbue(std::locale::classic());
+    // oss (and input()) must use the C locale otherwise 1000.01 would be written/read 1000,01
     oss.imbue(std::locale::classic());
     oss .precision(4);
     oss << std::fixed;
@@ -176,20 +342,21 @@ public:
     defclass<CConf>("CConf")
     .extends<Conf>();   // derives from CConf
     
-    defclass<ShortcutMenu>("ShortcutMenu")
-    .member("shortcuts", &ShortcutMenu::shortcuts_)
+    // menus and shortcuts are numerous: their members are read using a static table
+    defclass<ShortcutMenu>("ShortcutMenu", newMenu, newMenuInArena)
+    .members(field("shortcuts", &ShortcutMenu::shortcuts_))
     .postread([](ShortcutMenu& menu) {   // done after reading children
       for (auto s : menu.shortcuts()) s->setParentMenu(&menu);
     });
 
-    defclass<Shortcut>("Shortcut")
-    .member("name", &Shortcut::name_)
-    .member("modes", readModes, writeModes)
-    .member("action", readAction, writeAction)
-    .member("feedback", readFeedback, writeFeedback)
-    .member("area", readArea, writeArea)
-    .member("nameArea", readNameArea, writeNameArea)
-    .member("submenu", readSubmenu, writeSubmenu)
+    defclass<Shortcut>("Shortcut", newShortcut, newShortcutInArena)
+    .members(field("name", &Shortcut::name_),
+             field("modes", readModes, writeModes),
+             field("action", readAction, writeAction),
+             field("feedback", readFeedback, writeFeedback),
+             field("area", readArea, writeArea),
+             field("nameArea", readNameArea, writeNameArea),
+             field("submenu", readSubmenu, writeSubmenu))
     .postread(completeShortcut);
     
     defclass<Conf::Feedback>("Feedback")
@@ -207,11 +374,77 @@ public:
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-// order matters! (because oss and iss are static variables)
-std::istringstream ConfImpl::iss;
+// order matters! (because oss is a static variable)
 std::ostringstream ConfImpl::oss;
+thread_local ConfImpl::LazyReader* ConfImpl::lazy = nullptr;
+thread_local bool ConfImpl::background = false;
 ConfImpl ConfImpl::impl;
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Submenus that were not read with the configuration file (see Conf::lazyMenus).
+// They are read by the first thread that needs them or by a background thread.
+
+namespace {
+  
+  struct UnreadMenus {
+    std::mutex mutex;
+    std::deque<ShortcutMenu*> todo;   // the background thread reads them in this order
+    std::thread warmer;
+    bool stop{false};
+    
+    ~UnreadMenus() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+      }
+      if (warmer.joinable()) warmer.join();
+    }
+    
+    // the mutex must be locked. Whatever the thread (e.g. the trackpad thread when
+    // a menu is opened), the changes made while reading are saved by the main thread.
+    void read(ShortcutMenu& menu) {
+      bool background = ConfImpl::background;
+      ConfImpl::background = true;
+      std::vector<ShortcutMenu*> created;
+      ConfImpl::readLazyMenu(menu, created);
+      todo.insert(todo.end(), created.begin(), created.end());
+      ConfImpl::background = background;
+    }
+    
+    // reads the menus in the background, one at a time so that other threads can
+    // read the menus they need without waiting.
+    void warm() {
+      while (true) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stop || todo.empty()) return;
+        ShortcutMenu* menu = todo.front();
+        todo.pop_front();
+        read(*menu);
+      }
+    }
+    
+    void start(const std::vector<ShortcutMenu*>& menus) {
+      std::lock_guard<std::mutex> lock(mutex);
+      todo.insert(todo.end(), menus.begin(), menus.end());
+      if (!todo.empty() && !warmer.joinable()) warmer = std::thread([this]{warm();});
+    }
+  };
+  
+  UnreadMenus unreadMenus;
+}
+
+void Conf::loadMenu(ShortcutMenu& menu) {
+  std::lock_guard<std::mutex> lock(unreadMenus.mutex);
+  unreadMenus.read(menu);
+}
+
+void Conf::dropMenu(ShortcutMenu& menu) {
+  std::lock_guard<std::mutex> lock(unreadMenus.mutex);
+  auto& todo = unreadMenus.todo;
+  todo.erase(std::remove(todo.begin(), todo.end(), &menu), todo.end());
+  ConfImpl::dropLazyMenu(menu);
+}
+
 CConf Conf::instance;  // Conf singleton.
 const Conf& Conf::k = CConf::instance;  // read-only access to Conf singleton.
 
@@ -229,18 +462,97 @@ std::string Conf::guideFile() {return instance.confdir + "Guides.json";}
 
 static bool copyFile(const std::string& from, const std::string& to) {
   // note: <filesystem> provides standard functions in C++17
-  std::ifstream src(from);
-  std::ofstream dst(to);
+  std::ifstream src(from, std::ios::binary);
+  std::ofstream dst(to, std::ios::binary);
   if (!src || !dst) return false;
-  char c;
-  while (src.get(c)) dst << c;
-  return true;
+  if (src.peek() != std::ifstream::traits_type::eof()) dst << src.rdbuf();
+  return bool(dst);
 }
 
 static bool fileExits(const std::string& path) {
   return std::ifstream(path).good();
 }
 
+// returns the content of a file, null if it can't be read.
+static std::shared_ptr<const std::string> readText(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return nullptr;
+  std::ostringstream out;
+  out << in.rdbuf();
+  return std::make_shared<const std::string>(out.str());
+}
+
+// returns the number of the first journal that is not included in the file.
+static unsigned long readJournalNumber(const std::string& confFile) {
+  std::ifstream in(confFile);
+  std::string line;
+  while (std::getline(in, line) && line.compare(0, 2, "//") == 0) {
+    if (line.compare(0, 12, "// Journal: ") == 0) return strtoul(line.c_str()+12, nullptr, 10);
+  }
+  return 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Changes of the configuration files made by other programs (see Conf::watchFiles()).
+
+namespace {
+  
+  struct ConfWatch {
+    // identifies a version of a file
+    struct Stamp {
+      dev_t dev; ino_t ino; off_t size; long long mtime;
+      bool operator==(const Stamp& s) const {
+        return dev == s.dev && ino == s.ino && size == s.size && mtime == s.mtime;
+      }
+    };
+    
+    std::mutex mutex;
+    std::unordered_map<std::string, Stamp> stamps;  // files as last read or written by MarkPad
+    std::unique_ptr<CConf> conf;        // read from the configuration file, not yet applied
+    ShortcutMenu* guide{nullptr};       // read from the guide file, not yet applied
+    std::atomic<bool> pending{false};
+    std::unique_ptr<FileWatcher> watcher;
+    
+    ~ConfWatch() {watcher.reset();}   // stops the watching thread first
+    
+    static bool stampOf(const std::string& path, Stamp& stamp) {
+      struct stat st;
+      if (::stat(path.c_str(), &st) < 0) return false;
+#ifdef __APPLE__
+      stamp = {st.st_dev, st.st_ino, st.st_size,
+        st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec};
+#else
+      stamp = {st.st_dev, st.st_ino, st.st_size,
+        st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec};
+#endif
+      return true;
+    }
+    
+    // _file_ is the file that was written or read, _path_ its final name.
+    void setStamp(const std::string& path, const std::string& file) {
+      Stamp stamp;
+      if (!stampOf(file, stamp)) return;
+      std::lock_guard<std::mutex> lock(mutex);
+      stamps[path] = stamp;
+    }
+    
+    void setStamp(const std::string& path) {setStamp(path, path);}
+    
+    // returns false if MarkPad knows this version of the file (e.g. because it wrote it).
+    bool updateStamp(const std::string& path) {
+      Stamp stamp;
+      if (!stampOf(path, stamp)) return false;
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = stamps.find(path);
+      if (it != stamps.end() && it->second == stamp) return false;
+      stamps[path] = stamp;
+      return true;
+    }
+  };
+  
+  ConfWatch watch;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 void CConf::read() {
@@ -249,13 +561,29 @@ void CConf::read() {
   std::string confFile = Conf::shortcutFile();
   std::string guideFile = Conf::guideFile();
   //setlocale(LC_NUMERIC, "C");  // (should not be needed now)
+  watch.setStamp(confFile);
+  watch.setStamp(guideFile);
 
   JsonSerial js(ConfImpl::impl, [&](const JsonError& e){
     e.print(errors); errors<<"\n";
     if (e.fatal) fatal = true;
   });
   
-  if (!js.read(*this, confFile)) {  // in case of an error
+  // the content of the file is kept when submenus are read when needed
+  auto text = lazyMenus ? readText(confFile) : nullptr;
+  ConfImpl::LazyReader reader{text, 0, {}};
+  MenuArena* arena = new MenuArena(256*1024);   // freed when these menus are deleted
+  bool ok;
+  if (!text) ok = js.read(*this, confFile, *arena);
+  else {
+    std::istringstream in(*text);
+    ConfImpl::lazy = &reader;
+    ok = js.read(*this, in, *arena, confFile);
+    ConfImpl::lazy = nullptr;
+  }
+  arena->close();
+  
+  if (!ok) {  // in case of an error
     if (fatal) {
       GUI::alert("Error while reading configuration","In file: "
                  +confFile+"\n" + errors.str());
@@ -273,41 +601,174 @@ void CConf::read() {
     if (m->isMainMenu()) mainMenu_ = m;
   }
   
+  // replay the changes that were made after the file was saved
+  if (Journal::instance.open(mainMenu_, readJournalNumber(confFile)) > 0) mustSave();
+  
   errors.clear();
   
   // read guide file
-  if (!js.read(MarkPad::instance.guide_, guideFile)) {
+  arena = new MenuArena;
+  if (!js.read(MarkPad::instance.guide_, guideFile, *arena)) {
     GUI::alert("Error while reading Guides","In file: "+guideFile+"\n" + errors.str(), "OK");
   }
+  arena->close();
   
   if (MarkPad::instance.guide_) {
     // guide must be a main menu otherwise we'll face incoherencies
     MarkPad::instance.guide_->setMainMenu();
   }
+  
+  // the submenus that were not used yet are read in the background
+  unreadMenus.start(reader.created);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool Conf::writeShortcut(const Shortcut& s, std::ostream& out) {
+  JsonSerial js(ConfImpl::impl, [](const JsonError&){});
+  js.setIndent(' ', 0);
+  return js.writeFragment(s, out, 0);
+}
+
+Shortcut* Conf::readShortcut(std::istream& in) {
+  Shortcut* s = nullptr;
+  JsonSerial js(ConfImpl::impl, [](const JsonError&){});
+  if (!js.read(s, in) && s) {delete s; s = nullptr;}
+  return s;
+}
+
+bool Conf::readConf(CConf& conf, std::istream& in, const std::string& streamname,
+                    std::string& errors, MenuArena* arena) {
+  ostringstream err;
+  JsonSerial js(ConfImpl::impl, [&err](const JsonError& e){e.print(err); err<<"\n";});
+  bool ok = arena ? js.read(conf, in, *arena, streamname) : js.read(conf, in, streamname);
+  // compatibility
+  for (ShortcutMenu* m : conf.menus_) {
+    if (m->isMainMenu()) conf.mainMenu_ = m;
+  }
+  errors = err.str();
+  return ok;
+}
+
+bool Conf::writeConf(const Conf& conf, std::ostream& out, std::string& errors) {
+  ostringstream err;
+  out.precision(4); // 4 digits after decimal for floats
+  out << std::fixed;
+  JsonSerial js(ConfImpl::impl, [&err](const JsonError& e){e.print(err); err<<"\n";});
+  bool ok = js.write(conf, out);
+  errors = err.str();
+  return ok;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 void Conf::mustSave() {
-  instance.changed_ = true;
+  if (ConfImpl::background) Services::postpone([]{instance.changed_ = true;});
+  else instance.changed_ = true;
+}
+
+void Conf::mustSave(ShortcutMenu* menu) {
+  if (!menu) instance.changed_ = true;
+  else {
+    menu->setChanged();
+    instance.menuChanged_ = true;
+  }
 }
 
 void Conf::saveIfNeeded() {
-  if (instance.changed_) {
-    instance.changed_ = false;
-    instance.write();
+  if (instance.changed_ || instance.menuChanged_) {
+    bool all = instance.changed_;
+    instance.changed_ = instance.menuChanged_ = false;
+    instance.write(all);
   }
   if (Conf::k.logData) {
     MarkPad::instance.currentPad()->dataLogger().saveGestures();
   }
 }
 
-void Conf::write() {
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Layout of the configuration file: where each menu was written in the file.
+// Makes it possible to only reserialize the menus that were changed.
+
+namespace {
+  
+  struct ConfLayout {
+    struct Range {size_t begin, end; int level;};
+    std::string image;  // content of the file as it was last written
+    std::unordered_map<const ShortcutMenu*, Range> menus;
+    std::thread saver;  // saves the file in the background
+    
+    ~ConfLayout() {wait();}
+    
+    void clear() {image.clear(); menus.clear();}
+    
+    // waits until the previous background save is completed.
+    void wait() {if (saver.joinable()) saver.join();}
+    
+    // records the positions of the menus when they are written.
+    JsonSerial::Recorder recorder(std::vector<std::pair<const ShortcutMenu*,Range>>& ranges) {
+      return [&ranges](const MetaClass& cl, const void* obj, size_t begin, size_t end, int level) {
+        if (cl.classname() == "ShortcutMenu")
+          ranges.push_back({static_cast<const ShortcutMenu*>(obj), Range{begin, end, level}});
+      };
+    }
+  };
+  
+  ConfLayout layout;
+}
+
+// the header has a fixed size so that the journal number can be changed in place.
+static std::string confHeader(unsigned long journal) {
+  char num[32];
+  snprintf(num, sizeof(num), "%010lu", journal);
+  return std::string("// MarkPad Configuration File\n")
+  + "// Must be located in ~/Library/MarkPad/\n"
+  + "// Journal: " + num + "\n";
+}
+
+// writes a temporary file then renames it so that the file is never partially written.
+static bool saveImage(const std::string& image, const std::string& confFile) {
+  std::string tmp = confFile + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  const char* p = image.data();
+  size_t count = image.size();
+  bool ok = true;
+  while (ok && count > 0) {
+    ssize_t n = ::write(fd, p, count);
+    if (n < 0) {if (errno != EINTR) ok = false;}
+    else {p += n; count -= n;}
+  }
+  ok = ok && Journal::sync(fd);
+  ::close(fd);
+  if (ok) watch.setStamp(confFile, tmp);  // not a change made by another program
+  ok = ok && ::rename(tmp.c_str(), confFile.c_str()) == 0;
+  if (!ok) ::unlink(tmp.c_str());
+  return ok;
+}
+
+// the outermost menus that were changed (their submenus are rewritten with them).
+static void findChangedMenus(ShortcutMenu* menu, std::vector<ShortcutMenu*>& changed) {
+  if (!menu || !menu->isLoaded()) return;  // menus that were not read were not changed
+  if (menu->isChanged()) {changed.push_back(menu); return;}
+  for (auto s : menu->shortcuts()) findChangedMenus(s->menu(), changed);
+}
+
+static void clearChangedMenus(ShortcutMenu* menu) {
+  if (!menu || !menu->isLoaded()) return;
+  menu->setChanged(false);
+  for (auto s : menu->shortcuts()) clearChangedMenus(s->menu());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void Conf::write(bool all) {
   std::string confFile = Conf::shortcutFile();
   std::string guideFile = Conf::guideFile();
   
   if (!previousConfSaved_) {  // save previous configuration file first
     previousConfSaved_ = true;
+    layout.wait();
     ifstream f(confFile);
     if (f) {
       copyFile(confFile, confFile+"~");
@@ -315,31 +776,24 @@ void Conf::write() {
     }
   }
   
-  ofstream fout(confFile);
-  if (!fout) {
-    // alert() will appear below the overlay if the editor is opened!
-    MarkPad::instance.edit(MarkPad::EditNone);
-    GUI::alert("Can't save configuration","Can't open file: "+confFile);
-    return;
+  auto& journal = Journal::instance;
+  if (all || !journal.isOpen()) {
+    // the whole file is rewritten when Conf variables were changed
+    if (!writeAll(confFile)) return;
   }
-  
-  fout.precision(4); // 4 digits after decimal for floats
-  fout << std::fixed;
-  fout << "// MarkPad Configuration File\n"
-  << "// Must be located in ~/Library/MarkPad/\n" << endl;
-  
-  ostringstream errors;
-  JsonSerial js(ConfImpl::impl, [&errors](const JsonError& e){e.print(errors); errors<<"\n";});
-  
-  if (!js.write(*this, fout)) {
-    MarkPad::instance.edit(MarkPad::EditNone);
-    GUI::alert("Could not save configuration","Error in file: "+confFile +"\n" + errors.str());
+  else {
+    // changes are in the journal: the file is only rewritten when the journal
+    // becomes too large (and every time if data is logged)
+    journal.flush();
+    if (journal.size() > journalMaxSize || Conf::k.logData) compact(confFile, !Conf::k.logData);
   }
   
   // save Guides.json if it was edited
   if (MarkPad::instance.guideChanged_) {
-    errors.clear();    
-    if (!js.write(MarkPad::instance.guide(), guideFile)) {
+    ostringstream errors;
+    std::string image;
+    JsonSerial js(ConfImpl::impl, [&errors](const JsonError& e){e.print(errors); errors<<"\n";});
+    if (!js.writeBuffer(MarkPad::instance.guide(), image) || !saveImage(image, guideFile)) {
       MarkPad::instance.edit(MarkPad::EditNone);
       GUI::alert("Guides could not be saved","Error in file: "+guideFile+"\n" + errors.str());
     }
@@ -354,6 +808,272 @@ void Conf::write() {
   }
 }
 
+bool Conf::writeAll(const std::string& confFile) {
+  std::vector<std::pair<const ShortcutMenu*,ConfLayout::Range>> ranges;
+  ostringstream errors;
+  
+  // the new file will contain all the changes of the current journal
+  unsigned long journal = Journal::instance.rotate();
+  std::string image = confHeader(journal) + "\n";
+  
+  // the file is serialized in memory, the positions of the recorder are those of the image
+  JsonSerial js(ConfImpl::impl, [&errors](const JsonError& e){e.print(errors); errors<<"\n";});
+  js.setPrecision(4, true); // 4 digits after decimal for floats
+  js.setRecorder(layout.recorder(ranges));
+  bool ok = js.writeBuffer(*this, image);
+  
+  layout.wait();
+  layout.clear();
+  
+  if (!ok) {
+    // the file is not saved: the journals still contain the changes
+    MarkPad::instance.edit(MarkPad::EditNone);
+    GUI::alert("Could not save configuration","Error in file: "+confFile +"\n" + errors.str());
+    return true;
+  }
+  
+  layout.image = std::move(image);
+  if (!saveImage(layout.image, confFile)) {
+    layout.clear();
+    // alert() will appear below the overlay if the editor is opened!
+    MarkPad::instance.edit(MarkPad::EditNone);
+    GUI::alert("Can't save configuration","Can't write file: "+confFile);
+    return false;
+  }
+  
+  for (auto& it : ranges) layout.menus[it.first] = it.second;
+  clearChangedMenus(mainMenu_);
+  Journal::removeBefore(journal);
+  return true;
+}
+
+void Conf::compact(const std::string& confFile, bool async) {
+  if (!spliceChangedMenus()) {
+    writeAll(confFile);
+    return;
+  }
+  // the new file will contain all the changes of the current journal
+  unsigned long journal = Journal::instance.rotate();
+  std::string header = confHeader(journal);
+  layout.image.replace(0, header.size(), header);
+  layout.wait();
+  
+  if (!async) {
+    if (saveImage(layout.image, confFile)) Journal::removeBefore(journal);
+  }
+  else {
+    // if saving fails, the journals are kept and will be replayed
+    layout.saver = std::thread([journal, confFile](std::string image) {
+      if (saveImage(image, confFile)) Journal::removeBefore(journal);
+    }, layout.image);
+  }
+}
+
+// replaces the menus that were changed in the image of the file.
+// Returns false if the whole configuration must be reserialized.
+bool Conf::spliceChangedMenus() {
+  using Range = ConfLayout::Range;
+  if (!mainMenu_ || layout.image.empty()) return false;
+  
+  std::vector<ShortcutMenu*> changed;
+  findChangedMenus(mainMenu_, changed);
+  if (changed.empty()) return true;
+  
+  std::vector<std::pair<ShortcutMenu*,Range>> todo;
+  for (auto m : changed) {
+    auto it = layout.menus.find(m);
+    if (it == layout.menus.end()) return false;  // new menu: not in the file
+    todo.push_back({m, it->second});
+  }
+  
+  // last menus first: the positions of the previous ones remain valid
+  std::sort(todo.begin(), todo.end(), [](const std::pair<ShortcutMenu*,Range>& a,
+                                         const std::pair<ShortcutMenu*,Range>& b) {
+    return a.second.begin > b.second.begin;
+  });
+  
+  std::vector<std::pair<const ShortcutMenu*,Range>> ranges;
+  JsonSerial js(ConfImpl::impl, [](const JsonError&){});
+  js.setRecorder(layout.recorder(ranges));
+  
+  for (auto& it : todo) {
+    Range r = it.second;
+    ostringstream out;
+    out.precision(4);
+    out << std::fixed;
+    ranges.clear();
+    if (!js.writeFragment(*it.first, out, r.level)) {layout.clear(); return false;}
+    std::string text = out.str();
+    long delta = long(text.size()) - long(r.end - r.begin);
+    
+    // forgets the submenus that were written in this range, shifts the following menus
+    for (auto m = layout.menus.begin(); m != layout.menus.end(); ) {
+      Range& mr = m->second;
+      if (mr.begin >= r.begin && mr.end <= r.end) m = layout.menus.erase(m);
+      else {
+        if (mr.begin >= r.end) mr.begin += delta;
+        if (mr.end >= r.end) mr.end += delta;
+        ++m;
+      }
+    }
+    for (auto& sub : ranges) {
+      layout.menus[sub.first] = Range{r.begin + sub.second.begin, r.begin + sub.second.end,
+        sub.second.level};
+    }
+    layout.image.replace(r.begin, r.end - r.begin, text);
+  }
+  
+  for (auto m : changed) clearChangedMenus(m);
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// called by the watching thread: the file is read in this thread, the changes are
+// applied in the main thread by applyFileChanges().
+static void fileChanged(const std::string& path) {
+  ConfImpl::background = true;
+  if (!watch.updateStamp(path)) return;  // not changed or written by MarkPad
+  std::string errors;
+  std::ifstream in(path);
+
+  if (path == Conf::shortcutFile()) {
+    std::unique_ptr<CConf> conf(new CConf);
+    MenuArena* arena = new MenuArena(256*1024);   // freed when these menus are deleted
+    bool ok = in && Conf::readConf(*conf, in, path, errors, arena);
+    arena->close();
+    if (!ok || !conf->mainMenu_) {
+      // the file will be read again when the other program has finished writing it
+      delete conf->mainMenu_;
+      MarkPad::warning("while reloading configuration\nIn file: "+path+"\n"+errors);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    if (watch.conf) delete watch.conf->mainMenu_;  // not applied, replaced by this version
+    watch.conf = std::move(conf);
+  }
+  else if (path == Conf::guideFile()) {
+    ShortcutMenu* guide = nullptr;
+    ostringstream err;
+    JsonSerial js(ConfImpl::impl, [&err](const JsonError& e){e.print(err); err<<"\n";});
+    MenuArena* arena = new MenuArena;
+    bool ok = in && js.read(guide, in, *arena, path);
+    arena->close();
+    if (!ok || !guide) {
+      delete guide;
+      MarkPad::warning("while reloading Guides\nIn file: "+path+"\n"+err.str());
+      return;
+    }
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    delete watch.guide;
+    watch.guide = guide;
+  }
+  else return;
+  
+  watch.pending = true;
+  Services::postpone(Conf::applyFileChanges);
+}
+
+void Conf::watchFiles(bool state) {
+  if (!state) {watch.watcher.reset(); return;}
+  if (watch.watcher) return;
+  watch.watcher.reset(new FileWatcher(fileChanged));
+  watch.watcher->add(shortcutFile());
+  watch.watcher->add(guideFile());
+  if (!watch.watcher->start()) {
+    watch.watcher.reset();
+    MarkPad::warning("Configuration files can't be watched on this system");
+  }
+}
+
+bool Conf::hasFileChanges() {
+  return watch.pending;
+}
+
+// settings that are used to init the GUI (theme, hotkeys, background image...)
+// will only take effect when MarkPad is restarted.
+static void copySettings(Conf& to, const Conf& from) {
+  to.fileVersion = from.fileVersion;
+  to.developerMode = from.developerMode;
+  to.allowAccessibility = from.allowAccessibility;
+  to.logData = from.logData;
+  to.showHotkey = from.showHotkey;
+  to.editHotkey = from.editHotkey;
+  to.theme = from.theme;
+  to.mediaHost = from.mediaHost;
+  to.activeBorders = from.activeBorders;
+  to.menuDelay = from.menuDelay;
+  to.minMovement = from.minMovement;
+  to.minTouchSize = from.minTouchSize;
+  to.maxTouchSize = from.maxTouchSize;
+  to.showBgImage = from.showBgImage;
+  to.bgImage = from.bgImage;
+  to.showFeedback = from.showFeedback;
+  to.feedback = from.feedback;
+  to.showFingers = from.showFingers;
+  to.showGrid = from.showGrid;
+}
+
+void Conf::applyFileChanges() {
+  auto& mp = MarkPad::instance;
+  if (!watch.pending) return;
+  
+  // the current gesture is not interrupted: this function is called again when it ends
+  if (mp.isEditing() || mp.isCreatingShortcut()) return;
+  for (auto pad : mp.getPads()) {
+    if (pad->isTouched()) return;
+  }
+  
+  std::unique_ptr<CConf> conf;
+  ShortcutMenu* guide = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    conf = std::move(watch.conf);
+    std::swap(guide, watch.guide);
+    watch.pending = false;
+  }
+  ConfImpl::Patch patch;
+  
+  if (conf) {
+    if (instance.mainMenu_) {
+      copySettings(instance, *conf);
+      for (auto pad : mp.getPads()) pad->initActiveBorders();
+      ConfImpl::patchMenu(*instance.mainMenu_, *conf->mainMenu_, patch);
+      
+      // the file contains all the changes: the image and the journals are obsolete
+      layout.wait();
+      layout.clear();
+      unsigned long journal = Journal::instance.rotate();
+      Journal::removeBefore(journal);
+      // journals are replayed from the number in the file at startup (0 if the other
+      // program did not write it): the file must be rewritten with this one.
+      if (readJournalNumber(shortcutFile()) != journal) mustSave();
+    }
+    delete conf->mainMenu_;
+  }
+  
+  if (guide) {
+    if (!mp.guide_) {
+      guide->setMainMenu();
+      mp.guide_ = guide;
+    }
+    else {
+      ConfImpl::patchMenu(*mp.guide_, *guide, patch);
+      delete guide;
+    }
+  }
+  
+  if (patch.changes == 0) return;
+  
+  // the removed shortcuts may be selected
+  mp.setCurrentMenu();
+  mp.clearMultiSelection();
+  for (auto s : patch.removed) delete s;
+  for (auto m : patch.removedMenus) delete m;
+  if (mp.isOverlayShown()) GUI::instance.updateOverlay();
+  MarkPad::info("Configuration reloaded: " + std::to_string(patch.changes) + " changes");
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 // creates the directory that contains the configuration file.
@@ -10,9 +10,11 @@
 #ifndef MarkPad_Conf
 #define MarkPad_Conf
  
+#include <iosfwd>
 #include <string>
 #include <vector>
 #include "MTouch.h"
+class MenuArena;
 
 /// MarkPad configuration.
 class Conf {
@@ -36,10 +38,48 @@ public:
 
   /// requests the configuration to be saved (when saveIfNeeded() will be called).
   static void mustSave();
+
+  /// requests this menu to be saved: only the menus that were changed will be rewritten.
+  /// Same as mustSave() if _menu_ is null.
+  static void mustSave(class ShortcutMenu* menu);
   
   /// saves the configuration (only if mustSave() was previously called).
   static void saveIfNeeded();
 
+  /// writes/reads a shortcut and its submenu in JSON format (used by the Journal).
+  static bool writeShortcut(const class Shortcut&, std::ostream&);
+  static class Shortcut* readShortcut(std::istream&);
+
+  /// reads the content of a submenu that was not read with the configuration file
+  /// (called by ShortcutMenu::load(), see lazyMenus).
+  static void loadMenu(class ShortcutMenu&);
+  
+  /// called when a submenu which content was not read is destroyed.
+  static void dropMenu(class ShortcutMenu&);
+
+  /// reads a configuration in JSON format, menus are allocated in _arena_ if not null.
+  /// Returns false and a description in _errors_ in case of an error.
+  static bool readConf(class CConf&, std::istream&, const std::string& streamname,
+                       std::string& errors, MenuArena* arena = nullptr);
+
+  /// writes a configuration in JSON format (without the header of the configuration file).
+  static bool writeConf(const Conf&, std::ostream&, std::string& errors);
+
+  /// watches the configuration and guide files: changes made by other programs
+  /// (e.g. provisioning scripts) are read in the background then applied by
+  /// applyFileChanges().
+  static void watchFiles(bool state);
+
+  /// true if changes of the configuration files were read but not yet applied.
+  static bool hasFileChanges();
+
+  /// applies the changes of the configuration files to the live configuration:
+  /// only the shortcuts and menus that were changed are updated.
+  /// Must be called in the main thread. Does nothing while a gesture is performed
+  /// or the menus are edited (the changes are then applied later). The files take
+  /// precedence over the changes that were made in MarkPad in the meantime.
+  static void applyFileChanges();
+
   /// changes the value of a variable, calls mustSave() if its value was changed.
   template <typename T>
   static void change(T Conf::*variable, const T& value);
@@ -119,6 +159,11 @@ public:
   MTFloat nameSpacing{0.004f};              ///< min spacing around the shortcut name.
   float   stepperIncrement{0.001f};         ///< increment of NSSteppers
   double  doubleClickDelay{0.35};  ///< delay between 2 mouse clicks for a doubleclick.
+  size_t  journalMaxSize{256*1024};  ///< the journal is compacted when larger than this.
+  
+  /// submenus are read from the configuration file when they are first used
+  /// (or by a background thread once the file is read).
+  bool    lazyMenus{true};
   
 protected:
   friend class MarkPad;
@@ -131,10 +176,15 @@ protected:
   /// must be called from main().
   void init(const std::string& execpath);
 
-  /// writes the configuration file.
-  void write();
+  /// writes the configuration file, only rewrites the changed menus if _all_ is false.
+  void write(bool all = true);
+  bool writeAll(const std::string& confFile);
+  
+  /// saves the shortcuts that are in the journal in the configuration file.
+  void compact(const std::string& confFile, bool async);
+  bool spliceChangedMenus();
 
-  bool changed_{false}, previousConfSaved_{false};
+  bool changed_{false}, menuChanged_{false}, previousConfSaved_{false};
   std::string confdir, resdir, execpath;    ///< see corresponding methods.
 };
 
@@ -8,39 +8,36 @@
 //
 
 #include <iostream>
-#include <thread>
+#include <mutex>
 #include "ccuty/ccstring.hpp"
 #include "ccuty/ccpath.hpp"
-#include "ccuty/ccsocket.hpp"
+#include "ccuty/cclineconnection.hpp"
+#include "ccuty/ccscripthost.hpp"
+#include "ccuty/ccstringswitch.hpp"
 #include "Conf.h"
 #include "MarkPad.h"
 #include "CurrentAction.h"
 #include "Services.h"
+#include "DesktopState.h"
 using namespace ccuty;
 using namespace std;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-void CurrentAction::exec(Shortcut& s, const MTTouch& touch_, Shortcut::State touchstate_) {
-  action = s.action();
-  if (!action) return;
-  
-  int cmd = s.comindex_;
-  if (cmd >= 0 && cmd < int(action->commands.size())) command = &action->commands[cmd];
-  else command = nullptr;
-  
-  status = OK;
-  shortcut = &s;
-  touch = touch_;
-  touchstate = touchstate_;
-  feedback.clear();
+ActionContext::ActionContext(const Shortcut& s, const MTTouch& t, Shortcut::State state) :
+name(s.name()), arg(s.arg()), modifiers(s.modifiers()), action(s.action()),
+command(action ? action->command(s) : nullptr), handler(s.handler()), args(s.args()),
+touch(t), touchstate(state) {}
+
+bool CurrentAction::exec(const ActionContext& c, ActionResult& r) {
+  if (!c.handler) return false;
   std::string f;
   
   try {
-    if (action->fun) (action->fun)(); else throw 1;
+    c.handler(*this, c, r);   // found when the action was set (see resolve())
     
-    if (status == Error) throw 1;
-    else return; 
+    if (r.status == ActionResult::Error) throw 1;
+    else return true;
 
     /*
     // if 's.feedback' is defined
@@ -58,8 +55,8 @@ void CurrentAction::exec(Shortcut& s, const MTTouch& touch_, Shortcut::State tou
      */
   }
   catch (...) {
-    f = "Invalid Action: "+s.name()+" "+s.arg();
-    return;
+    f = "Invalid Action: "+c.name+" "+c.arg;
+    return false;
   }
 
   // aucun de ces solutions ne marche avec Mojave !!!
@@ -74,56 +71,68 @@ void CurrentAction::exec(Shortcut& s, const MTTouch& touch_, Shortcut::State tou
 string CurrentAction::getFile(const string& file) {
   if (file != Actions::CurrentFile) return file;
   string f;
-  if (!Services::getFinderFile(f) || f.empty()) return "";
+  if (!DesktopState::instance.getFinderFile(f) || f.empty()) return "";
   else return f;
 }
 
 string CurrentAction::getApp(const string& app) {
   if (app != Actions::CurrentApp) return app;
   string a;
-  if (!Services::getFrontAppName(a) || a.empty()) return "";
+  if (!DesktopState::instance.getFrontAppName(a) || a.empty()) return "";
   else return a;
 }
 
-unsigned long long int CurrentAction::getAppID(const string& app) {
-  if (app != Actions::CurrentApp) return strid(tolower(app));
+// apps that have specific commands (see previousItem(), nextItem(), etc.)
+static constexpr auto appNames = ccuty::make_stringswitch
+("chrome", "google chrome", "safari", "itunes", "macmote", "music", "dvd player");
+
+int CurrentAction::getAppID(const string& app) {
+  if (app != Actions::CurrentApp) return appNames(tolower(app));
   string a;
-  if (!Services::getFrontAppName(a) || a.empty()) return 0;
-  else return strid(tolower(a));
+  if (!DesktopState::instance.getFrontAppName(a) || a.empty()) return -1;
+  else return appNames(tolower(a));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-void CurrentAction::doOpen() {
-  const string& sarg = shortcut->arg();
-  
-  switch (strid(command->name)) {
-    case strid("openhideapp"):
-      openHideApp(ccuty::basename(sarg, false));  // no extension!
-      break;
-      
-    case strid("openapp"):
-      openApp(sarg);
-      break;
-      
-    case strid("openurl"):
-      Services::openUrl(sarg);
-      break;
-      
-    case strid("openfile"):
-      Services::openFile(sarg);
-      break;
-      
-    case strid("opensysdir"): {
-      //std::vector<string> v;
-      Services::openApp("Finder");
-      //auto n = ccuty::strsplit(v, sarg, "()");
-      //if (n >= 2) Services::sendModChars(v[1]);
-      Services::sendModChars(sarg);
-      } break;
+void CurrentAction::launch(const std::vector<std::string>& argv, ActionResult& r) {
+  if (!launcher.spawn(argv)) r.status = ActionResult::Error;
+}
+
+// AppleScripts are compiled once by persistent hosts (see mac/scripthost.mm), one per
+// worker of Actions::executor so that a long user script does not block the others
+static ccuty::ScriptHost& scriptHost() {
+  static ccuty::ScriptHost host({Services::getResourceDir() + "scripthost"}, 30000, 3);
+  return host;
+}
+
+void CurrentAction::runAppleScript(const std::string& source, ActionResult& r) {
+  auto& host = scriptHost();
+  string output;
+  if (host.isAvailable() && host.run(source, {}, output)) return;
+  if (host.isAvailable()) r.status = ActionResult::Error;   // error in the script
+  else launch({"osascript", "-e", source}, r);
+}
+
+void CurrentAction::runScriptFile(const std::string& path, const std::vector<std::string>& args,
+                                  ActionResult& r) {
+  auto& host = scriptHost();
+  string output;
+  if (host.isAvailable() && host.runFile(path, args, output)) return;
+  if (host.isAvailable()) r.status = ActionResult::Error;
+  else {
+    std::vector<std::string> argv{"osascript", path};
+    argv.insert(argv.end(), args.begin(), args.end());
+    launch(argv, r);
   }
 }
 
+void CurrentAction::tellApp(const std::string& app, const std::string& command, ActionResult& r) {
+  if (!app.empty()) runAppleScript("tell application \"" + app + "\" to " + command, r);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
 void CurrentAction::openApp(const std::string& appname) {
   if (appname.empty()) return;
   string app, apparg;
@@ -132,298 +141,360 @@ void CurrentAction::openApp(const std::string& appname) {
   else if (n == 2) Services::openApp(app, getFile(apparg));
 }
 
-void CurrentAction::openHideApp(const std::string& appname) {
+void CurrentAction::openHideApp(const std::string& appname, const ActionContext& c,
+                                ActionResult& r) {
   if (appname.empty()) return;
-  string app;
-  if ((Services::getFrontAppPath(app) && app == appname)
-      || (Services::getFrontAppName(app) && app == appname)
+  string name, path;
+  if (DesktopState::instance.getFrontApp(name, path)
+      && (path == appname || name == appname)
       ) {        // this is the frontmost app +> hide it
     Services::hideApp(appname);
-    feedback = "Hide " + shortcut->name();
+    r.feedback = "Hide " + c.name;
   }
   else {
     Services::openApp(appname);   // not the frontmost app => open it
-    feedback = "Open " + shortcut->name();
+    r.feedback = "Open " + c.name;
   }
 }
 
-void CurrentAction::doWindow() {
-  if (!command) return;
-  switch (strid(command->name)) {
-    case strid("fullscreen"):
-      Services::sendChar('f', Modifiers::Command|Modifiers::Control);
+int CurrentAction::getAppID(const ActionContext& c) {
+  return c.args.currentApp ? getAppID(Actions::CurrentApp) : c.args.appid;
+}
+
+// apps where Redo is ⌘Y
+static constexpr auto redoApps = ccuty::make_stringswitch
+("Microsoft Word", "Microsoft Excel", "Microsoft PowerPoint");
+
+void CurrentAction::redoKey() {
+  string app;
+  if (!DesktopState::instance.getFrontAppName(app)) return;
+  if (redoApps(app) >= 0) Services::sendChar('y', Modifiers::Command);
+  else Services::sendChar('z', Modifiers::Command|Modifiers::Shift);
+}
+
+void CurrentAction::setVolume(const ActionArgs& vol, ActionResult& r) {
+  if (connected()) {
+    if (vol.volumeMode == ActionArgs::MuteVolume) {r.feedback = "Media mute"; macmote("mute");}
+    else if (vol.volumeMode != ActionArgs::ChangeVolume) return;
+    else if (vol.volume > 0) {r.feedback = "Media vol+"; macmote("vol+");}
+    else {r.feedback = "Media vol-"; macmote("vol-");}
+  }
+  else switch (vol.volumeMode) {
+    case ActionArgs::ChangeVolume: Services::changeVolume(vol.volume); break;
+    case ActionArgs::SetVolume: Services::setVolume(vol.volume); break;
+    case ActionArgs::MuteVolume: Services::muteVolume(); break;
+    case ActionArgs::NoVolume: break;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Action handlers (see CurrentAction::resolve())
+
+using Handler = ActionHandler;
+using Ctx = const ActionContext;
+using Res = ActionResult;
+
+static void doNothing(CurrentAction&, Ctx&, Res&) {}
+
+// Open URL, File or Application
+
+static void openOrHideApp(CurrentAction& a, Ctx& c, Res& r) {a.openHideApp(c.args.app, c, r);}
+static void openAppWithFile(CurrentAction& a, Ctx& c, Res&) {a.openApp(c.arg);}
+static void openUrl(CurrentAction&, Ctx& c, Res&) {Services::openUrl(c.arg);}
+static void openFile(CurrentAction&, Ctx& c, Res&) {Services::openFile(c.arg);}
+
+static void openSysDir(CurrentAction&, Ctx& c, Res&) {
+  Services::openApp("Finder");
+  Services::sendModChars(c.arg);
+}
+
+// Zoom and Windows, Desktop Commands
+
+static void fullScreen(CurrentAction&, Ctx&, Res&) {
+  Services::sendChar('f', Modifiers::Command|Modifiers::Control);
+}
+
+static void zoom(CurrentAction&, Ctx& c, Res&) {
+  Services::sendChar(c.args.command.empty() ? '+' : c.args.command[0], Modifiers::Command);
+}
+
+static void unzoom(CurrentAction&, Ctx&, Res&) {Services::sendChar('-', Modifiers::Command);}
+
+static void resizeWindow(CurrentAction& a, Ctx& c, Res& r) {
+  a.runScriptFile(Conf::scriptDir()+"resize_window.scpt", {c.args.command}, r);
+}
+
+static void changeVolume(CurrentAction& a, Ctx& c, Res& r) {a.setVolume(c.args, r);}
+
+static void appWindows(CurrentAction& a, Ctx&, Res& r) {
+  a.launch({"open", "-a", "mission control", "--args", "2"}, r);
+}
+
+static void nextWindow(CurrentAction&, Ctx&, Res&) {Services::sendChar('`', Modifiers::Command);}
+static void missionControl(CurrentAction&, Ctx&, Res&) {Services::openApp("mission control");}
+
+static void desktop(CurrentAction& a, Ctx&, Res& r) {
+  a.launch({"open", "-a", "mission control", "--args", "1"}, r);
+}
+
+static void dock(CurrentAction&, Ctx&, Res&) {   // "⌘⌥d"
+  Services::sendChar('d', Modifiers::Command|Modifiers::Alt);
+}
+
+static void grabScreen(CurrentAction&, Ctx&, Res&) {
+  Services::sendChar('3', Modifiers::Command|Modifiers::Shift);
+}
+
+static void grabSelection(CurrentAction&, Ctx&, Res&) {   // "⌘⇧4"
+  Services::sendChar('4', Modifiers::Command|Modifiers::Shift);
+}
+
+// Application Hotkeys
+
+static void redo(CurrentAction& a, Ctx&, Res&) {a.redoKey();}
+static void userHotkey(CurrentAction&, Ctx& c, Res&) {Services::sendChars(c.arg, c.modifiers);}
+static void hotkey(CurrentAction&, Ctx& c, Res&) {Services::sendModChars(c.command->arg);}
+
+// Extended Copy & Paste
+
+static void pasteString(CurrentAction&, Ctx& c, Res&) {Services::pasteString(c.arg);}
+static void copyWithoutStyle(CurrentAction&, Ctx&, Res&) {Services::copyWithoutStyle();}
+static void pasteWithoutStyle(CurrentAction&, Ctx&, Res&) {Services::pasteWithoutStyle();}
+static void store(CurrentAction&, Ctx& c, Res&) {Services::copyToBuffer(c.arg);}
+static void retrieve(CurrentAction&, Ctx& c, Res&) {Services::pasteFromBuffer(c.arg);}
+static void cutKey(CurrentAction&, Ctx&, Res&) {Services::sendChar('x', Modifiers::Command);}
+static void copyKey(CurrentAction&, Ctx&, Res&) {Services::sendChar('c', Modifiers::Command);}
+static void pasteKey(CurrentAction&, Ctx&, Res&) {Services::sendChar('v', Modifiers::Command);}
+
+// Commands for iTunes, Chrome, Safari, etc., AppleScript and Unix Commands
+
+static void appCommand(CurrentAction& a, Ctx& c, Res& r) {a.tellApp(c.args.app, c.args.command, r);}
+static void macmoteCommand(CurrentAction& a, Ctx& c, Res&) {a.macmote(c.args.command);}
+
+static void musicCommand(CurrentAction& a, Ctx& c, Res& r) {
+  if (a.connected()) a.macmote(c.args.command);
+  else a.tellApp("iTunes", c.args.command, r);
+}
+
+static void appleScript(CurrentAction& a, Ctx& c, Res& r) {a.runAppleScript(c.arg, r);}
+static void unixCommand(CurrentAction& a, Ctx& c, Res& r) {a.launch({"/bin/sh", "-c", c.arg}, r);}
+static void scriptFile(CurrentAction& a, Ctx& c, Res& r) {a.runScriptFile(c.args.app, c.args.argv, r);}
+
+static void quitApp(CurrentAction& a, Ctx& c, Res& r) {
+  a.tellApp(c.args.app.empty() ? a.getApp(Actions::CurrentApp) : c.args.app, "quit", r);
+}
+
+static void previousItem(CurrentAction& a, Ctx& c, Res& r) {
+  switch (a.getAppID(c)) {
+    case appNames.id("chrome"):
+    case appNames.id("google chrome"):
+      a.tellApp("Google Chrome","go back active tab of front window", r);
       break;
-      
-    case strid("resize"):
-      if (shortcut->arg() == "fullscreen")
-        Services::sendChar('f', Modifiers::Command|Modifiers::Control);
-      else if (shortcut->arg() == "zoom")
-        Services::sendChar('+', Modifiers::Command);
-      else if (shortcut->arg() == "unzoom")
-        Services::sendChar('+', Modifiers::Command);
-      else
-        system("osascript "+Conf::scriptDir()+"resize_window.scpt "
-               + tolower(shortcut->arg()));
+    case appNames.id("safari"):
+      Services::sendKeycode(123, Modifiers::Command); // command left arrow
       break;
-      
-    case strid("zoom"):
-      if (shortcut->arg().empty()) Services::sendChar('+', Modifiers::Command);
-      else Services::sendChar(shortcut->arg()[0], Modifiers::Command);
+    case appNames.id("itunes"):
+      a.tellApp("iTunes","back track", r);
       break;
-    
-    case strid("unzoom"):  // compat
-      Services::sendChar('-', Modifiers::Command);
+    case appNames.id("macmote"):
+      if (a.connected()) a.macmote("previous");
       break;
-    
-    case strid("volume"):
-      setVolume(shortcut->arg());
+    case appNames.id("music"):
+      if (a.connected()) a.macmote("previous");
+      else a.tellApp("iTunes","back track", r);
       break;
-    
-    case strid("appwins"):
-      system("open -a \"mission control\" --args 2");
-      break;
-    
-    case strid("nextwin"):
-      Services::sendChar('`', Modifiers::Command);
+    case appNames.id("dvd player"):
+      a.tellApp("DVD Player","play previous chapter", r);
       break;
-    
-    case strid("mcontrol"):
-      Services::openApp("mission control");
+  }
+}
+
+static void nextItem(CurrentAction& a, Ctx& c, Res& r) {
+  switch (a.getAppID(c)) {
+    case appNames.id("chrome"):
+    case appNames.id("google chrome"):
+      //Services::sendChar(']', Modifiers::Command);
+      a.tellApp("Google Chrome","go forward active tab of front window", r);
       break;
-    
-    case strid("desktop"):
-      system("open -a \"mission control\" --args 1");
+    case appNames.id("safari"):
+      Services::sendKeycode(124, Modifiers::Command); // command left arrow
       break;
-    
-    case strid("dock"):
-      // "⌘⌥d";
-      Services::sendChar('d', Modifiers::Command|Modifiers::Alt);
+    case appNames.id("itunes"):
+      a.tellApp("iTunes","next track", r);
       break;
-    
-    case strid("grabscreen"):
-      Services::sendChar('3', Modifiers::Command|Modifiers::Shift);
+    case appNames.id("macmote"):
+      if (a.connected()) a.macmote("next");
       break;
-    
-    case strid("grabselect"):
-      //"⌘⇧4"
-      Services::sendChar('4', Modifiers::Command|Modifiers::Shift);
+    case appNames.id("music"):
+      if (a.connected()) a.macmote("next");
+      else a.tellApp("iTunes","next track", r);
       break;
-    
-    case strid("switchapp"):
-      //Cmd-Tab: comportement incorrect!
-      Services::sendKeycode(48, Modifiers::Command);
+    case appNames.id("dvd player"):
+      a.tellApp("DVD Player","play next chapter", r);
       break;
   }
 }
 
-void CurrentAction::doHotkey() {
-  if (!command) return;
-  if (command->name=="redo") {
-    redoKey();
-  }
-  else if (!command->arg.empty()) {
-    if (command->arg[0] == '?')    // "?" means take arg provided by user
-      Services::sendChars(shortcut->arg(), shortcut->modifiers());
-    else Services::sendModChars(command->arg);
+static void playPause(CurrentAction& a, Ctx& c, Res& r) {
+  switch (a.getAppID(c)) {
+    case appNames.id("itunes"):
+      a.tellApp("iTunes","playpause", r);
+      break;
+    case appNames.id("macmote"):
+      if (a.connected()) a.macmote("playpause");
+    case appNames.id("music"):
+      if (a.connected()) a.macmote("playpause");
+      else a.tellApp("iTunes","playpause", r);
+      break;
   }
 }
 
-void CurrentAction::redoKey() {
-  string app;
-  if (!Services::getFrontAppName(app)) return;
-  switch (strid(app)) {
-    case strid("Microsoft Word"):
-    case strid("Microsoft Excel"):
-    case strid("Microsoft PowerPoint"):
-      Services::sendChar('y', Modifiers::Command);
+static void showHide(CurrentAction& a, Ctx& c, Res& r) {
+  switch (a.getAppID(c)) {
+    case appNames.id("itunes"):
+      a.openHideApp("iTunes", c, r);
+      break;
+    case appNames.id("macmote"):
+      if (a.connected()) a.macmote("info");
+      break;
+    case appNames.id("music"):
+      if (a.connected()) a.macmote("info");
+      else a.openHideApp("iTunes", c, r);
       break;
     default:
-      Services::sendChar('z', Modifiers::Command|Modifiers::Shift);
+      a.openHideApp(c.arg, c, r);
       break;
   }
 }
 
-void CurrentAction::setVolume(const std::string& vol) {
-  if (!command) return;
+// Open Menu in Editing Mode
+
+static void edit(CurrentAction&, Ctx&, Res& r) {
+  r.status = ActionResult::NoFeedback;  // sinon le feedback va fermer l'overlay!
+  MarkPad::instance.postEdit(nullptr);
+}
+
+static void editMenu(CurrentAction&, Ctx& c, Res& r) {
+  r.status = ActionResult::NoFeedback;
+  MarkPad::instance.postEdit(MarkPad::instance.findMenu(c.arg));
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static void parseVolume(const string& vol, ActionArgs& args) {
   if (vol.empty()) return;
+  char* end = nullptr;
+  long value = strtol(vol.c_str(), &end, 10);
   
-  if (connected()) {
-    if (vol[0] == '+') {feedback = "Media vol+"; macmote("vol+"); }
-    else if (vol[0] == '-') {feedback = "Media vol-"; macmote("vol-");}
-    else if (iequal(vol, "mute")) {feedback = "Media mute"; macmote("mute");}
-  }
-  else if (vol[0] == '+') {
-    if (vol == "+") Services::changeVolume(+10);
-    else Services::changeVolume(stoi(vol));
+  if (vol == "+" || vol == "-") {
+    args.volumeMode = ActionArgs::ChangeVolume;
+    args.volume = vol == "+" ? +10 : -10;
   }
-  else if (vol[0] == '-') {
-    if (vol == "-") Services::changeVolume(-10);
-    else Services::changeVolume(stoi(vol));
+  else if (iequal(vol, "mute")) args.volumeMode = ActionArgs::MuteVolume;
+  else if (end != vol.c_str() && *end == 0) {
+    args.volumeMode = (vol[0] == '+' || vol[0] == '-') ?
+    ActionArgs::ChangeVolume : ActionArgs::SetVolume;
+    args.volume = int(value);
   }
-  else if (isdigit(vol[0])) Services::setVolume(stoi(vol));
-  else if (iequal(vol, "mute")) Services::muteVolume();
 }
 
-void CurrentAction::doCommand() {
-  if (!command || shortcut->arg().empty()) return;
-  const string& sarg = shortcut->arg();
+static Handler resolveCommand(const string& arg, ActionArgs& args) {
+  if (arg.empty()) return doNothing;
+  if (ccuty::strsplit(args.app, args.command, arg, ":") <= 0) return doNothing;
+  if (args.app == "music") return musicCommand;
+  else if (args.app == "macmote") return macmoteCommand;
+  else return appCommand;
+}
+
+static Handler resolveScriptFile(const string& arg, ActionArgs& args) {
+  if (arg.empty()) return doNothing;
+  ccuty::strsplit(args.app, args.command, arg, ":");
+  if (ccuty::extname(args.app) != ".scpt") return openAppWithFile;
+  if (!args.command.empty()) ccuty::strsplit(args.argv, args.command, " ");
+  return scriptFile;
+}
+
+// commands that have a specific handler (the other ones are hotkeys)
+static constexpr auto commandNames = ccuty::make_stringswitch
+("openhideapp", "openapp", "openurl", "openfile", "opensysdir", "fullscreen", "resize",
+ "zoom", "unzoom", "volume", "appwins", "nextwin", "mcontrol", "desktop", "dock",
+ "grabscreen", "grabselect", "redo", "write", "copyws", "pastews", "store", "retrieve",
+ "cut", "copy", "paste", "appcmd", "command", "applecmd", "unixcmd", "scriptfile",
+ "quitapp", "previous", "next", "playpause", "showhide", "edit", "editmenu");
+
+ActionHandler CurrentAction::resolve(const Action& action, const Command& command,
+                                     const string& arg, ActionArgs& args) {
+  // the app of these commands is known, except for the current app
+  auto forApp = [&arg, &args](Handler h) {
+    if (arg.empty()) return doNothing;
+    if (arg == Actions::CurrentApp) args.currentApp = true;
+    else {
+      args.app = arg;
+      args.appid = getAppID(arg);
+    }
+    return h;
+  };
   
-  switch (strid(command->name)) {
-    case strid("appcmd"):
-    case strid("command"): {
-      string app, apparg;
-      auto n = ccuty::strsplit(app, apparg, sarg, ":");
-      if (n <= 0) break;
-      if (app == "music") {
-        if (connected()) macmote(apparg);
-        else Services::tellApp("iTunes", apparg);
-      }
-      else if (app == "macmote") macmote(apparg);
-      else Services::tellApp(app, apparg);
-    } break;
+  switch (commandNames(command.name)) {
+    case commandNames.id("openhideapp"):
+      args.app = ccuty::basename(arg, false);  // no extension!
+      return openOrHideApp;
+    case commandNames.id("openapp"): return openAppWithFile;
+    case commandNames.id("openurl"): return openUrl;
+    case commandNames.id("openfile"): return openFile;
+    case commandNames.id("opensysdir"): return openSysDir;
       
-    case strid("applecmd"):
-      system("osascript -e '" + sarg + "' &");
-      break;
+    case commandNames.id("fullscreen"): return fullScreen;
+    case commandNames.id("resize"):
+      if (arg == "fullscreen") return fullScreen;
+      else if (arg == "zoom" || arg == "unzoom") return zoom;   // "+" for both (compat)
+      args.command = tolower(arg);
+      return resizeWindow;
+    case commandNames.id("zoom"):
+      args.command = arg;
+      return zoom;
+    case commandNames.id("unzoom"): return unzoom;  // compat
+    case commandNames.id("volume"):
+      parseVolume(arg, args);
+      return changeVolume;
+    case commandNames.id("appwins"): return appWindows;
+    case commandNames.id("nextwin"): return nextWindow;
+    case commandNames.id("mcontrol"): return missionControl;
+    case commandNames.id("desktop"): return desktop;
+    case commandNames.id("dock"): return dock;
+    case commandNames.id("grabscreen"): return grabScreen;
+    case commandNames.id("grabselect"): return grabSelection;
       
-    case strid("unixcmd"):
-      system(sarg + "&");
-      break;
+    case commandNames.id("redo"): return redo;
       
-    case strid("scriptfile"):
-      openApp(sarg);
-      break;
-      
-    case strid("quitapp"):
-      Services::tellApp(getApp(sarg), "quit");
-      break;
-      
-    case strid("previous"): {
-      switch (getAppID(sarg)) {
-        case strid("chrome"):
-        case strid("google chrome"):
-          Services::tellApp("Google Chrome","go back active tab of front window");
-          break;
-        case strid("safari"):
-          Services::sendKeycode(123, Modifiers::Command); // command left arrow
-          break;
-        case strid("itunes"):
-          Services::tellApp("iTunes","back track");
-          break;
-        case strid("macmote"):
-          if (connected()) macmote("previous");
-          break;
-        case strid("music"):
-          if (connected()) macmote("previous");
-          else Services::tellApp("iTunes","back track");
-          break;
-        case strid("dvd player"):
-          Services::tellApp("DVD Player","play previous chapter");
-          break;
-      }
-    } break;
+    case commandNames.id("write"): return pasteString;
+    case commandNames.id("copyws"): return copyWithoutStyle;
+    case commandNames.id("pastews"): return pasteWithoutStyle;
+    case commandNames.id("store"): return store;
+    case commandNames.id("retrieve"): return retrieve;
+    case commandNames.id("cut"): return cutKey;
+    case commandNames.id("copy"): return copyKey;
+    case commandNames.id("paste"): return pasteKey;
       
-    case strid("next"): {
-      switch (getAppID(sarg)) {
-        case strid("chrome"):
-        case strid("google chrome"):
-          //Services::sendChar(']', Modifiers::Command);
-          Services::tellApp("Google Chrome","go forward active tab of front window");
-          break;
-        case strid("safari"):
-          Services::sendKeycode(124, Modifiers::Command); // command left arrow
-          break;
-        case strid("itunes"):
-          Services::tellApp("iTunes","next track");
-          break;
-        case strid("macmote"):
-          if (connected()) macmote("next");
-          break;
-        case strid("music"):
-          if (connected()) macmote("next");
-          else Services::tellApp("iTunes","next track");
-          break;
-        case strid("dvd player"):
-          Services::tellApp("DVD Player","play next chapter");
-          break;
-      }
-    } break;
-      
-    case strid("playpause"): {
-      switch (getAppID(sarg)) {
-        case strid("itunes"):
-          Services::tellApp("iTunes","playpause");
-          break;
-        case strid("macmote"):
-          if (connected()) macmote("playpause");
-        case strid("music"):
-          if (connected()) macmote("playpause");
-          else Services::tellApp("iTunes","playpause");
-          break;
-      }
-    } break;
+    case commandNames.id("appcmd"):
+    case commandNames.id("command"): return resolveCommand(arg, args);
+    case commandNames.id("applecmd"): return arg.empty() ? doNothing : appleScript;
+    case commandNames.id("unixcmd"): return arg.empty() ? doNothing : unixCommand;
+    case commandNames.id("scriptfile"): return resolveScriptFile(arg, args);
+    case commandNames.id("quitapp"): return forApp(quitApp);
+    case commandNames.id("previous"): return forApp(previousItem);
+    case commandNames.id("next"): return forApp(nextItem);
+    case commandNames.id("playpause"): return forApp(playPause);
+    case commandNames.id("showhide"): return forApp(showHide);
       
-    case strid("showhide"): {
-      switch (getAppID(sarg)) {
-        case strid("itunes"):
-          openHideApp("iTunes");
-          break;
-        case strid("macmote"):
-          if (connected()) macmote("info");
-          break;
-        case strid("music"):
-          if (connected()) macmote("info");
-          else openHideApp("iTunes");
-          break;
-        default:
-          openHideApp(sarg);
-          break;
-      }
-    } break;
-  }
-}
-
-void CurrentAction::openEditor() {
-  if (!command) return;
-  status = NoFeedback;  // sinon le feedback va fermer l'overlay!
-  switch (strid(command->name)) {
-    case strid("edit"):
-      MarkPad::instance.postEdit(nullptr);
-      break;
-    case strid("editmenu"):
-      MarkPad::instance.postEdit(MarkPad::instance.findMenu(shortcut->arg()));
-      break;
-  }
-}
-
-void CurrentAction::doClipboard() {
-  if (!command) return;
-  switch (strid(command->name)) {
-    case strid("write"):
-      Services::pasteString(shortcut->arg());
-      break;
-    case strid("copyws"):
-      Services::copyWithoutStyle();
-      break;
-    case strid("pastews"):
-      Services::pasteWithoutStyle();
-      break;
-    case strid("store"):
-      Services::copyToBuffer(shortcut->arg());
-      break;
-    case strid("retrieve"):
-      Services::pasteFromBuffer(shortcut->arg());
-      break;
-    case strid("cut"):
-      Services::sendChar('x', Modifiers::Command);
-      break;
-    case strid("copy"):
-      Services::sendChar('c', Modifiers::Command);
-      break;
-    case strid("paste"):
-      Services::sendChar('v', Modifiers::Command);
-      break;
+    case commandNames.id("edit"): return edit;
+    case commandNames.id("editmenu"): return editMenu;
   }
+  
+  // other hotkeys: "?" means take arg provided by user
+  if (action.isHotkey() && command.arg[0])
+    return command.arg[0] == '?' ? userHotkey : hotkey;
+  return nullptr;
 }
 
 /*
@@ -477,98 +548,57 @@ void CurrentAction::volumePerCent() {
  */
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-class Cnx {
-public:
-  Cnx(const string& hostname_and_port);
-  void connect();
-  void disconnect();
-  bool connected() const;
-  void send(const string& data);
+// the connection to the media server is shared by the actions (which may be executed
+// simultaneously). Its I/O thread sends the commands in order: a burst of commands
+// (e.g. when turning the volume wheel) does not create threads nor block the actions.
+// The queue holds the commands sent while the connection is being restored: a few
+// seconds of wheel events (about 60 per second) before the connection gives up.
+static const size_t MediaQueueSize = 1024;
+
+shared_ptr<LineConnection> CurrentAction::media() {
+  string hostname, portname;
+  ccuty::strsplit(hostname, portname, Conf::k.mediaHost, ":");
+  int port = atoi(portname.c_str());
+  lock_guard<std::mutex> lock(cnxMutex);
   
-  string hostname;
-  int port{0};
-  bool connecting{false};
-  Socket* sock{nullptr};
-  SocketBuffer* sockbuf{nullptr};
-};
-
-Cnx::Cnx(const string& hostname_and_port) {
-  string portname;
-  ccuty::strsplit(hostname, portname, hostname_and_port, ":");
-  port = atoi(portname.c_str());
-}
-
-bool Cnx::connected() const {
-  return sock != nullptr && sockbuf != nullptr;
-}
-
-void Cnx::connect() {
-  connecting = true;
-  disconnect();
-  sock = new Socket();
-  int status = sock->connect(hostname, port);
-  if (status >= 0) {
-    sockbuf = new SocketBuffer(sock);
-    cout << "*** Connected to Macmote on: "<< hostname <<endl;
+  // the configuration may have been reloaded: the previous connection is closed
+  // when the actions that use it are completed
+  if (!cnx || cnx->host() != hostname || cnx->port() != port) {
+    if (cnx) cnx->close();
+    cnx = make_shared<LineConnection>(hostname, port, MediaQueueSize);
+    cnx->setListener([hostname](LineConnection::State state, const string& error) {
+      if (state == LineConnection::Connected)
+        cout << "*** Connected to Macmote on: "<< hostname <<endl;
+      else if (state == LineConnection::Closed && !error.empty())
+        MarkPad::warning("Couldn't connect to MacMote on: "+hostname);  // gave up
+      else if (!error.empty())
+        cerr << "MacMote: " << error << endl;
+    });
   }
-  else {
-    MarkPad::warning("Couldn't connect to MacMote on: "+hostname);
-    delete sock;
-    sock = nullptr;
-  }
-  connecting = false;
+  return cnx;
 }
 
-void Cnx::disconnect() {
-  if (sock) sock->close();
-  delete sock;
-  delete sockbuf;
-  sock = nullptr;
-  sockbuf = nullptr;
-}
-
-void Cnx::send(const string& args) {
-  if (connecting) {
-    MarkPad::warning("Server "+hostname+" is busy");
-    return;
-  }
-  if (!sock) {
-    connect();
-    if (!sock) return;
-  }
-  if (sockbuf->writeLine(">"+args) < 0) {  // > needed before command
-    MarkPad::warning("Couldn't send data to server "+hostname);
-    disconnect();
-  }
-}
-
-// - - - - -
-
 void CurrentAction::connect() {
   if (!Conf::k.mediaHost.empty()) macmote("getstatus");
 }
 
 void CurrentAction::disconnect() {
-  if (cnx) cnx->disconnect();
+  media()->close();
   cout << "Disconnected from media server "<< Conf::k.mediaHost<<endl;
 }
 
 bool CurrentAction::connected() {
-  return cnx ? cnx->connected() : false;
-}
-
-// must be static because called by std::thread()
-static void sendData(Cnx* cnx, const string& args) {
-  cnx->send(args);
+  return media()->isConnected();
 }
 
 void CurrentAction::macmote(const string& args) {
   if (args == "panel") {
-    if (cnx) Services::openUrl("http://"+ cnx->hostname+"/macmote/");
+    Services::openUrl("http://"+ media()->host()+"/macmote/");
   }
   else {
-    if (!cnx) cnx = new Cnx(Conf::k.mediaHost);
-    // thread to avoid blocking the program
-    std::thread(sendData, cnx, args).detach();
+    auto server = media();
+    if (!server->send(">"+args))   // > needed before command
+      MarkPad::warning("Too many commands for "+server->host()+": the queue is full, '"
+                       +args+"' was dropped");
   }
 }
@@ -10,45 +10,52 @@
 #ifndef CurrentAction_h
 #define CurrentAction_h
 
+#include <mutex>
+#include <memory>
+#include "ccuty/cclauncher.hpp"
+namespace ccuty {class LineConnection;}
 #include "Actions.h"
 
+/// executes the actions (see Actions::exec).
+/// Has no state but the connection to the media server, the state of each execution
+/// is in its ActionContext, so that the methods can be called by several threads.
 class CurrentAction {
 public:
-  class Cnx* cnx{nullptr};
-  enum Status {OK, NoFeedback, Error} status{OK};
-  Shortcut* shortcut{nullptr};
-  const Action* action{nullptr};
-  const Command* command{nullptr};
-  Shortcut::State touchstate{};
-  MTTouch touch{};
-  std::string feedback;
-  
-  void exec(Shortcut&, const MTTouch&, Shortcut::State);
-  void doOpen();
-  void doCommand();
-  void doWindow();
-  void doHotkey();
-  void doClipboard();
-  void doClicks();
-  void openEditor();
-  void setVolume(const std::string& vol);
+  /// returns the handler of this command and parses _arg_ into _args_ (called once,
+  /// when the action of a Shortcut is set), null if the command can't be executed.
+  static ActionHandler resolve(const Action&, const Command&, const std::string& arg,
+                               ActionArgs& args);
+
+  /// returns false if the action is invalid.
+  bool exec(const ActionContext&, ActionResult&);
+  void setVolume(const ActionArgs&, ActionResult&);
   void openApp(const std::string& appname);
-  void openHideApp(const std::string& appname);
+  void openHideApp(const std::string& appname, const ActionContext&, ActionResult&);
   string getFile(const std::string& file);
   string getApp(const std::string& app);
-  unsigned long long int getAppID(const std::string& app);
+  /// the id of an app that has specific commands, -1 if none.
+  static int getAppID(const std::string& app);
+  /// the id of the app of this action, of the current app if it is not specified.
+  static int getAppID(const ActionContext&);
   void redoKey();
   bool connected();
   void connect();
   void disconnect();
   void macmote(const string& command);
-  /*
-   const string& arg() const {return shortcut_->arg();}
-   float globalX() const {return touch_.norm.pos.x;}
-   float globalY() const {return touch_.norm.pos.y;}
-   float localX()  const {return touch_.norm.pos.x - shortcut_->area().x;}
-   float localY()  const {return touch_.norm.pos.y - shortcut_->area().y;}
-   */
+  /// starts a program without a shell (see ccuty::Launcher), sets an error if it fails.
+  void launch(const std::vector<std::string>& argv, ActionResult&);
+  /// runs an AppleScript in the script host (see ccuty::ScriptHost), which keeps it
+  /// compiled, or with osascript if there is no script host.
+  void runAppleScript(const std::string& source, ActionResult&);
+  void runScriptFile(const std::string& path, const std::vector<std::string>& args, ActionResult&);
+  void tellApp(const std::string& app, const std::string& command, ActionResult&);
+
+private:
+  ccuty::Launcher launcher{true};   // forks its helper when Actions::instance is created
+  // creates the connection if needed, or if the media server was changed
+  std::shared_ptr<ccuty::LineConnection> media();
+  std::shared_ptr<ccuty::LineConnection> cnx;
+  std::mutex cnxMutex;
 };
 
 #endif
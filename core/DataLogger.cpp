@@ -7,7 +7,16 @@
 //  Copyright (c) 2017/2020. All rights reserved.
 //
 
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#  include <sys/sendfile.h>
+#endif
 #include "ccuty/ccpath.hpp"
+#include "ccuty/ccarchive.hpp"
 #include "DataLogger.h"
 #include "Actions.h"
 using ccuty::file_exists;
@@ -29,11 +38,14 @@ _currentGuidesPath(_dirLogPath+"current_guides.json"),
 _guidesLogPath(_dirLogPath+"guides_log.xml"),
 _arcGuidesPath(_dirLogPath+"guides.tar.gz"),
 _gestLogPath(_dirLogPath+"gestures_log.csv"),
+_trajLogPath(_dirLogPath+"trajectories.bin"),
+_gestStorePath(_dirLogPath+"gestures.store"),
 _arcGestPath(_dirLogPath+"gestures.tar.gz"),
 _attrLogPath(_dirLogPath+"logger_attributes.txt"),
-_maxFileSize(2000000) {        // 2000000 = 2Mo max file size
+_maxFileSize(2000000),         // 2000000 = 2Mo max file size
+store_(_gestStorePath) {
   
-  if (!file_exists(_dirLogPath)) { std::system(("mkdir "+_dirLogPath).c_str()); }
+  if (!file_exists(_dirLogPath)) { ::mkdir(_dirLogPath.c_str(), 0755); }
   
   if (!file_exists(_attrLogPath)) {
     
@@ -59,133 +71,153 @@ _maxFileSize(2000000) {        // 2000000 = 2Mo max file size
     }
     attrFile.close();
   }
-}
-
-bool DataLogger::needToSaveConfiguration(const std::string &filepath) {
-  char buffer[24];
-  std::string result;
   
-  //TODO: remove hardcoding of configuration file
-  if (!file_exists(_currentConfPath)) { return true; }
-  
-  std::string cmd = "diff "+filepath+" "+_currentConfPath;
-  if (FILE* pipe = ::popen(cmd.c_str(), "r")) {
-    while (!::feof(pipe)) {
-      if (::fgets(buffer, sizeof(buffer), pipe) != nullptr) { result += buffer; }
-    }
-    ::pclose(pipe);
-  }
-  else { std::cerr << "fopen() failed!" << std::endl; return false; }
-  return result!="";
+  trajbufs_.reset(new Trajectory[4]);
+  for (int k = 0; k < 4; ++k) freetrajs_.push(&trajbufs_[k]);
+  writer_ = std::thread(&DataLogger::writeGestures, this);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Files are compared and copied in-process (no diff, cp or cat commands).
 
-void DataLogger::saveConfigurationChanges(const std::string &confFilePath) {
-  std::string cmd = "cp "+confFilePath+" "+_currentConfPath;
-  system(cmd.c_str());
-  
-  std::time_t now = std::time(0);
-  char timestamp[64];
-  std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dD%Hh%Mm%Ss%z", std::localtime(&now));
-  
-  // open file in writing mode
-  if (!file_exists(_confLogPath)) { cmd = "touch "+_confLogPath; system(cmd.c_str()); }
-  
-  cmd = "echo \"<configuration date='"+std::string(timestamp)+"'>\n\" >> "+_confLogPath;
-  system(cmd.c_str());
-  cmd = "cat "+_currentConfPath+" >> "+_confLogPath;
-  system(cmd.c_str());
-  cmd = "echo \"</configuration>\n\" >> "+_confLogPath;
-  system(cmd.c_str());
-  
-  ifstream file(_confLogPath, std::ios_base::ate | std::ios_base::binary);
-  if(file.is_open()) {
-    unsigned long size = file.tellg();
-    if(_maxFileSize < size) {
-      addFileToArchive(_confLogPath, _arcConfPath);
-      attributes_[CONF_LOG_KEY] = std::to_string(stoi(attributes_[CONF_LOG_KEY])+1);
-      saveAttributes();
+namespace {
+
+// FNV-1a digest of the content of a file, 0 if the file can't be read.
+uint64_t fileDigest(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return 0;
+  uint64_t digest = 14695981039346656037ULL;
+  char buf[64*1024];
+  ssize_t len;
+  while ((len = ::read(fd, buf, sizeof(buf))) > 0) {
+    for (ssize_t k = 0; k < len; ++k) {
+      digest ^= (unsigned char)buf[k];
+      digest *= 1099511628211ULL;
     }
-    file.close();
   }
+  ::close(fd);
+  return len < 0 ? 0 : digest;
 }
 
+bool writeAll(int fd, const char* data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if (n < 0) {if (errno == EINTR) continue; return false;}
+    data += n;
+    len -= n;
+  }
+  return true;
+}
 
-bool DataLogger::needToSaveGuides(const std::string &filepath) {
-  char buffer[24];
-  std::string result;
-  //TODO: remove hardcoding of configuration file
-  if (!file_exists(_currentGuidesPath)) { return true; }
-  
-  std::string cmd = "diff "+filepath+" "+_currentGuidesPath;
+// copies the content of _from_ at the end of _to_ (which is truncated if _append_ is false).
+bool copyFile(const std::string& from, const std::string& to, bool append,
+              const std::string& header = "", const std::string& footer = "") {
+  int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) return false;
+  // O_APPEND is not used: copy_file_range() and sendfile() reject such files
+  int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+  if (out < 0) {::close(in); return false;}
+  bool ok = ::lseek(out, 0, SEEK_END) >= 0 && writeAll(out, header.data(), header.size());
+  bool copied = false;
   
-  if (FILE* pipe = ::popen(cmd.c_str(), "r")) {
-    while (!::feof(pipe)) {
-      if (::fgets(buffer, sizeof(buffer), pipe) != nullptr) { result += buffer; }
+#if defined(__linux__)
+  struct stat st;
+  if (ok && ::fstat(in, &st) == 0) {
+    off_t remaining = st.st_size;
+    while (remaining > 0) {
+      ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, remaining, 0);
+      if (n <= 0) n = ::sendfile(out, in, nullptr, remaining);
+      if (n <= 0) break;
+      remaining -= n;
     }
-    ::pclose(pipe);
+    copied = remaining == 0;   // otherwise the rest is copied below
   }
-  else { std::cout << "fopen() failed!" << std::endl; return false; }
-  return result!="";
+#endif
+  
+  if (ok && !copied) {
+    char buf[64*1024];
+    ssize_t len;
+    while ((len = ::read(in, buf, sizeof(buf))) > 0 && (ok = writeAll(out, buf, len))) {}
+    ok = ok && len == 0;
+  }
+  ok = ok && writeAll(out, footer.data(), footer.size());
+  ::close(in);
+  return (::close(out) == 0) && ok;
 }
 
+}
 
-void DataLogger::saveGuidesChanges(const std::string &confFilePath) {
-  std::string cmd = "cp "+confFilePath+" "+_currentGuidesPath;
-  system(cmd.c_str());
+bool DataLogger::needToSave(const std::string& filepath, const std::string& current, Digest& digest) {
+  // the digest of the last saved file is only computed once
+  if (digest.saved == 0 && file_exists(current)) digest.saved = fileDigest(current);
+  digest.compared = fileDigest(filepath);
+  return digest.compared == 0 || digest.compared != digest.saved;
+}
+
+void DataLogger::saveChanges(const std::string& filepath, const std::string& current, Digest& digest,
+                             const std::string& log, const std::string& arc, const char* tag) {
+  if (!copyFile(filepath, current, false)) {
+    std::cerr << "could not copy file (" << filepath << ")" << std::endl;
+    return;
+  }
+  digest.saved = digest.compared;
   
   std::time_t now = std::time(0);
   char timestamp[64];
   std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dD%Hh%Mm%Ss%z", std::localtime(&now));
   
-  // open file in writing mode
-  if (!file_exists(_guidesLogPath)) { cmd = "touch "+_guidesLogPath; system(cmd.c_str()); }
-  
-  cmd = "echo \"<guide date='"+std::string(timestamp)+"'>\n\" >> "+_guidesLogPath;
-  system(cmd.c_str());
-  cmd = "cat "+_currentGuidesPath+" >> "+_guidesLogPath;
-  system(cmd.c_str());
-  cmd = "echo \"</guide>\n\" >> "+_guidesLogPath;
-  system(cmd.c_str());
+  std::string header = std::string("<") + tag + " date='" + timestamp + "'>\n\n";
+  std::string footer = std::string("</") + tag + ">\n\n";
+  if (!copyFile(current, log, true, header, footer)) {
+    std::cerr << "could not write log file (" << log << ")" << std::endl;
+    return;
+  }
   
-  ifstream file(_guidesLogPath, std::ios_base::ate | std::ios_base::binary);
-  if(file.is_open()) {
-    unsigned long size = file.tellg();
-    if(_maxFileSize < size) {
-      addFileToArchive(_guidesLogPath, _arcGuidesPath);
-      attributes_[CONF_LOG_KEY] = std::to_string(stoi(attributes_[CONF_LOG_KEY])+1);
-      saveAttributes();
-    }
+  struct stat st;
+  if (::stat(log.c_str(), &st) == 0 && _maxFileSize < (unsigned long)st.st_size) {
+    addFileToArchive(log, arc);
+    attributes_[CONF_LOG_KEY] = std::to_string(stoi(attributes_[CONF_LOG_KEY])+1);
+    saveAttributes();
   }
 }
 
+bool DataLogger::needToSaveConfiguration(const std::string &filepath) {
+  return needToSave(filepath, _currentConfPath, confDigest_);
+}
+
+void DataLogger::saveConfigurationChanges(const std::string &confFilePath) {
+  saveChanges(confFilePath, _currentConfPath, confDigest_, _confLogPath, _arcConfPath, "configuration");
+}
+
+bool DataLogger::needToSaveGuides(const std::string &filepath) {
+  return needToSave(filepath, _currentGuidesPath, guidesDigest_);
+}
+
+void DataLogger::saveGuidesChanges(const std::string &confFilePath) {
+  saveChanges(confFilePath, _currentGuidesPath, guidesDigest_, _guidesLogPath, _arcGuidesPath, "guide");
+}
+
 void DataLogger::addFileToArchive(const std::string &filepath,
                                   const std::string &arcPath) {
-  const std::string &tmpDir = _dirLogPath+"tmp/";
-  std::system(("mkdir "+tmpDir).c_str());
-
-  // create temporary file to change the name
   std::time_t now = std::time(0);
   char timestamp[64];
   std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dD%Hh%Mm%Ss%z", std::localtime(&now));
   
-  // copy file to save with id equal to the current time
-  std::string cmd = "cp "+filepath+" "+(tmpDir+timestamp); system(cmd.c_str());
-  
-  // create new archive if it does not exist
-  if (!file_exists(arcPath)) {
-    cmd = "tar czf "+arcPath+" -C "+tmpDir+" ."; std::system(cmd.c_str());
-  }
-  // save into archive
-  else {
-    cmd = "tar xf "+arcPath+" -C "+tmpDir; system(cmd.c_str());
-    // [self execCommand:@"/usr/bin/tar" arguments:@[@"xf", arcpath, @"-C", tmpDir]];
-    cmd = "tar czf "+arcPath+" -C "+tmpDir+" ."; system(cmd.c_str());
-    // [self execCommand:@"/usr/bin/tar" arguments:@[@"czf", arcpath, @"-C", tmpDir, @"."]];
+  // the file is appended to the archive with a name equal to the current time
+  // (the archive is not recompressed, see TarArchive)
+  ccuty::TarArchive archive(arcPath);
+  if (!archive.isAppendable()) {
+    // archive created by tar (or damaged): it is kept aside and a new one is started
+    std::string base = arcPath.substr(0, arcPath.rfind(".tar.gz"));
+    ::rename(arcPath.c_str(), (base+"-"+timestamp+".tar.gz").c_str());
+    archive = ccuty::TarArchive(arcPath);
   }
   
-  cmd = "rm -rf "+tmpDir; system(cmd.c_str());
-  cmd = "rm -f "+filepath; system(cmd.c_str());
+  if (!archive.append(filepath, timestamp)) {
+    std::cerr << "could not add file to archive (" << arcPath << ")" << std::endl;
+    return;
+  }
+  ::unlink(filepath.c_str());
   cout << "file added to archive" << endl;
 }
 
@@ -201,60 +233,185 @@ void DataLogger::saveAttributes() {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // Gesture Log Implementation
 
+static void copyName(char* to, size_t size, const std::string& from) {
+  size_t len = std::min(from.size(), size-1);
+  ::memcpy(to, from.data(), len);
+  to[len] = 0;
+}
+
+DataLogger::~DataLogger() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_one();
+  if (writer_.joinable()) writer_.join();
+}
+
 void DataLogger::startGesture(Shortcut *s, const MTPoint &coord) {
   if (!s) return;
-  if (!gestout_.is_open()) {
-    gestout_.open(_gestLogPath, std::ios_base::app);
-    if (!gestout_) {
-      std::cerr << "could not open gestures file ("+_gestLogPath+")";
-    }
-    else {
-      gestout_.imbue(std::locale::classic());
-      gestout_ .precision(3);
-      gestout_ << std::fixed;
-    }
-  }
-  startrect_ = s->area();
-  startname_ = s->name();
+  started_ = true;
+  gesture_.started = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                   .time_since_epoch()).count();
+  gesture_.startrect = s->area();
+  copyName(gesture_.startname, sizeof(gesture_.startname), s->name());
+  if (!trajectory_) freetrajs_.pop(trajectory_);
+  if (trajectory_) trajectory_->clear();
+}
+
+
+void DataLogger::recordGestureMove(const MTTouch &touch) {
+  if (trajectory_) trajectory_->add(touch);
 }
 
 
 void DataLogger::endGesture(Shortcut *s, const MTPoint &coord, bool menushown) {
   if (!s) return;
+  gesture_.menushown = menushown;
+  gesture_.cancelled = false;
+  gesture_.endrect = s->area();
+  copyName(gesture_.name, sizeof(gesture_.name), s->name());
+  copyName(gesture_.command, sizeof(gesture_.command), s->commandName());
+  gesture_.trajectory = trajectory_;
+  pushGesture();
+}
 
-  Conf::mustSave();
-  char day[100], hour[100];
-  std::time_t now = std::time(0);
-  std::strftime(day, sizeof(day), "%Y-%m-%d", std::localtime(&now));
-  std::strftime(hour, sizeof(hour), "%H:%M:%S", std::localtime(&now));
-  const MTRect &endrect = s->area();
 
-  gestout_
-  << "\n" << ++gestnum_ << ", "
-  << day << ", " << hour << ", "
-  << menushown << ", "
-  << startname_ << ", "
-  << s->name() << ", " << s->commandName() << ", "
-  << startrect_.x << ", " << startrect_.y << ", "
-  << startrect_.width << ", " << startrect_.height << ", => , "
-  << endrect.x << ", " << endrect.y << ", "
-  << endrect.width << ", " << endrect.height;
-  gestout_.flush();
+void DataLogger::cancelGesture(bool menushown) {
+  if (!started_) return;
+  gesture_.menushown = menushown;
+  gesture_.cancelled = true;
+  gesture_.endrect = MTRect{};
+  gesture_.name[0] = gesture_.command[0] = 0;
+  gesture_.trajectory = nullptr;    // only the trajectories of gestures in the log are saved
+  pushGesture();
+}
+
+
+void DataLogger::pushGesture() {
+  using namespace std::chrono;
+  gesture_.time = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+  gesture_.duration = !started_ ? 0.f   // logging was enabled during the gesture
+  : float(duration<double>(steady_clock::now().time_since_epoch()).count() - gesture_.started);
+  started_ = false;
+  // the gesture is lost if the writer is late
+  if (gestures_.push(gesture_) && gesture_.trajectory) trajectory_ = nullptr;
+  wakeup_.notify_one();
 }
 
 
 void DataLogger::saveGestures() {
-  gestout_.flush();
-  gestout_.close();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_ = true;
+  }
+  wakeup_.notify_one();
 }
 
-/*
- void DataLogger::recordGestureMove(const MTPoint &coord, bool nmt) {
-   if (_currentGesture) { _currentGesture->recordMove(coord, nmt); }
- }
- void GestureLog::recordMove(const MTPoint& coord, bool nmt) {
- std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now()-_startTime;
- stringstream data;
- data << elapsed.count() << ' ' << coord.x << ' ' << coord.y << ' ' << nmt;
- _trace.push_back(std::string(data.str()));
- }*/
+
+void DataLogger::writeGestures() {
+  batch_.imbue(std::locale::classic());
+  batch_.precision(3);
+  batch_ << std::fixed;
+  auto lastwrite = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool stop = false;
+  
+  while (!stop) {
+    // woken up when a gesture ends (endGesture() does not lock the mutex, so this
+    // may be missed, but the thread also wakes up every second)
+    wakeup_.wait_for(lock, std::chrono::seconds(1),
+                     [this]{return stop_ || flush_ || !gestures_.empty();});
+    stop = stop_;
+    bool flush = flush_;
+    flush_ = false;
+    lock.unlock();
+    
+    // gestures are formatted now to give the trajectory buffers back
+    GestureRecord g;
+    while (gestures_.pop(g)) {
+      storeGesture(g);
+      if (g.cancelled) continue;
+      formatGesture(g);
+      if (g.trajectory) {
+        TrajectoryFile::encode(trajbatch_, gestnum_, std::time_t(g.time / 1000), *g.trajectory);
+        freetrajs_.push(g.trajectory);
+      }
+    }
+    
+    // but they are written when saveGestures() is called, and at least every second
+    auto now = std::chrono::steady_clock::now();
+    if (!stop && !flush && now - lastwrite < std::chrono::seconds(1)) {
+      lock.lock();
+      continue;
+    }
+    lastwrite = now;
+    
+    if (!trajbatch_.empty()) {
+      if (!trajout_.is_open()) {
+        struct stat st;
+        bool empty = ::stat(_trajLogPath.c_str(), &st) < 0 || st.st_size == 0;
+        trajout_.open(_trajLogPath, std::ios_base::app | std::ios_base::binary);
+        if (!trajout_) std::cerr << "could not open trajectories file ("+_trajLogPath+")";
+        else if (empty) trajout_.write(TrajectoryFile::Magic, sizeof(TrajectoryFile::Magic));
+      }
+      if (trajout_) {
+        trajout_.write(trajbatch_.data(), trajbatch_.size());
+        trajout_.flush();
+      }
+      trajbatch_.clear();
+    }
+    
+    if (!store_.write()) std::cerr << "could not write gestures store ("+_gestStorePath+")";
+    
+    if (batch_.tellp() > 0) {
+      if (!gestout_.is_open()) {
+        gestout_.open(_gestLogPath, std::ios_base::app);
+        if (!gestout_) std::cerr << "could not open gestures file ("+_gestLogPath+")";
+      }
+      if (gestout_) {
+        gestout_ << batch_.str();
+        gestout_.flush();
+      }
+      batch_.str("");
+    }
+    lock.lock();
+  }
+}
+
+
+void DataLogger::storeGesture(const GestureRecord &g) {
+  GestureEvent e;
+  e.time = g.time;
+  e.duration = g.duration;
+  e.start = g.startname;
+  e.end = g.name;
+  e.command = g.command;
+  e.menushown = g.menushown;
+  e.cancelled = g.cancelled;
+  e.startrect = g.startrect;
+  e.endrect = g.endrect;
+  store_.add(e);
+}
+
+
+void DataLogger::formatGesture(const GestureRecord &g) {
+  std::time_t time = std::time_t(g.time / 1000);
+  if (time != batchtime_) {   // gestures are often performed in the same second
+    batchtime_ = time;
+    struct tm t;
+    ::localtime_r(&time, &t);
+    std::strftime(day_, sizeof(day_), "%Y-%m-%d", &t);
+    std::strftime(hour_, sizeof(hour_), "%H:%M:%S", &t);
+  }
+  batch_
+  << "\n" << ++gestnum_ << ", "
+  << day_ << ", " << hour_ << ", "
+  << g.menushown << ", "
+  << g.startname << ", "
+  << g.name << ", " << g.command << ", "
+  << g.startrect.x << ", " << g.startrect.y << ", "
+  << g.startrect.width << ", " << g.startrect.height << ", => , "
+  << g.endrect.x << ", " << g.endrect.y << ", "
+  << g.endrect.width << ", " << g.endrect.height;
+}
@@ -14,6 +14,7 @@
 #define MarkPad_DataLogger
 
 #include <string>
+#include <cstdint>
 #include <array>
 #include <vector>
 #include <map>
@@ -27,39 +28,87 @@
 #include <algorithm>
 #include <cstdlib>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "Conf.h"
 #include "MarkPad.h"
 #include "Pad.h"
 #include "Shortcut.h"
 #include "MTouch.h"
+#include "Trajectory.h"
+#include "GestureStore.h"
+#include "ccuty/ccring.hpp"
 
 class DataLogger {
 public:
   DataLogger(const Pad&);
+  ~DataLogger();
   void startGesture(Shortcut*, const MTPoint&);
   void endGesture(Shortcut*, const MTPoint&, bool menushown);
+  void recordGestureMove(const MTTouch&);  ///< records a frame of the gesture touch.
+  void cancelGesture(bool menushown);      ///< the gesture was released without selecting a shortcut.
   bool needToSaveConfiguration(const std::string&);
   void saveConfigurationChanges(const std::string&);
   bool needToSaveGuides(const std::string&);
   void saveGuidesChanges(const std::string&);
   void saveAttributes();
   void addFileToArchive(const std::string&, const std::string&);
-  void saveGestures();
+  void saveGestures();  ///< writes the gestures that were performed (this function does not block).
 
 private:
+  // digests of the files that were last saved (0 if not known yet) and of the files
+  // that were compared by needToSave()
+  struct Digest {uint64_t saved{}, compared{};};
+  bool needToSave(const std::string&, const std::string& current, Digest&);
+  void saveChanges(const std::string&, const std::string& current, Digest&,
+                   const std::string& log, const std::string& arc, const char* tag);
+
   // all file paths to record data
   const std::string _dirLogPath, _currentConfPath, _confLogPath, _arcConfPath,
   _currentGuidesPath, _guidesLogPath, _arcGuidesPath,
-  _gestLogPath, _arcGestPath, _attrLogPath;
+  _gestLogPath, _trajLogPath, _gestStorePath, _arcGestPath, _attrLogPath;
   const unsigned int _maxFileSize;
+  Digest confDigest_, guidesDigest_;
   // logger attributes (file saved and pad dimension)
   std::map<std::string, std::string> attributes_;
-  // for storing gestures:
+
+  // gestures are written by a thread: the touch thread just copies a GestureRecord
+  // in the gestures_ queue (the gesture is dropped if the queue is full).
+  struct GestureRecord {
+    int64_t time;                     // milliseconds since 1970
+    double started;                   // steady clock (seconds)
+    float duration;
+    bool menushown, cancelled;
+    MTRect startrect, endrect;
+    char startname[64], name[64], command[64];   // truncated if longer
+    Trajectory* trajectory;           // given back to the touch thread by freetrajs_
+  };
+  void writeGestures();
+  void formatGesture(const GestureRecord&);
+  void storeGesture(const GestureRecord&);
+  void pushGesture();
+  GestureRecord gesture_{};           // gesture being performed (touch thread)
+  bool started_{false};
+  ccuty::SpscRing<GestureRecord,256> gestures_;
+  // trajectories are recorded in preallocated buffers (none if all are being written)
+  std::unique_ptr<Trajectory[]> trajbufs_;
+  Trajectory* trajectory_{};          // trajectory being recorded (touch thread)
+  ccuty::SpscRing<Trajectory*,4> freetrajs_;
+  std::thread writer_;
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  bool stop_{false}, flush_{false};
+  // used by the writer thread:
   std::ofstream gestout_;
+  std::ostringstream batch_;
+  std::ofstream trajout_;
+  GestureStore store_;
+  std::string trajbatch_;
   unsigned long gestnum_{};
-  std::string startname_;
-  MTRect startrect_{};
+  std::time_t batchtime_{};
+  char day_[32]{}, hour_[32]{};
 };
 
 #endif
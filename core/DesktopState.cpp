@@ -0,0 +1,89 @@
+//
+//  DesktopState.cpp
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#include "DesktopState.h"
+#include "Services.h"
+using namespace std;
+
+DesktopState DesktopState::instance;
+const int DesktopState::FrontAppTTL, DesktopState::FinderTTL;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void DesktopState::init() {
+  Services::setFrontAppCallback([this](const string& name, const string& path) {
+    frontAppChanged(name, path);
+  });
+}
+
+void DesktopState::frontAppChanged(const string& name, const string& path) {
+  lock_guard<mutex> lock(mutex_);
+  frontApp_.first = name;
+  frontApp_.second = path;
+  frontApp_.ok = !name.empty();
+  frontApp_.notified = true;
+  forget();   // they depend on the frontmost app
+}
+
+void DesktopState::forget() {
+  generation_++;
+  finderFile_.expires = Clock::time_point();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// the lock is not held during the queries, which may take some time: if several
+// threads need the same value, it is queried several times. The result is not
+// kept if another app was activated during the query.
+
+bool DesktopState::getFrontApp(string& name, string& path) {
+  unsigned long gen;
+  {
+    lock_guard<mutex> lock(mutex_);
+    gen = generation_;
+    if (frontApp_.isValid()) {
+      name = frontApp_.first;
+      path = frontApp_.second;
+      return frontApp_.ok;
+    }
+  }
+  bool ok = Services::getFrontApp(name, path);
+  lock_guard<mutex> lock(mutex_);
+  if (!frontApp_.notified && generation_ == gen) {
+    frontApp_.first = name;
+    frontApp_.second = path;
+    frontApp_.ok = ok;
+    frontApp_.expires = Clock::now() + chrono::milliseconds(FrontAppTTL);
+  }
+  return ok;
+}
+
+bool DesktopState::getFrontAppName(string& name) {
+  string path;
+  return getFrontApp(name, path);
+}
+
+bool DesktopState::getFinderFile(string& path) {
+  unsigned long gen;
+  {
+    lock_guard<mutex> lock(mutex_);
+    gen = generation_;
+    if (finderFile_.isValid()) {
+      path = finderFile_.first;
+      return finderFile_.ok;
+    }
+  }
+  bool ok = Services::getFinderFile(path);
+  lock_guard<mutex> lock(mutex_);
+  if (generation_ == gen) {
+    finderFile_.first = path;
+    finderFile_.ok = ok;
+    finderFile_.expires = Clock::now() + chrono::milliseconds(FinderTTL);
+  }
+  return ok;
+}
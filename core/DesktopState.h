@@ -0,0 +1,64 @@
+//
+//  DesktopState.h
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#ifndef MarkPad_DesktopState
+#define MarkPad_DesktopState
+
+#include <string>
+#include <mutex>
+#include <chrono>
+
+/** Cache of the state of the desktop that is used by the actions.
+ * The frontmost app is updated when an app is activated (see
+ * Services::setFrontAppCallback()), so that actions do not query it. The file
+ * selected in the Finder (and the frontmost app until the first activation) is
+ * queried and then kept for a short time (its TTL), it is forgotten when another
+ * app is activated. The page of the browser is not cached, as the commands that
+ * use it need the current page (see Actions::setCurrentFileOrURL()).
+ * Can be used by several threads.
+ */
+class DesktopState {
+public:
+  static DesktopState instance;
+
+  /// time during which the values that are not notified are kept (milliseconds).
+  static const int FrontAppTTL = 1000, FinderTTL = 250;
+
+  /// starts listening to app activations (must be called in the main thread).
+  void init();
+
+  /// name and executable path of the frontmost app.
+  bool getFrontApp(std::string& name, std::string& path);
+  bool getFrontAppName(std::string& name);
+
+  /// file selected in the Finder.
+  bool getFinderFile(std::string& path);
+
+  /// called when an app is activated.
+  void frontAppChanged(const std::string& name, const std::string& path);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Value {
+    std::string first, second;
+    bool ok{false};
+    Clock::time_point expires;   // never if notified
+    bool notified{false};
+    bool isValid() const {return notified || Clock::now() < expires;}
+  };
+
+  void forget();
+
+  std::mutex mutex_;
+  Value frontApp_, finderFile_;
+  unsigned long generation_{0};   // incremented when the polled values are forgotten
+};
+
+#endif
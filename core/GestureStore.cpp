@@ -0,0 +1,309 @@
+//
+//  GestureStore.cpp
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "GestureStore.h"
+using namespace std;
+
+const char GestureStore::Magic[8] = {'M','P','G','S','T','O','R','1'};
+
+static_assert(sizeof(GestureStore::BlockHeader) == 48, "BlockHeader must not have padding");
+
+void GestureStore::Block::clear() {
+  header = BlockHeader{};
+  names.clear();
+  time.clear();
+  duration.clear();
+  start.clear();
+  end.clear();
+  command.clear();
+  flags.clear();
+  for (auto& c : startrect) c.clear();
+  for (auto& c : endrect) c.clear();
+}
+
+GestureStore::GestureStore(const string& path) : path_(path) {}
+
+static void addRect(vector<float> (&columns)[4], const MTRect& r) {
+  columns[0].push_back(r.x);
+  columns[1].push_back(r.y);
+  columns[2].push_back(r.width);
+  columns[3].push_back(r.height);
+}
+
+void GestureStore::clear() {
+  block_.clear();
+  names_.clear();
+  tailRows_ = 0;
+}
+
+void GestureStore::add(const GestureEvent& e) {
+  // the last block of the previous session is continued
+  if (offset_ == 0 && block_.time.empty()) open();
+
+  // the gestures are discarded if they can't be written, so that memory does not grow
+  if (block_.time.size() >= BlockRows && !write()) clear();
+
+  auto name = [this](const char* s) -> uint32_t {
+    auto it = names_.emplace(s ? s : "", uint32_t(block_.names.size()));
+    if (it.second) block_.names.push_back(it.first->first);
+    return it.first->second;
+  };
+
+  auto& h = block_.header;
+  if (h.rows == 0) {
+    h.mintime = h.maxtime = e.time;
+    h.minduration = h.maxduration = e.duration;
+  }
+  h.rows++;
+  h.mintime = min(h.mintime, e.time);
+  h.maxtime = max(h.maxtime, e.time);
+  h.minduration = min(h.minduration, e.duration);
+  h.maxduration = max(h.maxduration, e.duration);
+  if (e.cancelled) h.cancelled++;
+  if (e.menushown) h.menushown++;
+
+  block_.time.push_back(e.time);
+  block_.duration.push_back(e.duration);
+  block_.start.push_back(name(e.start));
+  block_.end.push_back(name(e.end));
+  block_.command.push_back(name(e.command));
+  block_.flags.push_back(uint8_t((e.menushown ? MenuShown : 0) | (e.cancelled ? Cancelled : 0)));
+  addRect(block_.startrect, e.startrect);
+  addRect(block_.endrect, e.endrect);
+}
+
+template <class T>
+static void putColumn(string& out, const vector<T>& column) {
+  out.append(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+// appends the block (header included) to _data_.
+static void putBlock(string& data, GestureStore::Block& b) {
+  // the header is filled last, as the size of the block is not known yet
+  size_t start = data.size();
+  data.append(sizeof(GestureStore::BlockHeader), 0);
+  for (auto& n : b.names) {
+    uint16_t len = uint16_t(min<size_t>(n.size(), 0xffff));
+    data.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    data.append(n, 0, len);
+  }
+  putColumn(data, b.time);
+  putColumn(data, b.duration);
+  putColumn(data, b.start);
+  putColumn(data, b.end);
+  putColumn(data, b.command);
+  putColumn(data, b.flags);
+  for (auto& c : b.startrect) putColumn(data, c);
+  for (auto& c : b.endrect) putColumn(data, c);
+
+  auto& h = b.header;
+  h.names = uint32_t(b.names.size());
+  h.size = uint32_t(data.size() - start - sizeof(h));
+  ::memcpy(&data[start], &h, sizeof(h));
+}
+
+static bool writeData(int fd, const string& data, uint64_t offset) {
+  for (size_t pos = 0; pos < data.size(); ) {
+    ssize_t n = ::pwrite(fd, data.data() + pos, data.size() - pos, off_t(offset + pos));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    pos += size_t(n);
+  }
+  return true;
+}
+
+// returns the end of the last complete block of the file, 0 if it is not a store
+// (the headers of the blocks are added to _headers_ if not null).
+static uint64_t scanBlocks(int fd, vector<pair<GestureStore::BlockHeader,uint64_t>>* headers) {
+  struct stat st;
+  char magic[sizeof(GestureStore::Magic)];
+  if (::fstat(fd, &st) < 0 || ::pread(fd, magic, sizeof(magic), 0) != ssize_t(sizeof(magic))
+      || ::memcmp(magic, GestureStore::Magic, sizeof(magic)) != 0)
+    return 0;
+  uint64_t size = uint64_t(st.st_size), offset = sizeof(magic);
+  GestureStore::BlockHeader h;
+  while (offset + sizeof(h) <= size
+         && ::pread(fd, &h, sizeof(h), off_t(offset)) == ssize_t(sizeof(h))
+         && h.rows > 0 && offset + sizeof(h) + h.size <= size) {
+    if (headers) headers->push_back({h, offset});
+    offset += sizeof(h) + h.size;
+  }
+  return offset;
+}
+
+// opens the tail file of a store whose blocks end at _end_, returns -1 if there is none
+// or if its block was already appended to the store.
+static int openTail(const string& path, uint64_t end, GestureStore::BlockHeader& h) {
+  int fd = ::open(GestureStore::tailPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  char magic[sizeof(GestureStore::Magic)];
+  uint64_t offset = 0;
+  struct stat st;
+  if (::fstat(fd, &st) < 0 || ::pread(fd, magic, sizeof(magic), 0) != ssize_t(sizeof(magic))
+      || ::memcmp(magic, GestureStore::Magic, sizeof(magic)) != 0
+      || ::pread(fd, &offset, sizeof(offset), sizeof(magic)) != ssize_t(sizeof(offset))
+      || offset < end
+      || ::pread(fd, &h, sizeof(h), GestureStore::TailOffset) != ssize_t(sizeof(h))
+      || h.rows == 0 || GestureStore::TailOffset + sizeof(h) + h.size > uint64_t(st.st_size)) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int GestureStore::openTail(const string& path, BlockHeader& h) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  uint64_t end = scanBlocks(fd, nullptr);
+  ::close(fd);
+  return end > 0 ? ::openTail(path, end, h) : -1;
+}
+
+// finds the end of the store and reloads the tail of the previous session.
+bool GestureStore::open() {
+  int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {::close(fd); return false;}
+  if (st.st_size < off_t(sizeof(Magic))) {
+    if (::pwrite(fd, Magic, sizeof(Magic), 0) != ssize_t(sizeof(Magic))) {::close(fd); return false;}
+    offset_ = sizeof(Magic);
+  }
+  else offset_ = scanBlocks(fd, nullptr);
+  if (offset_ == 0) {::close(fd); return false;}   // not a store: left as is
+
+  // a block that was partially written (e.g. if the program was killed) is removed,
+  // otherwise the blocks written after it could not be read
+  if (off_t(offset_) < st.st_size && ::ftruncate(fd, off_t(offset_)) < 0) {
+    ::close(fd);
+    offset_ = 0;
+    return false;
+  }
+
+  string tail = tailPath(path_);
+  BlockHeader h;
+  int tfd = ::openTail(path_, offset_, h);
+  if (tfd < 0) ::unlink(tail.c_str());   // none, unreadable or already in the store
+  else if (block_.time.empty()) {
+    // continued by this session
+    if (readBlock(tfd, TailOffset, block_)) {
+      for (uint32_t k = 0; k < block_.names.size(); ++k) names_.emplace(block_.names[k], k);
+      tailRows_ = block_.time.size();
+    }
+    else clear();
+  }
+  else {
+    // gestures were added before the store could be opened: the tail is appended as is
+    string data(h.size + sizeof(h), 0);
+    bool ok = ::pread(tfd, &data[0], data.size(), TailOffset) == ssize_t(data.size())
+    && writeData(fd, data, offset_);
+    if (ok) offset_ += data.size();
+    else if (::ftruncate(fd, off_t(offset_)) < 0) offset_ = 0;
+    if (offset_ > 0) ::unlink(tail.c_str());
+  }
+  if (tfd >= 0) ::close(tfd);
+  if (::close(fd) < 0) offset_ = 0;
+  return offset_ > 0;
+}
+
+// replaces the tail file by the current block.
+bool GestureStore::writeTail() {
+  string data(Magic, sizeof(Magic));
+  data.append(reinterpret_cast<const char*>(&offset_), sizeof(offset_));
+  putBlock(data, block_);
+
+  string tail = tailPath(path_), tmp = tail + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  bool ok = writeData(fd, data, 0);
+  ok = (::close(fd) == 0) && ok && ::rename(tmp.c_str(), tail.c_str()) == 0;
+  if (ok) tailRows_ = block_.time.size();
+  else ::unlink(tmp.c_str());
+  return ok;
+}
+
+bool GestureStore::write() {
+  if (block_.time.size() == tailRows_) return true;   // nothing new
+  if (offset_ == 0 && !open()) return false;
+  if (block_.time.size() < BlockRows) return writeTail();
+
+  int fd = ::open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {offset_ = 0; return false;}
+  string data;
+  putBlock(data, block_);
+
+  // appended after the blocks that were written, which are thus never damaged
+  bool ok = writeData(fd, data, offset_);
+  ok = (::close(fd) == 0) && ok;
+  if (ok) {
+    offset_ += data.size();
+    clear();
+    ::unlink(tailPath(path_).c_str());
+  }
+  else offset_ = 0;   // the end of the file will be checked again
+  return ok;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+bool GestureStore::readHeaders(const string& path, vector<pair<BlockHeader,uint64_t>>& headers) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  bool ok = scanBlocks(fd, &headers) > 0;
+  ::close(fd);
+  return ok;
+}
+
+template <class T>
+static bool getColumn(const char*& p, const char* end, vector<T>& column, size_t rows) {
+  if (size_t(end - p) < rows * sizeof(T)) return false;
+  column.resize(rows);
+  ::memcpy(column.data(), p, rows * sizeof(T));
+  p += rows * sizeof(T);
+  return true;
+}
+
+bool GestureStore::readBlock(int fd, uint64_t offset, Block& b) {
+  auto& h = b.header;
+  if (::pread(fd, &h, sizeof(h), off_t(offset)) != ssize_t(sizeof(h))) return false;
+  string data(h.size, 0);
+  if (::pread(fd, &data[0], data.size(), off_t(offset + sizeof(h))) != ssize_t(data.size()))
+    return false;
+
+  const char* p = data.data();
+  const char* end = p + data.size();
+  b.names.resize(h.names);
+  for (auto& n : b.names) {
+    uint16_t len;
+    if (end - p < ssize_t(sizeof(len))) return false;
+    ::memcpy(&len, p, sizeof(len));
+    p += sizeof(len);
+    if (end - p < len) return false;
+    n.assign(p, len);
+    p += len;
+  }
+  size_t rows = h.rows;
+  bool ok = getColumn(p, end, b.time, rows) && getColumn(p, end, b.duration, rows)
+  && getColumn(p, end, b.start, rows) && getColumn(p, end, b.end, rows)
+  && getColumn(p, end, b.command, rows) && getColumn(p, end, b.flags, rows);
+  for (auto& c : b.startrect) ok = ok && getColumn(p, end, c, rows);
+  for (auto& c : b.endrect) ok = ok && getColumn(p, end, c, rows);
+  if (!ok) return false;
+
+  // names must be valid indexes
+  auto valid = [&b](uint32_t k) {return k < b.names.size();};
+  return all_of(b.start.begin(), b.start.end(), valid) && all_of(b.end.begin(), b.end.end(), valid)
+  && all_of(b.command.begin(), b.command.end(), valid);
+}
@@ -0,0 +1,110 @@
+//
+//  GestureStore.h
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+//  Columnar store for the gestures recorded by DataLogger.
+//
+
+#ifndef MarkPad_GestureStore
+#define MarkPad_GestureStore
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "MTouch.h"
+
+/// gesture stored in a GestureStore.
+struct GestureEvent {
+  int64_t time;         ///< end of the gesture (milliseconds since 1970).
+  float duration;       ///< from the first touch to the release (seconds).
+  const char *start, *end, *command;   ///< start and end shortcuts, command.
+  bool menushown, cancelled;           ///< cancelled: released without selecting a shortcut.
+  MTRect startrect, endrect;
+};
+
+/** Columnar, append-only store of gestures.
+ * The file starts with Magic, followed by blocks of at most BlockRows gestures.
+ * A block starts with a BlockHeader which contains statistics (so that queries can
+ * skip blocks), then the names used in the block (uint16 length + characters),
+ * then the columns (see Block). Numbers are stored in the native order (little-endian
+ * on supported platforms).
+ * Blocks are independent so they can be read in parallel. Only full blocks are
+ * appended to the store, blocks that were written are never rewritten. The last
+ * block, until it is full, is saved by write() in a side file (see tailPath()) that
+ * is replaced each time and that is reloaded when the store is opened again.
+ */
+class GestureStore {
+public:
+  static const char Magic[8];
+  static const unsigned int BlockRows = 4096;
+  static const uint64_t TailOffset = 16;   ///< offset of the block in the tail file.
+
+  struct BlockHeader {
+    int64_t mintime, maxtime;
+    uint32_t rows, size;            ///< number of gestures, size of the block after the header.
+    uint32_t names, cancelled, menushown;
+    float minduration, maxduration;
+    uint32_t reserved;
+  };
+
+  enum Flags : uint8_t {MenuShown = 1, Cancelled = 2};
+
+  /// columns of a block (names are indexes in _names_, rectangles are x, y, width, height).
+  struct Block {
+    BlockHeader header{};
+    std::vector<std::string> names;
+    std::vector<int64_t> time;
+    std::vector<float> duration;
+    std::vector<uint32_t> start, end, command;
+    std::vector<uint8_t> flags;
+    std::vector<float> startrect[4], endrect[4];
+    void clear();
+  };
+
+  /// the file is created when gestures are written.
+  GestureStore(const std::string& path);
+
+  /// writes the gestures that were not written.
+  ~GestureStore() {write();}
+
+  /// adds a gesture (in memory).
+  void add(const GestureEvent&);
+
+  /// writes the gestures that were added, returns false on error.
+  /// A full block is appended to the store, otherwise the block is saved in the tail file.
+  bool write();
+
+  /// the file that contains the last block of a store while it is not full: Magic,
+  /// the offset in the store where the block will be appended (uint64), then the block.
+  static std::string tailPath(const std::string& path) {return path + ".tail";}
+
+  /// reads the headers of the blocks of a file and their offset, returns false on error.
+  /// An incomplete last block (e.g. if the program was killed when writing it) is ignored.
+  static bool readHeaders(const std::string& path,
+                          std::vector<std::pair<BlockHeader,uint64_t>>& headers);
+
+  /// opens the tail file of a store and reads the header of its block (which can then be
+  /// read by readBlock() at TailOffset), returns -1 if there is none.
+  static int openTail(const std::string& path, BlockHeader&);
+
+  /// reads the block at _offset_ in a file opened with open(), returns false on error.
+  static bool readBlock(int fd, uint64_t offset, Block&);
+
+private:
+  bool open();
+  bool writeTail();
+  void clear();
+
+  std::string path_;
+  Block block_;
+  std::unordered_map<std::string,uint32_t> names_;  // indexes in block_.names
+  uint64_t offset_{};   // where the next block is written, 0 if not known yet
+  size_t tailRows_{};   // gestures of block_ that are in the tail file
+};
+
+#endif
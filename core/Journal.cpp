@@ -0,0 +1,369 @@
+//
+//  Journal.cpp: journal of the changes made to the shortcuts
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Each change is a line: <op> <path> <data>
+// - path: indexes of the shortcut in its menu and in its parent menus,
+//   starting from the main menu (e.g. 2/0 is the first shortcut of the submenu
+//   opened by the third shortcut of the main menu)
+// - data depends on op (see Journal::Op), newlines and \ are escaped.
+// The last line is ignored if incomplete (i.e. if MarkPad crashed while writing it).
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <locale>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "Journal.h"
+#include "Conf.h"
+#include "Shortcut.h"
+#include "Actions.h"
+#include "MarkPad.h"
+#include "Services.h"
+using namespace std;
+
+Journal Journal::instance;
+
+static const size_t MaxPending = 16*1024;   // flushed when there are more pending data
+static const int SyncDelay = 500;           // ms, syncs that occur meanwhile are done at once
+static thread_local bool paused = false;    // see pause()
+
+static void escape(string& out, const string& s) {
+  for (char c : s) {
+    if (c == '\\') out += "\\\\";
+    else if (c == '\n') out += "\\n";
+    else out += c;
+  }
+}
+
+static string unescape(const string& s) {
+  string out;
+  out.reserve(s.size());
+  for (size_t k = 0; k < s.size(); ++k) {
+    if (s[k] == '\\' && k+1 < s.size()) {
+      ++k;
+      out += (s[k] == 'n') ? '\n' : s[k];
+    }
+    else out += s[k];
+  }
+  return out;
+}
+
+string Journal::fileName(unsigned long number) {
+  return Conf::confDir() + "Shortcuts-" + to_string(number) + ".journal";
+}
+
+bool Journal::sync(int fd) {
+#ifdef F_FULLFSYNC
+  // fsync() does not flush the disk cache on MacOSX
+  if (::fcntl(fd, F_FULLFSYNC) == 0) return true;
+#endif
+  return ::fsync(fd) == 0;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+string Journal::pathOf(const Shortcut& s) {
+  string path;
+  const Shortcut* cur = &s;
+  while (cur) {
+    const ShortcutMenu* menu = cur->parentMenu();
+    if (!menu) return "";
+    auto& shortcuts = menu->shortcuts();
+    auto it = find(shortcuts.begin(), shortcuts.end(), cur);
+    if (it == shortcuts.end()) return "";  // not (or no longer) in its menu
+    path = to_string(it - shortcuts.begin()) + (path.empty() ? "" : "/" + path);
+    if (menu == Conf::k.mainMenu_) return path;
+    cur = menu->opener();
+  }
+  return "";   // not in the main menu tree (e.g. a guide)
+}
+
+Shortcut* Journal::findShortcut(ShortcutMenu* mainMenu, const string& path,
+                                ShortcutMenu*& menu, size_t& index) {
+  menu = mainMenu;
+  index = 0;
+  const char* p = path.c_str();
+  while (menu) {
+    char* end = nullptr;
+    index = strtoul(p, &end, 10);
+    if (end == p) {menu = nullptr; return nullptr;}
+    Shortcut* s = index < size_t(menu->size()) ? menu->shortcuts()[index] : nullptr;
+    if (*end != '/') return s;
+    menu = s ? s->menu() : nullptr;
+    p = end + 1;
+  }
+  return nullptr;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void Journal::pause(bool state) {
+  paused = state;
+}
+
+void Journal::record(Op op, const Shortcut& s) {
+  if (paused || fd_ < 0 || replaying_) return;
+  string path = pathOf(s);
+  if (path.empty()) return;
+
+  // consecutive changes of the same value replace each other (e.g. when dragging)
+  if (&s == last_ && op == lastop_ && op != Add && op != Remove) pending_.resize(lastpos_);
+  else {
+    last_ = &s;
+    lastop_ = op;
+    lastpos_ = pending_.size();
+  }
+
+  pending_ += char(op);
+  pending_ += ' ';
+  pending_ += path;
+
+  switch (op) {
+    case Add: {
+      ostringstream out;
+      Conf::writeShortcut(s, out);
+      pending_ += ' ';
+      escape(pending_, out.str());
+    } break;
+    case Remove:
+      break;
+    case Area: {
+      // name position is absolute, 9 digits are enough to restore floats exactly
+      ostringstream out;
+      out.imbue(std::locale::classic());
+      out.precision(9);
+      out << ' ' << s.x() << ' ' << s.y() << ' ' << s.width() << ' ' << s.height()
+      << ' ' << s.nameX() << ' ' << s.nameY();
+      pending_ += out.str();
+    } break;
+    case Name:
+      pending_ += ' ';
+      escape(pending_, s.name());
+      break;
+    case Action:
+      pending_ += ' ';
+      escape(pending_, Actions::instance.getShortcutActionForConfFile(s));
+      break;
+    case Modes:
+      pending_ += ' ' + to_string(s.touchOpenMenu_) + ' ' + to_string(s.touchFromBorder_)
+      + ' ' + to_string(s.modifiers_);
+      break;
+    case Menu:
+      pending_ += s.menu() ? " 1" : " 0";
+      break;
+  }
+  pending_ += '\n';
+
+  // changes that occur shortly after each other are written together
+  if (pending_.size() > MaxPending) flush();
+  else if (!scheduled_) {
+    scheduled_ = true;
+    Services::postpone([]{Journal::instance.flush();});
+  }
+}
+
+void Journal::write(const char* p, size_t count) {
+  while (fd_ >= 0 && count > 0) {
+    ssize_t n = ::write(fd_, p, count);
+    if (n >= 0) {p += n; count -= n; size_ += n;}
+    else if (errno != EINTR) {
+      ::close(fd_);
+      fd_ = -1;    // Conf will then save the whole file
+      MarkPad::warning("Can't write journal: " + fileName(number_));
+    }
+  }
+}
+
+void Journal::flush() {
+  scheduled_ = false;
+  last_ = nullptr;
+  if (pending_.empty() || fd_ < 0) {pending_.clear(); return;}
+  write(pending_.data(), pending_.size());
+  pending_.clear();
+  if (fd_ >= 0) syncLater();
+}
+
+// F_FULLFSYNC may take tens of milliseconds: it is done by a background thread so
+// that the main thread is not blocked (e.g. when dragging a shortcut).
+void Journal::syncLater() {
+  lock_guard<mutex> lock(syncMutex_);
+  for (auto& f : tosync_) {
+    if (f.number == number_) return;  // not yet synced, will include these data
+  }
+  int fd = ::dup(fd_);
+  if (fd < 0) {
+    sync(fd_);
+    return;
+  }
+  tosync_.push_back({number_, fd});
+  if (!syncer_.joinable()) syncer_ = thread(&Journal::syncFiles, this);
+  syncCond_.notify_one();
+}
+
+void Journal::syncFiles() {
+  unique_lock<mutex> lock(syncMutex_);
+  while (true) {
+    syncCond_.wait(lock, [this]{return stopped_ || !tosync_.empty();});
+    if (tosync_.empty()) return;   // stopped
+    syncCond_.wait_for(lock, chrono::milliseconds(SyncDelay), [this]{return stopped_;});
+    vector<SyncedFile> files;
+    files.swap(tosync_);           // data written from now on will be synced next time
+    lock.unlock();
+    for (auto& f : files) {
+      sync(f.fd);
+      ::close(f.fd);
+    }
+    lock.lock();
+  }
+}
+
+Journal::~Journal() {
+  {
+    lock_guard<mutex> lock(syncMutex_);
+    stopped_ = true;
+    syncCond_.notify_one();
+  }
+  if (syncer_.joinable()) syncer_.join();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+unsigned long Journal::rotate() {
+  if (fd_ >= 0) {
+    flush();
+    ::close(fd_);
+  }
+  size_ = 0;
+  fd_ = ::open(fileName(++number_).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  return number_;
+}
+
+void Journal::removeBefore(unsigned long number) {
+  DIR* dir = ::opendir(Conf::confDir().c_str());
+  if (!dir) return;
+  while (struct dirent* e = ::readdir(dir)) {
+    unsigned long n = 0;
+    char end = 0;
+    if (sscanf(e->d_name, "Shortcuts-%lu.journa%c", &n, &end) == 2 && end == 'l' && n < number)
+      ::unlink(fileName(n).c_str());
+  }
+  ::closedir(dir);
+}
+
+size_t Journal::open(ShortcutMenu* mainMenu, unsigned long firstNumber) {
+  removeBefore(firstNumber);  // already in the configuration file
+  size_t count = 0;
+  bool failed = false;
+  replaying_ = true;
+
+  // journals are numbered consecutively
+  unsigned long n = firstNumber;
+  for (; ; ++n) {
+    ifstream in(fileName(n), ios::binary);
+    if (!in) break;
+    string line;
+    // a complete line ends with a newline, eof() is true otherwise
+    while (!failed && getline(in, line) && !in.eof()) {
+      if (replay(mainMenu, line)) count++;
+      else {
+        failed = true;
+        MarkPad::warning("Invalid change in journal: " + fileName(n) + "\n" + line);
+      }
+    }
+  }
+
+  replaying_ = false;
+  number_ = n;
+  size_ = 0;
+  fd_ = ::open(fileName(number_).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd_ < 0) MarkPad::warning("Can't create journal: " + fileName(number_));
+  return count;
+}
+
+bool Journal::replay(ShortcutMenu* mainMenu, const string& line) {
+  if (line.size() < 3 || line[1] != ' ') return false;
+  char op = line[0];
+  size_t pos = line.find(' ', 2);
+  string path = line.substr(2, pos == string::npos ? string::npos : pos-2);
+  string data = pos == string::npos ? "" : unescape(line.substr(pos+1));
+
+  ShortcutMenu* menu = nullptr;
+  size_t index = 0;
+  Shortcut* s = findShortcut(mainMenu, path, menu, index);
+  if (!menu) return false;
+
+  if (op == Add) {
+    if (index > size_t(menu->size())) return false;
+    istringstream in(data);
+    Shortcut* added = Conf::readShortcut(in);
+    if (!added) return false;
+    menu->shortcuts().insert(menu->shortcuts().begin() + index, added);
+    added->setParentMenu(menu);
+    menu->setChanged();
+    return true;
+  }
+  if (!s) return false;
+  menu->setChanged();
+  istringstream in(data);
+  in.imbue(std::locale::classic());
+
+  switch (op) {
+    case Remove:
+      menu->removeShortcut(*s);
+      delete s;
+      return true;
+    case Area: {
+      MTRect area;
+      float namex, namey;
+      if (!(in >> area.x >> area.y >> area.width >> area.height >> namex >> namey)) return false;
+      s->copyArea(area);
+      s->nameAreaRef().x = namex;
+      s->nameAreaRef().y = namey;
+      return true;
+    }
+    case Name:
+      s->name_ = data;
+      return true;
+    case Action:
+      if (data.empty()) {
+        s->action_ = nullptr;
+        s->comindex_ = -1;
+        s->arg_.clear();
+        Actions::instance.resolveShortcutAction(*s);
+        return true;
+      }
+      else if (data[0] == '!') {
+        return Actions::instance.setShortcutActionFromConfFile(*s, "!", data.substr(1));
+      }
+      else return false;
+    case Modes: {
+      int open = 1, border = 1, modifiers = 0;
+      if (!(in >> open >> border >> modifiers)) return false;
+      s->touchOpenMenu_ = open;
+      s->touchFromBorder_ = border;
+      s->modifiers_ = uint8_t(modifiers);
+      return true;
+    }
+    case Menu:
+      if (data == "1" && !s->menu()) s->setMenu(new ShortcutMenu());
+      else if (data == "0" && s->menu()) {
+        ShortcutMenu* submenu = s->menu();
+        s->setMenu(nullptr);
+        delete submenu;
+      }
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,111 @@
+//
+//  Journal.h
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#ifndef MarkPad_Journal
+#define MarkPad_Journal
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Shortcut;
+class ShortcutMenu;
+
+/** Append-only journal of the changes made to the shortcuts.
+ * Changes are recorded when they happen and written on disk by batches (see flush()),
+ * a background thread then waits until they are physically written.
+ * The configuration file is the last snapshot of the shortcuts: at startup, the
+ * journals that are more recent than this file are replayed on top of it.
+ * Journals are numbered, the configuration file contains the number of the first
+ * journal it does not include.
+ */
+class Journal {
+public:
+  static Journal instance;
+
+  /// recorded operations.
+  enum Op : char {
+    Add = '+',     ///< a shortcut (and its submenu) was added to a menu.
+    Remove = '-',  ///< a shortcut was removed from its menu.
+    Area = '@',    ///< a shortcut or its name was moved or resized.
+    Name = 'n',    ///< a shortcut was renamed.
+    Action = '!',  ///< the action, command or argument of a shortcut was changed.
+    Modes = 'm',   ///< the modes of a shortcut were changed.
+    Menu = 'M'     ///< a submenu was created or removed.
+  };
+
+  /// waits until the journal is physically written.
+  ~Journal();
+
+  /// records a change (nothing is done if the shortcut is not in the main menu tree).
+  /// Remove must be recorded before the shortcut is removed from its menu.
+  void record(Op, const Shortcut&);
+
+  /// changes made by the calling thread are not recorded while _state_ is true
+  /// (e.g. when shortcuts are read from a file).
+  static void pause(bool state);
+
+  /// writes pending changes on disk, they are physically written shortly afterwards
+  /// by a background thread. Called automatically shortly after changes were recorded.
+  void flush();
+
+  /// true if changes are recorded in the journal.
+  bool isOpen() const {return fd_ >= 0;}
+
+  /// size of the current journal (including pending changes).
+  size_t size() const {return size_ + pending_.size();}
+
+  /// number of the current journal.
+  unsigned long number() const {return number_;}
+
+  /// replays the journals that were written after the configuration file was saved,
+  /// then starts a new journal. Returns the number of changes that were replayed.
+  size_t open(ShortcutMenu* mainMenu, unsigned long firstNumber);
+
+  /// closes the current journal and starts a new one, returns its number.
+  unsigned long rotate();
+
+  /// removes journals which number is lower than _number_ (can be called by any thread).
+  static void removeBefore(unsigned long number);
+
+  /// journal files are named Shortcuts-<number>.journal in the configuration directory.
+  static std::string fileName(unsigned long number);
+
+  /// waits until data written in this file is physically written on the disk.
+  static bool sync(int fd);
+
+private:
+  static std::string pathOf(const Shortcut&);
+  static Shortcut* findShortcut(ShortcutMenu* mainMenu, const std::string& path,
+                                ShortcutMenu*& menu, size_t& index);
+  bool replay(ShortcutMenu* mainMenu, const std::string& line);
+  void write(const char* data, size_t count);
+  void syncLater();
+  void syncFiles();
+
+  int fd_{-1};
+  unsigned long number_{0};
+  size_t size_{0}, lastpos_{0};
+  bool replaying_{false}, scheduled_{false};
+  const Shortcut* last_{nullptr};
+  char lastop_{0};
+  std::string pending_;
+
+  // files synced by the background thread (descriptors are dup'ed)
+  struct SyncedFile {unsigned long number; int fd;};
+  std::vector<SyncedFile> tosync_;
+  bool stopped_{false};
+  std::thread syncer_;
+  std::mutex syncMutex_;
+  std::condition_variable syncCond_;
+};
+
+#endif
@@ -16,6 +16,8 @@
 #include "Pad.h"
 #include "Actions.h"
 #include "Services.h"
+#include "DesktopState.h"
+#include "Journal.h"
 using namespace std;
 using namespace ccuty;
 
@@ -43,10 +45,16 @@ void MarkPad::init() {
   // CConf is init in main() to create user files and init paths (incl. exec path)
   // Note that read() requires AWL to be init. because it may call alert()
   CConf::instance.read();
+  
+  // changes made by other programs will be applied to the live configuration
+  Conf::watchFiles(true);
 
   // init services (start callback notifiers & accesibility).
   Services::init();
   
+  // the frontmost app is then known without querying it
+  DesktopState::instance.init();
+  
   // inits GUI (after reading the Conf file)
   GUI::instance.init();
 
@@ -157,6 +165,8 @@ int MarkPad::touchCallback(MTDevice* device, const MTTouch* touches, int touchCo
     }
   }
   
+  // the configuration files were changed during the gesture
+  if (touchCount == 0 && Conf::hasFileChanges()) Services::postpone(Conf::applyFileChanges);
   return 0;
 }
 
@@ -210,7 +220,7 @@ void MarkPad::setCurrentMenu(ShortcutMenu* menu) {
 
 ShortcutMenu* MarkPad::createMenu(Shortcut& opener) {
   ShortcutMenu* menu = new ShortcutMenu();
-  Conf::instance.mustSave();
+  Conf::mustSave(opener.parentMenu());
   opener.setMenu(menu);
   return menu;
 }
@@ -257,6 +267,8 @@ void MarkPad::edit(EditMode mode) {
 
   if (mode == EditNone) {
     isMenuShown_ = false;
+    // the configuration files were changed during the edition
+    if (Conf::hasFileChanges()) Services::postpone(Conf::applyFileChanges);
   }
   else {
     isMenuShown_ = true;
@@ -451,7 +463,7 @@ void MarkPad::cancelCreateShortcut() {
 }
 
 Shortcut* MarkPad::createShortcutFromGuide(ShortcutMenu& menu, const Shortcut& guideArea) {
-  Conf::mustSave();
+  Conf::mustSave(&menu);
   Shortcut* s = menu.addNewShortcut("NoName");
   s->copyArea(guideArea.area());
   s->setNameX(guideArea.nameX());
@@ -462,7 +474,7 @@ Shortcut* MarkPad::createShortcutFromGuide(ShortcutMenu& menu, const Shortcut& g
 }
 
 Shortcut* MarkPad::createShortcutAtPos(ShortcutMenu& menu, const MTPoint& pos) {
-  Conf::mustSave();
+  Conf::mustSave(&menu);
   Shortcut* s = menu.addNewShortcut("NoName");
   s->setArea(pos.x - Conf::k.newShortcutSize.width/2.f,
              pos.y - Conf::k.newShortcutSize.height/2.f,
@@ -524,7 +536,7 @@ void MarkPad::deleteShortcuts() {
 bool MarkPad::deleteShortcutImpl(Shortcut& s) {
   // dont delete current menu and undeletable shortcuts
   if (opensCurrentMenu(s) || s.cannotEdit_) return false;
-  Conf::mustSave();
+  Conf::mustSave(s.parentMenu());
   if (&s == curShortcut_) curShortcut_ = nullptr;
   s.setSelected(false);
   deleteBuffer_.push_back(&s);
@@ -537,9 +549,9 @@ bool MarkPad::deleteShortcutImpl(Shortcut& s) {
 
 Shortcut* MarkPad::undeleteShortcuts() {
   if (deleteBuffer_.empty()) return nullptr;
-  Conf::mustSave();
   Shortcut* s = deleteBuffer_.back();
   deleteBuffer_.pop_back();
+  Conf::mustSave(s->parentMenu());
   if (ShortcutMenu* menu = s->parentMenu()) menu->addShortcut(*s);
   return s;
 }
@@ -568,7 +580,7 @@ void MarkPad::cutShortcuts() {
 
 Shortcut* MarkPad::pasteShortcuts(ShortcutMenu& menu) {
   if (pasteBuffer_.empty()) return nullptr;
-  Conf::mustSave();
+  Conf::mustSave(&menu);
   Shortcut* dup = nullptr;
   for (auto& it : pasteBuffer_) {
     dup = new Shortcut(*it, true);   // duplicate submenu if any
@@ -664,6 +676,7 @@ void MarkPad::adjustBoxToGuide(Shortcut& s) {
     s.area_.y = guide_s->y();
     s.area_.width = guide_s->width();
     s.area_.height = guide_s->height();
+    Journal::instance.record(Journal::Area, s);
   }
 }
 
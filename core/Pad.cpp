@@ -174,6 +174,7 @@ void Pad::touchCallback(const MTTouch* rawTouches, int rawTouchCount)
       if (s && (mp.hotkeyWantsMenu_ || !s->touchFromBorder_)) {
         validTouch_ = true;
         opener_ = s;
+        if (s->submenu_) s->submenu_->load();  // reads the menu now if not yet done
         // bloquer curseur sauf si shorcut special car peut etre au centre
         if (opener_->touchFromBorder_) Services::disableDeviceForCursor(device());
       }
@@ -193,6 +194,7 @@ void Pad::touchCallback(const MTTouch* rawTouches, int rawTouchCount)
     } // endif(!validTouch_)
     
     if (!currentTouch) return;
+    if (Conf::k.logData) dataLogger_.recordGestureMove(*currentTouch);
   
     // on selectionne le shortcut si bord deja touché et distance suffisante
     if (validTouch_ && !opener_
@@ -200,17 +202,13 @@ void Pad::touchCallback(const MTTouch* rawTouches, int rawTouchCount)
         >= Conf::k.minMovement*Conf::k.minMovement) {
       if (Shortcut* s = mainMenu_->findShortcut(*currentTouch)) {
         opener_ = s;
+        if (s->submenu_) s->submenu_->load();  // reads the menu now if not yet done
         Services::disableDeviceForCursor(device());
       }
     }
     
     ShortcutMenu* menu = nullptr;
     if (!opener_  || !(menu = opener_->submenu_)) return;  // menu pas trouvé
-    /*
-    if (Conf::k.logData) {
-      dataLogger_.recordGestureMove(currentTouch->norm.pos,
-                                    mp.isOverlayShown() && !mp.isEditing());
-    }*/
     
     // si currentTouch est l'opener courant on ouvre le menu (si nécessaire)
     // si hotkey appuyé ou temps > menuDelay (s'applique aussi aux sousmenus)
@@ -286,6 +284,10 @@ void Pad::touchCallback(const MTTouch* rawTouches, int rawTouchCount)
       // executer l'action
       Actions::instance.exec(*mp.curShortcut_, selTouch_, Shortcut::Up);
     }
+    
+    else if (Conf::k.logData && !mp.isEditing()) {
+      dataLogger_.cancelGesture(mp.isOverlayShown());
+    }
 
     if (mp.hotkeyWantsMenu_) {
       // pour revenir au main menu apres avoir fermé un menu quand hotkey est appuyé
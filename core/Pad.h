@@ -60,6 +60,9 @@ public:
   const MTTouch** touches() {return touches_;}
   unsigned int touchCount() const {return touchcount_;}
 
+  /// true while the pad is touched or a gesture is performed.
+  bool isTouched() const {return touchcount_ > 0 || validTouch_ || unvalidTouch_;}
+
   void touchCallback(const MTTouch* touches, int touchCount);
   
   /// Cancels the current touch gesture; closes the menu if _closeMenu_ is true.
@@ -37,6 +37,11 @@ public:
   /// This callback function will be called when the computer is going to sleep.
   static void setSleepCallback(std::function<void()> fun);
   
+  /// This callback function will be called in the main thread when an app becomes
+  /// frontmost, with its name and executable path (see DesktopState).
+  static void setFrontAppCallback(std::function<void(const std::string& name,
+                                                     const std::string& path)> fun);
+  
   /// This callback function will be called when the hotkey modifiers are pressed/released.
   /// Note: will work only if accessibility is enabled.
   static void setHotkeyCallback(std::function<void(uint32_t hotkey)> fun);
@@ -60,6 +65,8 @@ public:
   // Actions
   static bool getFrontAppPath(std::string& str);
   static bool getFrontAppName(std::string& str);
+  /// name and executable path of the frontmost app (a single query).
+  static bool getFrontApp(std::string& name, std::string& path);
   
   static const std::string& getDefaultWebBrowser();
   static void openDefaultWebBrowser();
@@ -68,6 +75,8 @@ public:
   static bool setBrowserUrl(std::string const& url, const std::string& browser = "");
   static bool getBrowserUrl(std::string& url, const std::string& browser = "");
   static bool getBrowserTitle(std::string& url, const std::string& browser ="");
+  /// URL and title of the front page of the browser (a single query).
+  static bool getBrowserPage(std::string& url, std::string& title, const std::string& browser = "");
   static bool getFinderFile(std::string& path);
   
   static void openFile(const std::string& path);
@@ -14,9 +14,43 @@
 #include "MarkPad.h"
 #include "Pad.h"
 #include "Actions.h"
+#include "Journal.h"
 using namespace std;
 using namespace ccuty;
 
+// Shortcuts and menus are preceded by a header that contains the arena they were
+// allocated in (null if they were allocated as usual).
+
+namespace {
+  struct alignas(std::max_align_t) ObjectHeader {MenuArena* arena;};
+}
+
+void* MenuArena::newObject(size_t size, MenuArena* arena) {
+  void* p = arena ? arena->allocate(sizeof(ObjectHeader) + size, alignof(ObjectHeader))
+  : ::operator new(sizeof(ObjectHeader) + size);
+  if (arena) arena->refs_++;
+  return new (p) ObjectHeader{arena} + 1;
+}
+
+void MenuArena::deleteObject(void* p) {
+  if (!p) return;
+  ObjectHeader* h = static_cast<ObjectHeader*>(p) - 1;
+  if (h->arena) h->arena->unref();
+  else ::operator delete(h);
+}
+
+void* Shortcut::operator new(size_t size) {return MenuArena::newObject(size, nullptr);}
+void* Shortcut::operator new(size_t size, MenuArena& a) {return MenuArena::newObject(size, &a);}
+void Shortcut::operator delete(void* p) {MenuArena::deleteObject(p);}
+void Shortcut::operator delete(void* p, MenuArena&) {MenuArena::deleteObject(p);}
+
+void* ShortcutMenu::operator new(size_t size) {return MenuArena::newObject(size, nullptr);}
+void* ShortcutMenu::operator new(size_t size, MenuArena& a) {return MenuArena::newObject(size, &a);}
+void ShortcutMenu::operator delete(void* p) {MenuArena::deleteObject(p);}
+void ShortcutMenu::operator delete(void* p, MenuArena&) {MenuArena::deleteObject(p);}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
 Shortcut::Shortcut(ShortcutMenu& parentMenu, const string& name) :
 name_(name), parentmenu_(&parentMenu) {
 }
@@ -35,9 +69,11 @@ Shortcut::~Shortcut() {
   if (submenu_) delete submenu_;
 }
 
+
 void Shortcut::setName(const string& name, bool xcenter, bool ycenter) {
   name_ = name;
   centerName(xcenter, ycenter);
+  Journal::instance.record(Journal::Name, *this);
 }
 
 void Shortcut::setParentMenu(ShortcutMenu* menu) {
@@ -51,6 +87,7 @@ void Shortcut::setMenu(ShortcutMenu* menu) {
     menu->opener_ = this;
   }
   submenu_ = menu;
+  Journal::instance.record(Journal::Menu, *this);
 }
 
 bool Shortcut::isMenuOpened() const {
@@ -65,12 +102,14 @@ void Shortcut::openCloseMenu() {
   if (submenu_) submenu_->openCloseMenu();
 }
 
-Action* Shortcut::setAction(int action_index) {
-  Action* a = Actions::instance.getActionFromIndex(action_index);
+const Action* Shortcut::setAction(int action_index) {
+  const Action* a = Actions::instance.getActionFromIndex(action_index);
   if (!a) return nullptr;
   action_ = a;
   comindex_ = -1;
   arg_ = "";
+  Actions::instance.resolveShortcutAction(*this);
+  Journal::instance.record(Journal::Action, *this);
   return a;
 }
 
@@ -79,18 +118,21 @@ const Command* Shortcut::command() const {
   return action_->command(comindex_);
 }
 
-const string& Shortcut::commandName() const {
-  static const string empty;
-  if (!action_) return empty;
+const char* Shortcut::commandName() const {
+  if (!action_) return "";
   return action_->commandName(comindex_);
 }
 
 void Shortcut::setCommand(int16_t index) {
   comindex_ = index;
+  Actions::instance.resolveShortcutAction(*this);
+  Journal::instance.record(Journal::Action, *this);
 }
 
 void Shortcut::setArg(const string& arg) {
   arg_ = arg;
+  Actions::instance.resolveShortcutAction(*this);
+  Journal::instance.record(Journal::Action, *this);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -114,6 +156,7 @@ void Shortcut::setX(float x, bool move_name) {
     area_.x = x;
     setNameX(namearea_.x);
   }
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setY(float y, bool move_name) {
@@ -130,6 +173,7 @@ void Shortcut::setY(float y, bool move_name) {
     area_.y = y;
     setNameY(namearea_.y);
   }
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setPos(float x, float y) {
@@ -151,6 +195,7 @@ void Shortcut::moveName(float deltax, float deltay, bool constrained) {
     namearea_.x += deltax;
     namearea_.y += deltay;
   }
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setWidth(float width, bool move_name) {
@@ -164,6 +209,7 @@ void Shortcut::setWidth(float width, bool move_name) {
     setNameX(area_.x + (namearea_.x-area_.x) * ((width-namearea_.width) / (oldw-namearea_.width)));
   }
   else setNameX(namearea_.x);
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setHeight(float height, bool move_name) {
@@ -177,6 +223,7 @@ void Shortcut::setHeight(float height, bool move_name) {
     setNameY(area_.y + (namearea_.y-area_.y) * ((height-namearea_.height) / (oldh-namearea_.height)));
   }
   else setNameY(namearea_.x);
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::changeWidth(float delta_width, bool from_left) {
@@ -200,6 +247,7 @@ void Shortcut::changeWidth(float delta_width, bool from_left) {
   area_.x = newx;
   area_.width = neww;
   setNameX(newx + (namearea_.x-oldx) * ((neww-namearea_.width) / (oldw-namearea_.width)));
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::changeHeight(float delta_height, bool from_bottom) {
@@ -223,6 +271,7 @@ void Shortcut::changeHeight(float delta_height, bool from_bottom) {
   area_.y = newy;
   area_.height = newh;
   setNameY(newy + (namearea_.y-oldy) * ((newh-namearea_.height) / (oldh-namearea_.height)));
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setSize(float width, float height) {
@@ -246,6 +295,7 @@ void Shortcut::setNameX(float x) {
     x = area_.x + Conf::k.nameSpacing;
   }
   namearea_.x = x;
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::setNameY(float y) {
@@ -256,75 +306,93 @@ void Shortcut::setNameY(float y) {
     y = area_.y + Conf::k.nameSpacing;
   }
   namearea_.y = y;
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::centerName(bool xcenter, bool ycenter) {
   GUI::instance.layoutShortcut(*this);
   if (xcenter) namearea_.x = area_.x + (area_.width/2.f) - (namearea_.width/2.f);
   if (ycenter) namearea_.y = area_.y + (area_.height/2.f) - (namearea_.height/2.f);
+  Journal::instance.record(Journal::Area, *this);
 }
 
 void Shortcut::copyArea(const MTRect& area) {
   area_ = area;
+  Journal::instance.record(Journal::Area, *this);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 ShortcutMenu::~ShortcutMenu() {
+  if (lazy_) Conf::dropMenu(*this);
   for (auto& it : shortcuts_) delete it;
 }
 
 ShortcutMenu::ShortcutMenu(const ShortcutMenu& from) {
-  for (auto& it : from.shortcuts_) {
+  for (auto& it : from.shortcuts()) {
     Shortcut* dup = new Shortcut(*it, false);
     shortcuts_.push_back(dup);
     dup->setParentMenu(this);
   }
 }
 
+void ShortcutMenu::load() const {
+  if (lazy_) Conf::loadMenu(const_cast<ShortcutMenu&>(*this));
+}
+
 bool ShortcutMenu::addShortcut(Shortcut& s) {
+  load();
   auto it = find(shortcuts_.begin(), shortcuts_.end(), &s);
   if (it != shortcuts_.end()) return false;  // already in the menu
   else {
     shortcuts_.push_back(&s);
     s.setParentMenu(this);
+    changed_ = true;
+    Journal::instance.record(Journal::Add, s);
     return true;
   }
 }
 
 Shortcut* ShortcutMenu::addNewShortcut(const string& name) {
+  load();
   Shortcut* s = new Shortcut(*this, name);
   shortcuts_.push_back(s);
   s->setParentMenu(this);
+  changed_ = true;
+  Journal::instance.record(Journal::Add, *s);
   return s;
 }
 
 void ShortcutMenu::removeShortcut(Shortcut& s) {
   vector<Shortcut*>::iterator where;
   bool found = false;
+  load();
   
   for (auto it = shortcuts_.begin(); it != shortcuts_.end(); ++it) {
     // iterateur du shortcut dans le menu
     if (*it == &s) {found = true; where = it;}
   }
   if (found) {
+    Journal::instance.record(Journal::Remove, s);
     shortcuts_.erase(where);
+    changed_ = true;
   }
 }
 
 bool ShortcutMenu::containsShortcut(Shortcut& s) {
+  load();
   return (std::find(shortcuts_.begin(), shortcuts_.end(), &s) != shortcuts_.end());
 }
 
 Shortcut* ShortcutMenu::findShortcut(const string& name) const {
-  for (auto s : shortcuts_) {
+  for (auto s : shortcuts()) {
     if (s->name_ == name) return s;
   }
   return nullptr;
 }
 
 Shortcut* ShortcutMenu::findShortcut(const MTTouch& touch) const {
-  for (auto s : shortcuts_) {
+  for (auto s : shortcuts()) {
     if (Pad::isInside(touch.norm.pos, s->area_)) return s;
   }
   return nullptr;
@@ -339,6 +407,7 @@ bool ShortcutMenu::isCascaded() const {
 }
 
 void ShortcutMenu::openMenu(bool state) {
+  load();
   if (state) {
     MarkPad::instance.setCurrentMenu(this);
   }
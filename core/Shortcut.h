@@ -14,13 +14,56 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <atomic>
 #include "MTouch.h"
+#include "jsonserial/jsonarena.hpp"
 
 using std::string;
 class Pad;
 class ShortcutMenu;
 class Action;
 class Command;
+class CurrentAction;
+class ActionContext;
+struct ActionResult;
+struct LazyMenu;
+
+/// executes the action of a shortcut, found when the action is set (see CurrentAction::resolve()).
+using ActionHandler = void (*)(CurrentAction&, const ActionContext&, ActionResult&);
+
+/// argument of the action of a shortcut, parsed when the action is set.
+struct ActionArgs {
+  enum Volume : uint8_t {NoVolume, ChangeVolume, SetVolume, MuteVolume};
+  std::string app;                ///< "app" in "app : command" (or the app or script file).
+  std::string command;            ///< "command" in "app : command" (or the arguments).
+  std::vector<std::string> argv;  ///< arguments of a script file.
+  int appid{-1};                  ///< id of the app (see CurrentAction::getAppID), -1 if none.
+  bool currentApp{false};         ///< true if the action applies to the current app.
+  int volume{0};                  ///< volume change or value, depending on volumeMode.
+  Volume volumeMode{NoVolume};
+};
+
+/** Arena in which the shortcuts and menus read from a file are allocated.
+ * Its memory is freed when it was closed and all the shortcuts and menus it contains
+ * were deleted. The shortcuts that are kept when a file is reloaded thus stay in
+ * the arena of the file they were first read from (see Conf::applyFileChanges()).
+ */
+class MenuArena : public ccuty::JsonArena {
+public:
+  explicit MenuArena(size_t blocksize = 64*1024) : JsonArena(blocksize) {}
+  
+  /// no more objects will be created in the arena, which deletes itself when empty.
+  void close() {unref();}
+  
+private:
+  friend class Shortcut;
+  friend class ShortcutMenu;
+  ~MenuArena() = default;   // deleted by close() or when its last object is deleted
+  void unref() {if (--refs_ == 0) delete this;}
+  static void* newObject(size_t, MenuArena*);
+  static void deleteObject(void*);
+  std::atomic<size_t> refs_{1};   // objects in the arena, +1 until closed
+};
 
 /** MarkPad shortcut.
  */
@@ -40,6 +83,12 @@ public:
   // note: deletes submenu if any
   ~Shortcut();
   
+  // shortcuts read from a file are allocated in the arena of this file (see MenuArena)
+  static void* operator new(size_t);
+  static void* operator new(size_t, MenuArena&);
+  static void operator delete(void*);
+  static void operator delete(void*, MenuArena&);
+  
   bool isSelected() const {return selected_;}
   void setSelected(bool state) {selected_ = state;}
 
@@ -49,17 +98,22 @@ public:
 
   /// associated action.
   const Action* action() const {return action_;}
-  Action* setAction(int index);
+  const Action* setAction(int index);
 
   /// associated command.
   const Command* command() const;
   int16_t commandIndex() const {return comindex_;} // -1 if undefined).
-  const string& commandName() const;
+  const char* commandName() const;
   void setCommand(int16_t comindex);
 
   /// argument of the action.
   const string& arg() const {return arg_;}
   void setArg(const string& arg);
+
+  /// handler of the action and parsed argument, updated when the action, the command
+  /// or the argument is changed (null if the action can't be executed).
+  ActionHandler handler() const {return handler_;}
+  const ActionArgs& args() const {return args_;}
   
   bool isMenuOpened() const;
   void openMenu(bool state = true);
@@ -116,8 +170,10 @@ public:
   bool           selected_{false}, cannotEdit_{false},
                  touchOpenMenu_{true}, touchFromBorder_{true};
   uint8_t        modifiers_{0};
-  Action*        action_{nullptr};
+  const Action*  action_{nullptr};
   std::string    arg_, *feedback_{nullptr};
+  ActionHandler  handler_{nullptr};
+  ActionArgs     args_;
   ShortcutMenu*  parentmenu_{nullptr};
   ShortcutMenu*  submenu_{nullptr};
   MTRect         area_{};
@@ -135,6 +191,10 @@ public:
   ShortcutMenu() = default;
   ShortcutMenu(const ShortcutMenu&);
   ~ShortcutMenu();
+  static void* operator new(size_t);     // same as for Shortcut
+  static void* operator new(size_t, MenuArena&);
+  static void operator delete(void*);
+  static void operator delete(void*, MenuArena&);
 
   bool isMenuOpened() const;
   bool isCascaded() const;
@@ -156,18 +216,30 @@ public:
   Shortcut* findShortcut(const string& name) const;
   Shortcut* findShortcut(const MTTouch&) const;
   
-  long size()  const {return shortcuts_.size();}
-  bool empty() const {return shortcuts_.empty();}
-  Shortcuts& shortcuts() {return shortcuts_;}
-  const Shortcuts& shortcuts() const {return shortcuts_;}
+  long size()  const {return shortcuts().size();}
+  bool empty() const {return shortcuts().empty();}
+  Shortcuts& shortcuts() {if (lazy_) load(); return shortcuts_;}
+  const Shortcuts& shortcuts() const {if (lazy_) load(); return shortcuts_;}
+
+  /// false if the content of this menu was not yet read from the configuration file.
+  /// It is then read when needed (see Conf::lazyMenus).
+  bool isLoaded() const {return !lazy_;}
+  
+  /// reads the content of this menu if not yet done (can be called by any thread).
+  void load() const;
+
+  /// true if this menu was changed since the configuration file was last saved.
+  bool isChanged() const {return changed_;}
+  void setChanged(bool state = true) {changed_ = state;}
 
 private:
   friend class ConfImpl;
   friend class Shortcut;
-  bool isMainMenu_{false};
+  bool isMainMenu_{false}, changed_{true};
   int  shortcutNum_{0};
   Shortcut* opener_{nullptr};
   std::vector<Shortcut*> shortcuts_;
+  std::atomic<LazyMenu*> lazy_{nullptr};  // where the content is in the configuration file
 };
 
 #endif
@@ -0,0 +1,89 @@
+//
+//  Trajectory.cpp
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#include <cmath>
+#include "Trajectory.h"
+using namespace std;
+
+const char TrajectoryFile::Magic[8] = {'M','P','T','R','A','J','1','\n'};
+
+static const double TimeScale = 1e6, PosScale = 1e5, VelScale = 1e4;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static void putVarint(string& out, uint64_t v) {
+  while (v >= 0x80) {
+    out += char(v | 0x80);
+    v >>= 7;
+  }
+  out += char(v);
+}
+
+static void putDelta(string& out, int64_t value, int64_t& prev) {
+  int64_t d = value - prev;
+  prev = value;
+  putVarint(out, (uint64_t(d) << 1) ^ uint64_t(d >> 63));   // zigzag: small negative values stay small
+}
+
+static bool getVarint(const char*& p, const char* end, uint64_t& v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    unsigned char c = *p++;
+    v |= uint64_t(c & 0x7f) << shift;
+    if (!(c & 0x80)) return true;
+  }
+  return false;
+}
+
+static bool getDelta(const char*& p, const char* end, int64_t& prev) {
+  uint64_t v;
+  if (!getVarint(p, end, v)) return false;
+  prev += int64_t(v >> 1) ^ -int64_t(v & 1);
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void TrajectoryFile::encode(string& out, unsigned long num, time_t date, const Trajectory& t) {
+  putVarint(out, num);
+  putVarint(out, uint64_t(date));
+  putVarint(out, t.count);
+  int64_t prev[6] = {};
+  for (unsigned int k = 0; k < t.count; ++k) {
+    auto& s = t.samples[k];
+    putDelta(out, llround(s.time * TimeScale), prev[0]);
+    putDelta(out, llround(s.norm.pos.x * PosScale), prev[1]);
+    putDelta(out, llround(s.norm.pos.y * PosScale), prev[2]);
+    putDelta(out, llround(s.norm.velocity.x * VelScale), prev[3]);
+    putDelta(out, llround(s.norm.velocity.y * VelScale), prev[4]);
+    putDelta(out, llround(s.size * PosScale), prev[5]);
+  }
+}
+
+bool TrajectoryFile::decode(const char*& p, const char* end, Gesture& g) {
+  uint64_t num, date, count;
+  if (!getVarint(p, end, num) || !getVarint(p, end, date) || !getVarint(p, end, count)
+      || count > uint64_t(end - p)) {   // each sample takes at least 6 bytes
+    return false;
+  }
+  g.num = num;
+  g.date = time_t(date);
+  g.samples.resize(size_t(count));
+  int64_t prev[6] = {};
+  for (auto& s : g.samples) {
+    for (auto& v : prev) if (!getDelta(p, end, v)) return false;
+    s.time = prev[0] / TimeScale;
+    s.norm.pos.x = MTFloat(prev[1] / PosScale);
+    s.norm.pos.y = MTFloat(prev[2] / PosScale);
+    s.norm.velocity.x = MTFloat(prev[3] / VelScale);
+    s.norm.velocity.y = MTFloat(prev[4] / VelScale);
+    s.size = float(prev[5] / PosScale);
+  }
+  return true;
+}
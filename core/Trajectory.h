@@ -0,0 +1,67 @@
+//
+//  Trajectory.h
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+//  Trajectories of the gestures recorded by DataLogger and their binary format.
+//
+
+#ifndef MarkPad_Trajectory
+#define MarkPad_Trajectory
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+#include "MTouch.h"
+
+/// state of the gesture touch at a given frame.
+struct TrajectorySample {
+  double time;        ///< timestamp of the frame (seconds).
+  MTReadout norm;     ///< normalized position and velocity.
+  float size;         ///< area of the touch.
+};
+
+/// preallocated buffer for the samples of a gesture (see DataLogger).
+struct Trajectory {
+  static const unsigned int MaxSamples = 4096;   // about 30 seconds at full frame rate
+  unsigned int count{};   // the next frames are ignored when MaxSamples is reached
+  TrajectorySample samples[MaxSamples];
+
+  void clear() {count = 0;}
+
+  void add(const MTTouch& t) {
+    if (count < MaxSamples) samples[count++] = TrajectorySample{t.time, t.norm, t.size};
+  }
+};
+
+/** Binary format of trajectory files.
+ * The file starts with Magic, followed by one record per gesture:
+ * - the gesture number (as in the gestures log), its date (seconds since 1970)
+ *   and the number of samples, as unsigned varints,
+ * - the samples, as signed (zigzag) varints that are the difference with the
+ *   previous sample of the gesture (the first one is relative to 0): time in
+ *   microseconds, position and size in 1/100000, velocity in 1/10000.
+ */
+class TrajectoryFile {
+public:
+  static const char Magic[8];
+
+  struct Gesture {
+    unsigned long num{};
+    std::time_t date{};
+    std::vector<TrajectorySample> samples;
+  };
+
+  /// appends the record of a gesture to _out_.
+  static void encode(std::string& out, unsigned long num, std::time_t date, const Trajectory&);
+
+  /// decodes the record at _p_ (which is then moved to the next one), returns false at
+  /// the end of _data_ or if it is truncated or invalid.
+  static bool decode(const char*& p, const char* end, Gesture&);
+};
+
+#endif
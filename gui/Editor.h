@@ -286,7 +286,7 @@ public:
     else return ActionWithMenu;
   }
   
-  Action* setShortcutAction(Shortcut* s, int actionNo) {
+  const Action* setShortcutAction(Shortcut* s, int actionNo) {
     auto* a = Actions::instance.getActionFromIndex(actionNo);
     if (!s || !a) return nullptr;
     
@@ -299,7 +299,7 @@ public:
     }
     
     s->setAction(actionNo);
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     setText(del->commandField, "");
     
     if (actionNo == 0) {    // action 0 is OpenMenu
@@ -333,7 +333,7 @@ public:
     
     const Command* c = s->command();
     if (c && c->helper) (c->helper->fun)(*c->helper, s, c, index);
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     updateShortcut(s);
   }
   
@@ -346,7 +346,7 @@ public:
     s->setCommand(index);
     const Command* c = s->command();
     if (c) s->setName(c->title, true, false); // preset shortcut title
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     updateShortcut(s);
   }
   
@@ -355,12 +355,12 @@ public:
     if (!s) return;
     s->setArg(str);
     if (choosing_URL) showDesktop(false);
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     Overlay::instance.update();
   }
   
   // show tip when the cursor moves over the action buttons
-  void showActionTip(Action* a, bool enter) {
+  void showActionTip(const Action* a, bool enter) {
     if (!a) return;
     if (enter) {
       setColor(del->actionTitle, tipColor);
@@ -391,7 +391,7 @@ public:
       setText(del->commandField, filename);
       s->setArg(filename);
       s->setName(ccuty::basename(filename), true, false);
-      Conf::mustSave();
+      Conf::mustSave(s->parentMenu());
     }
     showDesktop(false);
     hideEditor(false);  // needed by Qt - marche pas: cache l'editeur a revoir!!!
@@ -491,7 +491,7 @@ public:
     }
     
     // action exists
-    selectAction(action->actionID);
+    selectAction(action->actionID());
     show(del->commandPane, true);
     setColor(del->actionTitle, selectionColor);
     //setBgColor(del->actionTitle, selectionBgColor);
@@ -515,11 +515,11 @@ public:
     const Command* cmd = action->command(*s);
     if (!cmd) setText(del->actionCommand, "");
     else {
-      setText(del->actionCommand, cmd->title+" "+cmd->help);
+      setText(del->actionCommand, std::string(cmd->title)+" "+cmd->help);
       setHelper(action, cmd->helper);
     }
     
-    if (cmd && !cmd->arg.empty()) {
+    if (cmd && cmd->arg[0]) {
       if (cmd->arg[0] == '?') {
         showActionField = true;
         if (action->isHotkey()) {
@@ -684,7 +684,7 @@ public:
     if (!s) return;
     // we may have duplicated names but the conf format supports it
     s->setName(str, true, false);
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     Overlay::instance.update();
   }
 
@@ -700,7 +700,7 @@ public:
     else if (w == del->areaH) s->setHeight(val);
     else if (w == del->nameX) s->setNameX(val);
     else if (w == del->nameY) s->setNameY(val);
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     updateShortcutSize(s);
   }
   
@@ -716,7 +716,7 @@ public:
     else if (w == del->areaHField) s->setHeight(getFloat(w));
     else if (w == del->nameXField) s->setNameX(getFloat(w));
     else if (w == del->nameYField) s->setNameY(getFloat(w));
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     Overlay::instance.update();
   }
   
@@ -744,7 +744,7 @@ public:
       s->setNameX(stepperIncr(sender) + s->nameX());
     else if (sender == del->nameY)
       s->setNameY(stepperIncr(sender) + s->nameY());
-    Conf::mustSave();
+    Conf::mustSave(s->parentMenu());
     updateShortcutSize(s);
   }
 #endif
@@ -673,7 +673,10 @@ void Overlay::initGeometry(Pad* ppad) {
 }
 
 void Overlay::updateShortcuts() {
-  Conf::mustSave();
+  // active borders are saved with the Conf, shortcuts with their menu
+  if (mp.editMode() == mp.EditBorders) Conf::mustSave();
+  else if (pressedShortcut) Conf::mustSave(pressedShortcut->parentMenu());
+  else Conf::mustSave(mp.currentMenu());
   updateGeometry = true;
   GUI::instance.updateShortcutSize(pressedShortcut);
   if (pad && impl) impl->needsDisplay();
@@ -0,0 +1,90 @@
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  Arena for the objects created when reading JSON data.
+//  (C) Eric Lecolinet 2017/2018 - https://www.telecom-paristech.fr/~elc
+//
+
+#ifndef ccuty_jsonarena
+#define ccuty_jsonarena
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ccuty {
+
+  /** @brief Allocates objects contiguously and releases them all at once.
+   *  Objects are created in an arena when JsonSerial::read() is given an arena and
+   *  their class was declared with an arena creator (see JsonClasses::defclass()).
+   *
+   *  The arena does NOT call destructors: release() just frees its memory. Objects
+   *  that own other resources must thus be destroyed by their owner before that
+   *  (their class can define operator new and operator delete so that delete does
+   *  nothing for the memory of an arena, e.g. by preceding each object with a header
+   *  that tells where it was allocated).
+   *
+   *  An arena must be used by a single thread at a time.
+   */
+  class JsonArena {
+  public:
+    /// _blocksize_ is the size of the first block, the next ones are larger.
+    explicit JsonArena(size_t blocksize = 64*1024) : blocksize_(blocksize) {}
+
+    ~JsonArena() {release();}
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+
+    /// returns aligned memory for _size_ bytes (_align_ must be a power of 2).
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+      size_t pos = (pos_ + align - 1) & ~(align - 1);
+      if (blocks_.empty() || pos + size > blocks_.back().size) {
+        size_t bsize = blocks_.empty() ? blocksize_ : blocks_.back().size * 2;
+        while (bsize < size + align) bsize *= 2;
+        char* mem = static_cast<char*>(std::malloc(bsize));
+        if (!mem) throw std::bad_alloc();
+        blocks_.push_back(Block{mem, bsize});
+        pos_ = 0;
+        pos = (size_t(-reinterpret_cast<uintptr_t>(mem))) & (align - 1);
+      }
+      pos_ = pos + size;
+      used_ += size;
+      return blocks_.back().mem + pos;
+    }
+
+    /// creates an object in the arena (the operator new of its class is not called).
+    template <class T, class... Args> T* make(Args&&... args) {
+      return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /// frees all the memory of the arena (destructors are not called).
+    void release() {
+      for (auto& it : blocks_) std::free(it.mem);
+      blocks_.clear();
+      pos_ = used_ = 0;
+    }
+
+    /// number of bytes that were allocated in the arena.
+    size_t used() const {return used_;}
+
+    /// returns true if this memory belongs to this arena.
+    bool owns(const void* p) const {
+      const char* c = static_cast<const char*>(p);
+      for (auto& it : blocks_) {
+        if (c >= it.mem && c < it.mem + it.size) return true;
+      }
+      return false;
+    }
+
+  private:
+    struct Block {char* mem; size_t size;};
+
+    size_t blocksize_, pos_{0}, used_{0};
+    std::vector<Block> blocks_;
+  };
+}
+
+#endif
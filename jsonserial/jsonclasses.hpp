@@ -27,6 +27,7 @@ namespace ccuty {
     virtual ~MetaClass() {}
     virtual const std::string& classname() const = 0;
     virtual void* create() const = 0;
+    virtual void* create(JsonArena&) const = 0;
     virtual bool readMember(JsonSerial&, void* obj, const std::string& name,
                             const std::string& value) const = 0;
     virtual void writeMembers(JsonSerial&, const void* obj) const = 0;
@@ -44,6 +45,21 @@ namespace ccuty {
   
   template <class T, class Enable = void> struct JsonArrayImpl : public JsonArray {};
   
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  
+  /// @internal Member variable declared by JsonClasses::field().
+  template <class C, typename Var> struct JsonVarField {
+    std::string name;
+    Var C::* var;
+  };
+  
+  /// @internal Member read and written by functions declared by JsonClasses::field().
+  template <class C> struct JsonFunField {
+    std::string name;
+    void (*read)(C&, JsonSerial&, const std::string&);
+    void (*write)(const C&, JsonSerial&);
+  };
+  
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   
   /** Serves to declare the (serialized) members of a C++ class.
@@ -188,6 +204,24 @@ namespace ccuty {
                         std::function<void(C&, JsonSerial&, const std::string& value)> read,
                         std::function<void(const C&, JsonSerial&)> write);
     
+    /** Declares members that are read without searching a map.
+     * Arguments:
+     * - _fields_: members returned by JsonClasses::field()
+     *
+     * Each member is read by a non-virtual function that is generated at compile
+     * time for its type (the value is directly converted and assigned to the variable).
+     * These functions are stored in a perfect hash table of the member names (which
+     * are hashed entirely). As the names are arguments of this method, the seed of
+     * the table is searched when the class is declared, finding a member then
+     * requires hashing its name and a single comparison.
+     *
+     * This method should be used for classes that have many instances (e.g. objects
+     * stored in large containers). It can be combined with member(), the members
+     * are written in the order they were declared.
+     */
+    template <typename... Fields>
+    ObjectClass& members(const Fields&... fields);
+    
     /** Calls a function once all members have been read.
      * Argument:
      * - _fun_: a function that is called after all members have been read
@@ -231,12 +265,22 @@ namespace ccuty {
   protected:
     friend class ccuty::JsonClasses;
     
-    ObjectClass(JsonClasses& classes, const std::string& classname, std::function<C*()> creator)
-    : classes_(classes), classname_(classname), creator_(creator) {}
+    ObjectClass(JsonClasses& classes, const std::string& classname, std::function<C*()> creator,
+                std::function<C*(JsonArena&)> arenacreator = nullptr)
+    : classes_(classes), classname_(classname), creator_(creator), arenacreator_(arenacreator) {}
     virtual ~ObjectClass() {for (auto& it : members_) delete it;}
     
     void* create() const override {return creator_ ? (creator_)() : nullptr;}
+    void* create(JsonArena& a) const override {return arenacreator_ ? (arenacreator_)(a) : create();}
     void addMember(const std::string& varname, Member*);
+    template <typename Var> void addField(const JsonVarField<C,Var>&);
+    void addField(const JsonFunField<C>&);
+    template <class M> void addFastMember(M*);
+    template <class M> static void fastRead(JsonSerial& js, C& obj, Member* m, const std::string& val)
+    {static_cast<M*>(m)->M::read(js, obj, val);}  // qualified call: not virtual
+    static uint64_t hashName(const std::string& name);
+    size_t fastSlot(uint64_t hash) const;
+    void makeFastTable();
     Member* getMember(const std::string& varname) const;
     bool readMember(JsonSerial&, void* obj, const std::string& name, const std::string& val) const override;
     void writeMembers(JsonSerial&, const void* obj) const override;
@@ -257,8 +301,17 @@ namespace ccuty {
     const std::string classname_;
     Superclasses superclasses_;
     std::function<C*()> creator_{nullptr};
+    std::function<C*(JsonArena&)> arenacreator_{nullptr};
     std::list<Member*> members_;
     std::unordered_map<std::string, Member*> membermap_;
+    
+    struct FastMember {
+      Member* member;
+      void (*read)(JsonSerial&, C&, Member*, const std::string&);
+      uint64_t hash;
+    };
+    std::vector<FastMember> fastmembers_, fasttable_;  // fasttable_ is a perfect hash
+    uint64_t fastseed_{0};
     std::function<void(C&)> postread_{nullptr};
     std::function<void(const C&)> postwrite_{nullptr};
   };
@@ -269,6 +322,7 @@ namespace ccuty {
   public:
     const std::string& classname() const override {static std::string s("std::map"); return s;}
     void* create() const override {return new C();}
+    void* create(JsonArena&) const override {return new C();}
     bool readMember(JsonSerial&, void* obj, const std::string& name, const std::string& value) const override;
     void writeMembers(JsonSerial&, const void* obj) const override;
     void doPostRead(void*) const override {}
@@ -334,6 +388,44 @@ namespace ccuty {
     template <class Class>
     ObjectClass<Class>& defclass(const std::string& classname, std::function<Class*()> creator);
     
+    /** Declares a class which instances are created in an arena when one is given to JsonSerial::read().
+     * Arguments:
+     * - _classname_: the UTF8 name of the C++ class.
+     * - _creator_: a helper function that creates an instance of this class (see above)
+     * - _arenacreator_: a helper function that creates an instance in an arena,
+     *   typically by calling JsonArena::make().
+     *
+     * _creator_ is used when JsonSerial::read() is not given an arena.
+     * Note that objects created in an arena must not be deleted unless their class
+     * redefines operator delete (see JsonArena).
+     */
+    template <class Class>
+    ObjectClass<Class>& defclass(const std::string& classname, std::function<Class*()> creator,
+                                 std::function<Class*(JsonArena&)> arenacreator);
+    
+    /** Declares a member variable for ObjectClass::members().
+     * Arguments:
+     * - _varname_: the UTF8 name of variable as it will appear in the JSON file
+     * - _var_: an instance variable
+     */
+    template <typename Var, class Class>
+    static JsonVarField<Class,Var> field(const std::string& varname, Var Class::* var) {
+      return JsonVarField<Class,Var>{varname, var};
+    }
+    
+    /** Declares a member that is serialized using custom functions for ObjectClass::members().
+     * Arguments:
+     * - _varname_: the UTF8 name of variable as it will appear in the JSON file
+     * - _read_, _write_: same as for ObjectClass::member() except that they must be
+     *   static methods or non-member functions.
+     */
+    template <class Class>
+    static JsonFunField<Class> field(const std::string& varname,
+                                     void (*read)(Class&, JsonSerial&, const std::string& value),
+                                     void (*write)(const Class&, JsonSerial&)) {
+      return JsonFunField<Class>{varname, read, write};
+    }
+    
     /// produces an error.
     void error(JsonError::Type type, const std::string& arg, const std::string& where) {
       if (!jsonerror_) jsonerror_ = new JsonError();
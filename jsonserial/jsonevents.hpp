@@ -0,0 +1,50 @@
+//
+//  JsonSerial: C++ Object Serialization in JSON.
+//  Events produced when reading JSON data.
+//  (C) Eric Lecolinet 2017/2018 - https://www.telecom-paristech.fr/~elc
+//
+
+#ifndef ccuty_jsonevents
+#define ccuty_jsonevents
+
+#include <string>
+
+namespace ccuty {
+
+  /** @brief Event produced by JsonSerial::nextEvent().
+   *  _text_ is the name of the member for Key and the value for Value (strings are
+   *  unquoted, other values are returned as they appear in the JSON data).
+   *  @see JsonSerial::nextEvent(), JsonHandler.
+   */
+  struct JsonEvent {
+    enum Type {End, StartObject, EndObject, StartArray, EndArray, Key, Value};
+    Type type{End};
+    std::string text;
+  };
+
+  /** @brief Receives the events produced by JsonSerial::scan().
+   *  Each function returns:
+   *  - Continue to go on,
+   *  - Skip to skip the content of the object or the array that has just been started,
+   *    or the value of the member that has just been named,
+   *  - Stop to stop reading.
+   *
+   *  JSON data is never entirely loaded in memory, this makes it possible to scan
+   *  large files with bounded memory.
+   *  @see JsonSerial::scan().
+   */
+  class JsonHandler {
+  public:
+    enum Action {Continue, Skip, Stop};
+
+    virtual ~JsonHandler() = default;
+    virtual Action startObject() {return Continue;}
+    virtual Action endObject() {return Continue;}
+    virtual Action startArray() {return Continue;}
+    virtual Action endArray() {return Continue;}
+    virtual Action key(const std::string& /*name*/) {return Continue;}
+    virtual Action value(const std::string& /*value*/) {return Continue;}
+  };
+}
+
+#endif
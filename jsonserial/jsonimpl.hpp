@@ -243,47 +243,48 @@ namespace ccuty {
     }
     else if (s != "{") js.error(JsonError::ExpectingBrace);
     
-    while (js.in_->good()) {
-      std::string name, value;
-      bool found1, found2;
-      js.readLine(name, value, found1, found2, true);
-      if (!found1) js.error(JsonError::ExpectingPairOrBrace);
-      else if (!found2 && name != "}") js.error(JsonError::ExpectingPairOrBrace);
+    JsonEvent name, value;
+    while (true) {
+      js.nextEvent(name);   // Key or EndObject
+      if (name.type == JsonEvent::Key) js.nextEvent(value);  // Value or start of object/array
+      else if (name.type != JsonEvent::EndObject) js.error(JsonError::ExpectingPairOrBrace);
       
-      if (name[0]=='@' && name != "@class" && name != "@id")
-        js.error(JsonError::WrongKeyword, value);
+      if (name.text[0]=='@' && name.text != "@class" && name.text != "@id")
+        js.error(JsonError::WrongKeyword, value.text);
       
       if (!objclass) {  // search class
-        if (name != "@class") objclass = pointerclass;
+        if (name.text != "@class") objclass = pointerclass;
         else { // polymorphism
-          objclass = js.classes_.getClass(value);
-          if (!objclass) js.error(JsonError::UnknownClass, value);
+          objclass = js.classes_.getClass(value.text);
+          if (!objclass) js.error(JsonError::UnknownClass, value.text);
         }
         if (!obj) { // create object if it does not exist
           if (cr) obj = cr->create();
+          else if (js.arena_) obj = objclass->create(*js.arena_);
           else obj = objclass->create();
         }
         if (!obj) js.error(JsonError::AbstractClass, objclass->classname());
-        if (name == "@class") continue;
+        if (name.text == "@class") continue;
       }
       
-      if (name == "}") {objclass->doPostRead(obj); return obj;}  // end of object
-      else if (name == "@id") {  // id of object
-        jsp = &js.id_to_object_[std::stoul(value)];
+      if (name.type == JsonEvent::EndObject) {objclass->doPostRead(obj); return obj;}
+      else if (name.text == "@id") {  // id of object
+        jsp = &js.id_to_object_[std::stoul(value.text)];
         jsp->raw_ = obj;
         continue;
       }
       else try {
-        if (!objclass->readMember(js, obj, name, value))
+        if (!objclass->readMember(js, obj, name.text, value.text)) {
           js.error(JsonError::UnknownMember,
-                   "'" +name + "' in class '" + objclass->classname()+"'",
+                   "'" +name.text + "' in class '" + objclass->classname()+"'",
                    false/*not fatal*/);
+          js.skipValue(value);
+        }
       }
       catch (std::invalid_argument) {
-        js.error(JsonError::InvalidValue, value+" for member '"+name+"'");
+        js.error(JsonError::InvalidValue, value.text+" for member '"+name.text+"'");
       }
     }
-    js.error(JsonError::PrematureEOF);
     return nullptr;
   }
   
@@ -294,14 +295,12 @@ namespace ccuty {
                         JsonArray& a, MetaClass::Creator* cr,
                         const std::string& s) {
     if (s != "[") js.error(JsonError::ExpectingBracket);
-    while (js.in_->good()) {
-      std::string tok, dump;
-      bool found1, found2;
-      js.readLine(tok, dump, found1, found2, false);
-      if (!found1) js.error(JsonError::ExpectingValueOrBracket);
-      else if (tok == "]") {a.end(js); return;} // end of array
-      //else if (tok == "null");  // null element ignored
-      else a.add(js, cr, tok);
+    JsonEvent element;
+    while (true) {
+      js.nextEvent(element);   // Value, start of object/array or EndArray
+      if (element.type == JsonEvent::EndArray) {a.end(js); return;} // end of array
+      //else if (element.text == "null");  // null element ignored
+      else a.add(js, cr, element.text);
     }
   }
   
@@ -489,6 +488,22 @@ namespace ccuty {
     std::function<void(const T&, JsonSerial&)> writefun_;
   };
   
+  template <typename T>
+  struct InstanceFunMember : public ObjectClass<T>::Member {
+    InstanceFunMember(const std::string& name,
+                      void (*readfun)(T&, JsonSerial&, const std::string&),
+                      void (*writefun)(const T&, JsonSerial&))
+    : ObjectClass<T>::Member(name), readfun_(readfun), writefun_(writefun) {}
+    
+    bool isCustom() const override {return true;}
+    void read(JsonSerial& js, T& obj, const std::string& val) override {(readfun_)(obj,js,val);}
+    void write(JsonSerial& js, const T& obj) override {(writefun_)(obj,js);}
+    
+  protected:
+    void (*readfun_)(T&, JsonSerial&, const std::string&);
+    void (*writefun_)(const T&, JsonSerial&);
+  };
+  
   // - - - - - - - -
   
   template <class T>
@@ -548,6 +563,76 @@ namespace ccuty {
     return *this;
   }
   
+  template <class T>
+  template <typename... Fields>
+  ObjectClass<T>& ObjectClass<T>::members(const Fields&... fields) {
+    using expand = int[];
+    (void)expand{0, (addField(fields), 0)...};
+    makeFastTable();
+    return *this;
+  }
+  
+  template <class T>
+  template <typename Var>
+  void ObjectClass<T>::addField(const JsonVarField<T,Var>& f) {
+    addFastMember(new InstanceMember<T,Var>(f.name, f.var));
+  }
+  
+  template <class T>
+  void ObjectClass<T>::addField(const JsonFunField<T>& f) {
+    addFastMember(new InstanceFunMember<T>(f.name, f.read, f.write));
+  }
+  
+  template <class T>
+  template <class M>
+  void ObjectClass<T>::addFastMember(M* m) {
+    if (getMember(m->name())) {
+      classes_.error(JsonError::RedefinedMember,": member "+m->name()+" of class "+classname_, "members()");
+      delete m;
+    }
+    else {
+      addMember(m->name(), m);   // also used for writing and by getMember()
+      fastmembers_.push_back(FastMember{m, fastRead<M>, hashName(m->name())});
+    }
+  }
+  
+  // FNV-1a hash of the whole name (same as ccuty::strhash())
+  template <class T>
+  uint64_t ObjectClass<T>::hashName(const std::string& s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+  
+  template <class T>
+  size_t ObjectClass<T>::fastSlot(uint64_t hash) const {
+    return size_t(((hash ^ fastseed_) * 0x9E3779B97F4A7C15ULL) >> 40) & (fasttable_.size()-1);
+  }
+  
+  // searches a table size (a power of 2) and a seed so that names do not collide.
+  template <class T>
+  void ObjectClass<T>::makeFastTable() {
+    size_t minsize = 1;
+    while (minsize < 2 * fastmembers_.size()) minsize <<= 1;
+    for (size_t size = minsize; size <= minsize * 8; size <<= 1) {
+      for (uint64_t attempt = 1; attempt <= 1000; ++attempt) {
+        fastseed_ = attempt * 0x2545F4914F6CDD1DULL;
+        fasttable_.assign(size, FastMember{nullptr, nullptr, 0});
+        bool collision = false;
+        for (auto& it : fastmembers_) {
+          auto& slot = fasttable_[fastSlot(it.hash)];
+          if (slot.member) {collision = true; break;}
+          slot = it;
+        }
+        if (!collision) return;
+      }
+    }
+    fasttable_.clear();  // unlikely: members are then found by getMember()
+  }
+  
   template <class T>
   template <typename Super>
   ObjectClass<T>& ObjectClass<T>::extends() {
@@ -582,6 +667,14 @@ namespace ccuty {
   
   template <class T>
   bool ObjectClass<T>::readMember(JsonSerial& js, void* obj, const std::string& name, const std::string& val) const {
+    if (!fasttable_.empty()) {          // members declared by members()
+      uint64_t hash = hashName(name);
+      auto& f = fasttable_[fastSlot(hash)];
+      if (f.member && f.hash == hash && f.member->name() == name) {
+        (f.read)(js, *static_cast<T*>(obj), f.member, val);
+        return true;
+      }
+    }
     if (auto mb = getMember(name)) {    // search in subclass first
       mb->read(js, *static_cast<T*>(obj), val);
       return true;
@@ -598,9 +691,9 @@ namespace ccuty {
       it.super_->writeMembers(js, (it.upcast_)((void*)obj));
     }
     for (auto& it : members_) {  // then print members (can't be shadowed!)
-      if (js.needcomma_) *(js.out_) << ",\n"; js.needcomma_ = false;
+      js.writeSeparator();
       if (it->isCustom()) js.token1_ = it->name();
-      else {js.writeTabs(); *(js.out_) << '"' << it->name() << "\": ";}
+      else js.writeKey(it->name());
       it->write(js, *static_cast<const T*>(obj));
     }
   }
@@ -627,17 +720,22 @@ namespace ccuty {
   template <class T>
   void MapClass<T>::writeMembers(JsonSerial& js, const void* map) const {
     for (auto& it : *static_cast<const T*>(map)) {
-      if (js.needcomma_) *(js.out_) << ",\n";
-      js.needcomma_ = false;
-      js.writeTabs(); *(js.out_) << '"' << it.first << "\": ";
+      js.writeSeparator();
+      js.writeMapKey(it.first);
       js.writeValue(it.second);
     }
   }
   
   template <class T>
   ObjectClass<T> & JsonClasses::defclass(const std::string& classname, std::function<T*()> creator) {
+    return defclass<T>(classname, creator, nullptr);
+  }
+  
+  template <class T>
+  ObjectClass<T> & JsonClasses::defclass(const std::string& classname, std::function<T*()> creator,
+                                         std::function<T*(JsonArena&)> arenacreator) {
     if (getClass(classname)) error(JsonError::RedefinedClass, classname, "defclass()");
-    ObjectClass<T>* cl = new ObjectClass<T>(*this, classname, creator);
+    ObjectClass<T>* cl = new ObjectClass<T>(*this, classname, creator, arenacreator);
     classindexes_[std::type_index(typeid(T))] = classnames_[classname] = cl;
     return *cl;
   }
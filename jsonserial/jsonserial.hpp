@@ -79,10 +79,15 @@
 
 #include <string.h>
 #include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <clocale>
+#include <cmath>
 #include <locale>
 #include <memory>
 #include <type_traits>
 #include <functional>
+#include <algorithm>
 #include <typeinfo>
 #include <typeindex>
 #include <utility>
@@ -91,9 +96,12 @@
 #include <fstream>
 #include <sstream>
 #include <list>
+#include <vector>
 #include <unordered_map>
 #include "jsondefs.hpp"
 #include "jsonerror.hpp"
+#include "jsonevents.hpp"
+#include "jsonarena.hpp"
 #include "jsonclasses.hpp"
 
 namespace ccuty {
@@ -101,10 +109,12 @@ namespace ccuty {
   /** Reads/writes C++ objects from/to a JSON file. 
    * See:
    * - jsonserial.hpp for explanations and an example.
-   * - read() to read objects from a JSON file
+   * - read() to read objects from a JSON file (possibly in a JsonArena)
    * - write() to write objects to a JSON file
+   * - scan() to read a JSON file without creating objects
    * - setSharing() to share objects whithout duplicating them
    * - setSyntax() to relax syntax.
+   * - setFormat() to read/write binary data (CBOR) instead of JSON text.
    */
   class JsonSerial {
   public:
@@ -127,7 +137,7 @@ namespace ccuty {
     template <class T>
     bool read(T& object, const std::string& filename) {
       try {
-        std::ifstream input(filename);
+        std::ifstream input(filename, format_ == Cbor ? std::ios::binary : std::ios::in);
         if (!input) {
           reset(filename, 0, nullptr, nullptr);
           error(JsonError::CantReadFile);
@@ -146,10 +156,83 @@ namespace ccuty {
               const std::string& streamname = "", size_t firstline = 1) {
       try {
         reset(streamname, firstline, &stream, nullptr);
-        std::string keyword, dump;
-        bool found1, found2;
-        readLine(keyword, dump, found1, found2, true);
-        if (found1) readValue(*this, object, keyword); else error(JsonError::NoData);
+        JsonEvent event;
+        nextEvent(event);
+        if (event.type != JsonEvent::End) readValue(*this, object, event.text);
+        else error(JsonError::NoData);
+      }
+      catch (JsonError* e) {return false;}
+      return !jsonerror_;
+    }
+    
+    /** Reads an object and its members recursively from a JSON file, objects are created in an arena.
+     *  Only the objects which class was declared with an arena creator are created in the
+     *  arena (see JsonClasses::defclass()), the other ones are allocated as usual.
+     *  This makes it possible to allocate objects contiguously and to release them all at once.
+     *  Returns false an prints a message in case of an error (see constructor for details)
+     */
+    template <class T>
+    bool read(T& object, const std::string& filename, JsonArena& arena) {
+      arena_ = &arena;
+      bool stat = read(object, filename);
+      arena_ = nullptr;
+      return stat;
+    }
+    
+    /** Reads an object and its members recursively from an input stream, objects are created in an arena.
+     *  @see the previous function.
+     */
+    template <class T>
+    bool read(T& object, std::istream& stream, JsonArena& arena,
+              const std::string& streamname = "", size_t firstline = 1) {
+      arena_ = &arena;
+      bool stat = read(object, stream, streamname, firstline);
+      arena_ = nullptr;
+      return stat;
+    }
+
+    /** Reads a JSON file and calls the functions of the handler for each event.
+     *  Objects are not created, this makes it possible to scan (possibly large) files
+     *  with bounded memory, to skip what is not needed and to stop early (see JsonHandler).
+     *  Returns false an prints a message in case of an error.
+     */
+    bool scan(JsonHandler& handler, const std::string& filename) {
+      try {
+        std::ifstream input(filename);
+        if (!input) {
+          reset(filename, 0, nullptr, nullptr);
+          error(JsonError::CantReadFile);
+        }
+        else if (!scan(handler, input, filename, 1)) return false;
+      }
+      catch (JsonError* e) {return false;}
+      return !jsonerror_;
+    }
+
+    /** Reads JSON data from an input stream and calls the functions of the handler
+     *  for each event. Returns false an prints a message in case of an error.
+     */
+    bool scan(JsonHandler& handler, std::istream& stream,
+              const std::string& streamname = "", size_t firstline = 1) {
+      try {
+        reset(streamname, firstline, &stream, nullptr);
+        JsonEvent event;
+        do {
+          nextEvent(event);
+          JsonHandler::Action action = JsonHandler::Continue;
+          switch (event.type) {
+            case JsonEvent::End: return !jsonerror_;
+            case JsonEvent::StartObject: action = handler.startObject(); break;
+            case JsonEvent::EndObject: action = handler.endObject(); break;
+            case JsonEvent::StartArray: action = handler.startArray(); break;
+            case JsonEvent::EndArray: action = handler.endArray(); break;
+            case JsonEvent::Key: action = handler.key(event.text); break;
+            case JsonEvent::Value: action = handler.value(event.text); break;
+          }
+          if (action == JsonHandler::Stop) break;
+          else if (action == JsonHandler::Skip) skipValue(event);
+        }
+        while (!nesting_.empty());   // a single value at the first level
       }
       catch (JsonError* e) {return false;}
       return !jsonerror_;
@@ -161,7 +244,7 @@ namespace ccuty {
     template <class T>
     bool write(const T& object, const std::string& filename) {
       try {
-        std::ofstream output(filename);
+        std::ofstream output(filename, format_ == Cbor ? std::ios::binary : std::ios::out);
         if (!output) {
           reset(filename, 0, nullptr, nullptr);
           error(JsonError::CantWriteFile);
@@ -181,12 +264,61 @@ namespace ccuty {
       try {
         reset(streamname, firstline, nullptr, &stream);
         writeValue(object);
-        *out_ << "\n" << std::endl;
+        if (format_ == Json) put("\n\n", 2);
+        flushOutput();
+        stream.flush();
       }
       catch (JsonError* e) {return false;}
       return !jsonerror_;
     }
     
+    /** Writes an object and its members recursively at the end of a string.
+     *  This is faster than writing on a stream. Floating point numbers are written
+     *  as specified by setPrecision().
+     *  Returns false an prints a message in case of an error (see constructor for details)
+     */
+    template <class T>
+    bool writeBuffer(const T& object, std::string& buffer) {
+      try {
+        reset("", 1, nullptr, nullptr);
+        buf_ = &buffer;
+        writeValue(object);
+        if (format_ == Json) put("\n\n", 2);
+      }
+      catch (JsonError* e) {return false;}
+      return !jsonerror_;
+    }
+
+    /** Writes an object as if it was nested in a JSON file.
+     *  Same as write() except that the object is indented as if it was located
+     *  at nesting level _level_ and that no newline is added after it. Combined with
+     *  setRecorder(), this makes it possible to replace an object in a JSON file
+     *  that was previously written. Object sharing is not supported in this case.
+     */
+    template <class T>
+    bool writeFragment(const T& object, std::ostream& stream, int level,
+                       const std::string& streamname = "") {
+      try {
+        reset(streamname, 1, nullptr, &stream);
+        if (sharing_) error(JsonError::CantWriteFile, "sharing not allowed in fragments");
+        level_ = level < 0 ? 0 : level;
+        writeValue(object);
+        flushOutput();
+      }
+      catch (JsonError* e) {return false;}
+      return !jsonerror_;
+    }
+
+    /** Function that is called each time an object has been written.
+     *  _begin_ and _end_ are the positions of the object in the output stream
+     *  (from its opening brace to its closing brace included), _level_ its nesting level.
+     */
+    using Recorder = std::function<void(const MetaClass& cl, const void* obj,
+                                        size_t begin, size_t end, int level)>;
+
+    /// Sets (or removes if _recorder_ is null) the function that records written objects.
+    void setRecorder(Recorder recorder) {recorder_ = recorder;}
+
     /// Returns the corresponding JsonClasses object.
     JsonClasses& getClasses() {return classes_;}
 
@@ -206,6 +338,23 @@ namespace ccuty {
     /// Return true if object sharing is allowed.
     bool getSharing() const {return sharing_;}
     
+    /** Data formats.
+     * - Json: JSON text (the default)
+     * - Cbor: CBOR binary data (RFC 8949)
+     */
+    enum Format {Json, Cbor};
+    
+    /** Sets the format of the data that is read or written.
+     *  CBOR data has the same structure as JSON data (same members, same @class and
+     *  @id fields, etc.), thus all declared classes can be serialized in both formats.
+     *  CBOR data is more compact and faster to read, and floating point numbers are
+     *  written with full precision. Streams must be opened in binary mode.
+     */
+    void setFormat(Format format) {format_ = format;}
+    
+    /// Returns the current data format.
+    Format getFormat() const {return format_;}
+    
     /* JSON syntax.
      * - Strict: strict JSON syntax
      * - Relaxed: all options are allowed
@@ -236,15 +385,39 @@ namespace ccuty {
 
     /// Returns current indentation.
     void getIndent(char& tabchar, unsigned int& tabcount) const {tabchar = tabchar_; tabcount = indent_;}
+    
+    /** Specifies how floating point numbers are written by writeBuffer().
+     *  _precision_ and _fixed_ have the same meaning as std::ostream::precision()
+     *  and std::fixed. The settings of the stream are used when writing on a stream.
+     */
+    void setPrecision(int precision, bool fixed = false) {precision_ = precision; fixed_ = fixed;}
 
     template <class T>
     void readMember(T& variable, const std::string& str) {
       readValue(*this, variable, str);
     }
     
+    /** Skips the object or the array that is the value of the member being read.
+     *  Can be called by the read function of a member (see JsonClasses::field()) with the
+     *  value it was given. Returns false if this value is not an object or an array, or if
+     *  the input is not a seekable JSON stream. Otherwise, the value is between _begin_
+     *  and _end_ in the stream and starts at line _line_: it can then be read later.
+     */
+    bool skipMember(const std::string& value, size_t& begin, size_t& end, size_t& line) {
+      if (!in_ || format_ != Json || (value != "{" && value != "[")) return false;
+      std::streamoff pos = in_->tellg();
+      if (pos <= 0) return false;
+      begin = size_t(pos) - 1;   // the brace was just read
+      line = lineno_;
+      skipRawValue();
+      pos = in_->tellg();
+      end = pos < 0 ? begin : size_t(pos);
+      return true;
+    }
+
     template <class T>
     void writeMember(const T& variable) {
-      writeTabs(); *out_ << '"' << token1_ << "\": ";
+      writeKey(token1_);
       writeValue(variable);
     }
     
@@ -260,10 +433,18 @@ namespace ccuty {
     // - - - Write - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     
     // writes a char
-    void writeValue(char c) {*out_ << '\"' << c << '\"'; needcomma_ = true;}
+    void writeValue(char c) {
+      if (format_ == Cbor) writeCborString(&c, 1);
+      else {put('"'); put(c); put('"');}
+      needcomma_ = true;
+    }
     
     // writes a bool.
-    void writeValue(bool b) {*out_ << (b ? "true" : "false"); needcomma_ = true;}
+    void writeValue(bool b) {
+      if (format_ == Cbor) put(char(b ? 0xf5 : 0xf4));
+      else if (b) put("true", 4); else put("false", 5);
+      needcomma_ = true;
+    }
     
     // writes a C++ string.
     void writeValue(const std::string& s) {writeString(s.c_str(), false);}
@@ -278,25 +459,25 @@ namespace ccuty {
     // writes a raw pointer (note: is_pointer differentiates from is_array).
     template <class T>
     void writeValue2(const typename std::enable_if<std::is_pointer<T>::value,T>::type & ptr) {
-      if (!ptr) *out_ << "null"; else writeValue(*ptr);
+      if (!ptr) writeNull(); else writeValue(*ptr);
     }
     
     // writes a smart pointer.
     template <class T>
     void writeValue2(const typename std::enable_if<is_smart_ptr<T>::value,T>::type & ptr) {
-      if (!ptr) *out_ << "null"; else writeValue(*ptr);
+      if (!ptr) writeNull(); else writeValue(*ptr);
     }
     
     // writes a number.
     template <class T>
     void writeValue2(const typename std::enable_if<std::is_arithmetic<T>::value,T>::type & number) {
-      *out_ << number;
+      if (format_ == Cbor) writeCborNumber(number); else writeNumber(number);
     }
     
     // writes an enum.
     template <class T>
     void writeValue2(const typename std::enable_if<std::is_enum<T>::value,T>::type & e) {
-      *out_ << int(e);
+      if (format_ == Cbor) writeCborNumber(int(e)); else writeNumber(int(e));
     }
     
     // writes a map.
@@ -316,75 +497,367 @@ namespace ccuty {
     // writes an array_style C++ container
     template <class T>
     void writeValue2(const typename std::enable_if<has_array_format<T>::value,T>::type & cont) {
-      if (cont.empty()) *out_ << "[]"; else writeArray(cont);
+      if (cont.empty()) writeEmptyArray(); else writeArray(cont);
     }
     
     // writes a C-array.
     template <class T>
     void writeValue2(const typename std::enable_if<std::is_array<T>::value,T>::type & carray) {
-      if (std::extent<T>::value == 0) *out_ << "[]"; else writeArray(carray);
+      if (std::extent<T>::value == 0) writeEmptyArray(); else writeArray(carray);
     }
     
     // writes a defobject.
     void writeObject(const MetaClass& cl, bool is_derived_class, const void* obj) {
       if (sharing_) {
         auto it = object_to_id_.find(obj);
-        if (it != object_to_id_.end()) {*out_ << "\"@"<< it->second <<'"'; return;}
+        if (it != object_to_id_.end()) {
+          if (format_ == Cbor) writeValue("@" + std::to_string(it->second));
+          else {put("\"@", 2); writeNumber(it->second); put('"');}
+          return;
+        }
         else object_to_id_[obj] = ++current_object_id_;
       }
+      int level = level_;
+      size_t begin = outpos();
       needcomma_ = false;
-      *out_ << "{\n";
-      addTab();
-      if (is_derived_class) {   // polymorphism
-        writeTabs(); *out_ << "\"@class\": \"" << cl.classname() << "\",\n";
+      if (format_ == Cbor) {
+        put(char(0xbf));  // map of indefinite length
+        if (is_derived_class) {writeKey("@class"); writeValue(cl.classname());}
+        if (sharing_) {writeKey("@id"); writeValue(std::to_string(current_object_id_));}
+        cl.writeMembers(*this, obj);
+        put(char(0xff));
       }
-      if (sharing_) {
-        writeTabs(); *out_ << "\"@id\": \"" << current_object_id_ << "\",\n";
+      else {
+        put("{\n", 2);
+        addTab();
+        if (is_derived_class) {   // polymorphism
+          writeTabs(); put("\"@class\": \"", 11); put(cl.classname()); put("\",\n", 3);
+        }
+        if (sharing_) {
+          writeTabs(); put("\"@id\": \"", 8); writeNumber(current_object_id_); put("\",\n", 3);
+        }
+        cl.writeMembers(*this, obj);
+        removeTab();
+        put('\n'); writeTabs(); put('}');
       }
-      cl.writeMembers(*this, obj);
-      removeTab();
-      *out_ << "\n"; writeTabs(); *out_ << "}";
       needcomma_ = true;
+      if (recorder_) recorder_(cl, obj, begin, outpos(), level);
       cl.doPostWrite(obj);  // end of the object
+      if (out_ && outbuf_.size() >= FlushSize) flushOutput();
     }
     
     // writes a C++ container or a C-array.
     template <class T> void writeArray(const T & array) {
       needcomma_ = false;
-      *out_ << "[\n";
+      if (format_ == Cbor) {
+        put(char(0x9f));  // array of indefinite length
+        for (auto& it : array) writeValue(it);
+        put(char(0xff));
+        return;
+      }
+      put("[\n", 2);
       addTab();
       for (auto& it : array) {
-        if (needcomma_) *out_ << ",\n";
+        if (needcomma_) put(",\n", 2);
         writeTabs();
         needcomma_ = false;
         writeValue(it);
       }
       removeTab();
-      *out_ << "\n"; writeTabs(); *out_ << "]";
+      put('\n'); writeTabs(); put(']');
     }
     
     // writes a string.
     void writeString(const char* s, bool is_cstring) {
-      if (!s) {*out_ << (is_cstring ? "null" : "\"\"");}
+      if (format_ == Cbor) {
+        if (!s && is_cstring) put(char(0xf6));
+        else writeCborString(s ? s : "", s ? ::strlen(s) : 0);
+      }
+      else if (!s) {if (is_cstring) put("null", 4); else put("\"\"", 2);}
       else {
-        out_->put('"');
+        put('"');
+        const char* run = s;   // characters that do not need to be escaped
         for (; *s != 0; ++s) {
+          char esc;
           switch (*s) {
-            case '"': out_->put('\\'); out_->put('"'); break;
-            case '\\': out_->put('\\'); out_->put('\\'); break;
-            case '\b': out_->put('\\'); out_->put('b'); break;
-            case '\f': out_->put('\\'); out_->put('f'); break;
-            case '\n': out_->put('\\'); out_->put('n'); break;
-            case '\r': out_->put('\\'); out_->put('r'); break;
-            case '\t': out_->put('\\'); out_->put('t'); break;
-            default: out_->put(*s);
+            case '"': esc = '"'; break;
+            case '\\': esc = '\\'; break;
+            case '\b': esc = 'b'; break;
+            case '\f': esc = 'f'; break;
+            case '\n': esc = 'n'; break;
+            case '\r': esc = 'r'; break;
+            case '\t': esc = 't'; break;
+            default: continue;
           }
+          put(run, s - run);
+          put('\\'); put(esc);
+          run = s + 1;
         }
-        out_->put('"');
+        put(run, s - run);
+        put('"');
       }
       needcomma_ = true;
     }
     
+    // writes a null pointer.
+    void writeNull() {if (format_ == Cbor) put(char(0xf6)); else put("null", 4);}
+    
+    // writes an empty container.
+    void writeEmptyArray() {if (format_ == Cbor) put(char(0x80)); else put("[]", 2);}
+    
+    // writes the separator between two members.
+    void writeSeparator() {
+      if (needcomma_ && format_ == Json) put(",\n", 2);
+      needcomma_ = false;
+    }
+    
+    // writes the name of a member.
+    void writeKey(const std::string& name) {
+      if (format_ == Cbor) writeCborString(name.data(), name.size());
+      else {writeTabs(); put('"'); put(name); put("\": ", 3);}
+    }
+    
+    // writes the key of a map (which is not necessarily a string).
+    template <class K> void writeMapKey(const K& key) {
+      numstream_.str("");
+      numstream_ << key;
+      writeKey(numstream_.str());
+    }
+    
+    // writes an integral number (one byte numbers are written as characters, as std::ostream does).
+    template <class T>
+    void writeNumber(typename std::enable_if<std::is_integral<T>::value,T>::type n) {
+      if (sizeof(T) == 1) {put(char(n)); return;}
+      char buf[24];
+      char* p = buf + sizeof(buf);
+      bool neg = std::is_signed<T>::value && n < T(0);
+      unsigned long long u = neg ? 0ULL - (unsigned long long)n : (unsigned long long)n;
+      do {*--p = char('0' + u % 10); u /= 10;} while (u != 0);
+      if (neg) *--p = '-';
+      put(p, buf + sizeof(buf) - p);
+    }
+    
+    // writes a floating point number as std::ostream would with the current precision.
+    template <class T>
+    void writeNumber(typename std::enable_if<std::is_floating_point<T>::value,T>::type n) {
+      char buf[64];
+      bool ldouble = sizeof(T) > sizeof(double);
+      const char* fmt = curfloatfield_ == std::ios::fixed ? (ldouble ? "%.*Lf" : "%.*f")
+      : curfloatfield_ == std::ios::scientific ? (ldouble ? "%.*Le" : "%.*e")
+      : (ldouble ? "%.*Lg" : "%.*g");
+      int len = ldouble ? snprintf(buf, sizeof(buf), fmt, curprecision_, (long double)n)
+      : snprintf(buf, sizeof(buf), fmt, curprecision_, double(n));
+      if (len < 0) return;
+      size_t pos = buf_->size();
+      if (size_t(len) < sizeof(buf)) put(buf, len);
+      else {   // huge fixed numbers
+        buf_->resize(pos + len + 1);
+        if (ldouble) snprintf(&(*buf_)[pos], len + 1, fmt, curprecision_, (long double)n);
+        else snprintf(&(*buf_)[pos], len + 1, fmt, curprecision_, double(n));
+        buf_->resize(pos + len);
+      }
+      // snprintf() uses the C locale (which may not use a dot)
+      char point = *::localeconv()->decimal_point;
+      if (point != '.') std::replace(buf_->begin() + pos, buf_->end(), point, '.');
+    }
+    
+    template <class T> void writeNumber(const T& n) {writeNumber<T>(n);}
+    
+    // the output is written in a buffer, which is then written on the stream (if any) at once.
+    void put(char c) {buf_->push_back(c);}
+    void put(const char* s, size_t n) {buf_->append(s, n);}
+    void put(const std::string& s) {buf_->append(s);}
+    
+    // position in the output.
+    size_t outpos() const {return outbase_ + buf_->size();}
+    
+    void flushOutput() {
+      if (!out_ || outbuf_.empty()) return;
+      out_->write(outbuf_.data(), outbuf_.size());
+      outbase_ += outbuf_.size();
+      outbuf_.clear();
+    }
+    
+    // - - - CBOR - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    
+    // writes the initial byte of a CBOR data item and its argument (big endian).
+    void writeCborHead(unsigned char major, unsigned long long arg) {
+      char buf[9];
+      size_t n = 1;
+      if (arg < 24) buf[0] = char(major << 5 | arg);
+      else {
+        int bytes = arg <= 0xff ? 1 : arg <= 0xffff ? 2 : arg <= 0xffffffffULL ? 4 : 8;
+        buf[0] = char(major << 5 | (bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27));
+        for (int k = bytes; k > 0; --k) buf[n++] = char(arg >> ((k-1) * 8));
+      }
+      put(buf, n);
+    }
+    
+    void writeCborString(const char* s, size_t len) {
+      writeCborHead(3, len);
+      put(s, len);
+    }
+    
+    // integral numbers (one byte numbers are written as characters, as in JSON).
+    template <class T>
+    void writeCborNumber(typename std::enable_if<std::is_integral<T>::value,T>::type n) {
+      if (sizeof(T) == 1) {char c = char(n); writeCborString(&c, 1);}
+      else if (n < 0) writeCborHead(1, (unsigned long long)(-(n + 1)));
+      else writeCborHead(0, (unsigned long long)n);
+    }
+    
+    template <class T>
+    void writeCborNumber(typename std::enable_if<std::is_floating_point<T>::value,T>::type n) {
+      if (sizeof(T) == sizeof(float)) {
+        float f = float(n);
+        uint32_t bits; ::memcpy(&bits, &f, 4);
+        put(char(0xfa));
+        for (int k = 3; k >= 0; --k) put(char(bits >> (k * 8)));
+      }
+      else {
+        double d = double(n);
+        uint64_t bits; ::memcpy(&bits, &d, 8);
+        put(char(0xfb));
+        for (int k = 7; k >= 0; --k) put(char(bits >> (k * 8)));
+      }
+    }
+    
+    template <class T> void writeCborNumber(const T& n) {writeCborNumber<T>(n);}
+    
+    // reads an argument of _size_ bytes (big endian).
+    unsigned long long readCborArg(int size) {
+      unsigned long long arg = 0;
+      for (int k = 0; k < size; ++k) {
+        int c = in_->get();
+        if (c == EOF) error(JsonError::PrematureEOF);
+        arg = (arg << 8) | (unsigned char)c;
+      }
+      return arg;
+    }
+    
+    // reads a CBOR data item that starts with byte _c_, converts it to a JSON-like event.
+    void readCborItem(int c, JsonEvent& event) {
+      unsigned char major = (unsigned char)c >> 5, info = c & 0x1f;
+      unsigned long long arg = info;
+      bool indefinite = (info == 31);
+      if (info >= 24 && info <= 27) arg = readCborArg(1 << (info - 24));
+      else if (info > 27 && !indefinite) error(JsonError::InvalidValue, "(CBOR data)");
+      event.type = JsonEvent::Value;
+      event.text.clear();
+      
+      switch (major) {
+        case 0:
+          event.text = std::to_string(arg);
+          break;
+        case 1:
+          event.text = "-" + std::to_string(arg + 1);   // note: overflows if arg is 2^64-1
+          break;
+        case 2: case 3:   // byte and text strings
+          if (!indefinite) readCborBytes(event.text, arg);
+          else while (true) {  // chunks of definite length
+            int k = in_->get();
+            if (k == 0xff) break;
+            if (k == EOF || (k >> 5) != major || (k & 0x1f) == 31) error(JsonError::PrematureEOF);
+            unsigned long long len = k & 0x1f;
+            if (len >= 24) len = readCborArg(1 << (len - 24));
+            readCborBytes(event.text, len);
+          }
+          break;
+        case 4: case 5:  // arrays and maps
+          event.type = major == 4 ? JsonEvent::StartArray : JsonEvent::StartObject;
+          event.text = major == 4 ? "[" : "{";
+          nesting_ += event.text[0];
+          cborcounts_.push_back(indefinite ? ~0ULL : arg);
+          break;
+        case 6:  // tags are ignored
+          c = in_->get();
+          if (c == EOF) error(JsonError::PrematureEOF);
+          readCborItem(c, event);
+          break;
+        default:  // simple values and floats
+          if (info == 20) event.text = "false";
+          else if (info == 21) event.text = "true";
+          else if (info == 22 || info == 23) event.text = "null";
+          else if (info == 25) event.text = cborNumber(halfToFloat(uint16_t(arg)), 9);
+          else if (info == 26) {
+            float f; uint32_t bits = uint32_t(arg); ::memcpy(&f, &bits, 4);
+            event.text = cborNumber(f, 9);
+          }
+          else if (info == 27) {
+            double d; uint64_t bits = arg; ::memcpy(&d, &bits, 8);
+            event.text = cborNumber(d, 17);
+          }
+          else error(JsonError::InvalidValue, "(CBOR simple value)");
+          break;
+      }
+    }
+    
+    // the length comes from the data: the string is read in chunks so that it only
+    // grows as long as there is something to read.
+    void readCborBytes(std::string& text, unsigned long long len) {
+      const unsigned long long chunk = 64 * 1024;
+      while (len > 0) {
+        size_t pos = text.size(), n = size_t(std::min(len, chunk));
+        if (n > text.max_size() - pos) error(JsonError::InvalidValue, "(CBOR string too long)");
+        text.resize(pos + n);
+        if (!in_->read(&text[pos], std::streamsize(n))) error(JsonError::PrematureEOF);
+        len -= n;
+      }
+    }
+    
+    std::string cborNumber(double d, int precision) {
+      numstream_.str("");
+      numstream_.precision(precision);
+      numstream_ << d;
+      return numstream_.str();
+    }
+    
+    static float halfToFloat(uint16_t h) {
+      int exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+      float f = exp == 0 ? std::ldexp(float(mant), -24)
+      : exp == 31 ? (mant == 0 ? INFINITY : NAN) : std::ldexp(float(mant + 1024), exp - 25);
+      return (h & 0x8000) ? -f : f;
+    }
+    
+    // same as nextEvent() for CBOR data.
+    void nextCborEvent(JsonEvent& event) {
+      bool inObj = !nesting_.empty() && nesting_.back() == '{';
+      if (!nesting_.empty() && cborcounts_.back() == 0) {  // end of container of definite length
+        nesting_.pop_back();
+        cborcounts_.pop_back();
+        event.type = inObj ? JsonEvent::EndObject : JsonEvent::EndArray;
+        event.text = inObj ? "}" : "]";
+        return;
+      }
+      int c = in_->get();
+      if (c == EOF) {
+        if (nesting_.empty()) {event.type = JsonEvent::End; return;}
+        else error(JsonError::PrematureEOF);
+      }
+      if (c == 0xff) {  // end of container of indefinite length
+        if (nesting_.empty() || cborcounts_.back() != ~0ULL)
+          error(inObj ? JsonError::ExpectingPairOrBrace : JsonError::ExpectingValueOrBracket);
+        nesting_.pop_back();
+        cborcounts_.pop_back();
+        event.type = inObj ? JsonEvent::EndObject : JsonEvent::EndArray;
+        event.text = inObj ? "}" : "]";
+        return;
+      }
+      if (!nesting_.empty() && cborcounts_.back() != ~0ULL) cborcounts_.back()--;
+      if (!inObj) {readCborItem(c, event); return;}
+      
+      readCborItem(c, event);
+      if (event.type != JsonEvent::Value) error(JsonError::ExpectingPairOrBrace);
+      event.type = JsonEvent::Key;
+      c = in_->get();
+      if (c == EOF) error(JsonError::PrematureEOF);
+      if (c == 0xff) error(JsonError::ExpectingPairOrBrace);
+      readCborItem(c, pending_);
+      haspending_ = true;
+    }
+    
+    // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    
     /// produces an error; throws except if _warning_ is true.
     void error(JsonError::Type type, const std::string& arg = "", bool fatal = true) {
       std::string where = (in_!=nullptr || type==JsonError::CantReadFile) ? "read" : "write";
@@ -404,7 +877,7 @@ namespace ccuty {
       token2.clear();
       token1_.clear();
       token2_.clear();
-      found1 = found2 = false;
+      found1 = found2 = opened_ = false;
       enum {
         Begin, InQuotedToken1, InUnquotedToken1, AfterToken1, AfterComa,
         InQuotedToken2, InUnquotedToken2, AfterToken2, Comment, LineComment
@@ -433,7 +906,7 @@ namespace ccuty {
         switch (part) {
           case Begin:
             if (c == '"') {found1 = true; part = InQuotedToken1;}
-            else if (c == '{' || c == '[') {found1 = true; token1 = c; return;}
+            else if (c == '{' || c == '[') {found1 = opened_ = true; token1 = c; return;}
             else if (!::isspace(c)) {found1 = true; token1_ += c; part = InUnquotedToken1;}
             break;
           case InQuotedToken1:
@@ -466,7 +939,7 @@ namespace ccuty {
                 else {in_->get(c); part = InQuotedToken2; in_multiquotes_ = true;}
               }
             }
-            else if (c == '{' || c == '[') {found2 = true; token2 = c; return;}
+            else if (c == '{' || c == '[') {found2 = opened_ = true; token2 = c; return;}
             else if (!::isspace(c)) {found2 = true; token2_ += c; part = InUnquotedToken2;}
             break;
           case InQuotedToken2:
@@ -512,6 +985,123 @@ namespace ccuty {
       error(JsonError::InvalidCharacter, msg + "(code: "+std::to_string(int(c))+")");
     }
     
+    /* reads the next event (see JsonEvent).
+     * A member produces two events: Key, then Value, StartObject or StartArray.
+     * A single value is read at the first level, End is returned when there is no data.
+     */
+    void nextEvent(JsonEvent& event) {
+      if (haspending_) {
+        haspending_ = false;
+        event.type = pending_.type;
+        event.text.swap(pending_.text);
+        return;
+      }
+      if (format_ == Cbor) {nextCborEvent(event); return;}
+      bool inObj = nesting_.empty() || nesting_.back() == '{';
+      bool found1, found2;
+      readLine(event.text, pending_.text, found1, found2, inObj);
+      
+      if (!found1) {
+        if (nesting_.empty()) {event.type = JsonEvent::End; return;}
+        else if (in_->eof()) error(JsonError::PrematureEOF);
+        else error(inObj ? JsonError::ExpectingPairOrBrace : JsonError::ExpectingValueOrBracket);
+      }
+      if (nesting_.empty()) setValueEvent(event);
+      else if (inObj) {
+        if (event.text == "}") {nesting_.pop_back(); event.type = JsonEvent::EndObject;}
+        else if (!found2) error(JsonError::ExpectingPairOrBrace);
+        else {
+          event.type = JsonEvent::Key;
+          setValueEvent(pending_);
+          haspending_ = true;
+        }
+      }
+      else if (event.text == "]") {nesting_.pop_back(); event.type = JsonEvent::EndArray;}
+      else setValueEvent(event);
+    }
+    
+    void setValueEvent(JsonEvent& event) {
+      if (!opened_) event.type = JsonEvent::Value;
+      else if (event.text == "{") {event.type = JsonEvent::StartObject; nesting_ += '{';}
+      else {event.type = JsonEvent::StartArray; nesting_ += '[';}
+    }
+    
+    // skips the content of an object or an array, or the value of a member.
+    void skipValue(const JsonEvent& event) {
+      JsonEvent e;
+      if (event.type == JsonEvent::Key) {
+        nextEvent(e);
+        skipValue(e);
+      }
+      else if (event.type == JsonEvent::StartObject || event.type == JsonEvent::StartArray) {
+        size_t level = nesting_.size() - 1;
+        while (nesting_.size() > level) nextEvent(e);
+      }
+    }
+    
+    // skips the content of the object or the array that was just opened without
+    // decoding it (strings, comments and separators are handled as by readLine()).
+    void skipRawValue() {
+      std::streambuf* sb = in_->rdbuf();
+      size_t level = 1;
+      int c;
+      while (level > 0) {
+        if ((c = sb->sbumpc()) == EOF) error(JsonError::PrematureEOF);
+        else if (c == '\n') lineno_++;
+        else if (c == '{' || c == '[') level++;
+        else if (c == '}' || c == ']') level--;
+        else if (c == '"') skipRawString(sb);
+        else if (c == '/') skipRawComment(sb);
+      }
+      nesting_.pop_back();
+      
+      // the separator that follows is consumed, as when the closing brace is a token
+      while ((c = sb->sgetc()) != EOF) {
+        if (c == '}' || c == ']') return;
+        sb->sbumpc();
+        if (c == ',') return;
+        else if (c == '\n') {lineno_++; if (allow_&NoCommas) return;}
+        else if (c == '/') skipRawComment(sb);
+        else if (!::isspace(c)) {error(JsonError::ExpectingComma); return;}
+      }
+    }
+    
+    void skipRawString(std::streambuf* sb) {
+      bool multi = false;
+      if (sb->sgetc() == '"') {
+        sb->sbumpc();
+        if (sb->sgetc() != '"') return;   // empty string
+        sb->sbumpc();
+        multi = true;
+      }
+      int c, quotes = 0;
+      while ((c = sb->sbumpc()) != EOF) {
+        if (c == '\n') lineno_++;
+        if (c == '"') {if (!multi || ++quotes == 3) return;}
+        else {
+          quotes = 0;
+          if (c == '\\') sb->sbumpc();
+        }
+      }
+      error(JsonError::PrematureEOF);
+    }
+    
+    void skipRawComment(std::streambuf* sb) {
+      if (!(allow_&Comments)) return;
+      int c = sb->sgetc(), prev = 0;
+      if (c == '/') {
+        while ((c = sb->sbumpc()) != EOF && c != '\n') {}
+        if (c == '\n') lineno_++;
+      }
+      else if (c == '*') {
+        sb->sbumpc();
+        while ((c = sb->sbumpc()) != EOF && !(prev == '*' && c == '/')) {
+          if (c == '\n') lineno_++;
+          prev = c;
+        }
+      }
+    }
+    
     void readEscape(std::string& token) {
       int c = in_->get();
       switch (c) {
@@ -566,7 +1156,18 @@ namespace ccuty {
       in_ = in;
       out_ = out;
       if (in_) in_->imbue(locale_);
-      if (out_) out_->imbue(locale_);
+      numstream_.imbue(locale_);
+      outbuf_.clear();
+      buf_ = &outbuf_;
+      outbase_ = 0;
+      curprecision_ = precision_;
+      curfloatfield_ = fixed_ ? std::ios::fixed : std::ios::fmtflags(0);
+      if (out_) {
+        out_->imbue(locale_);
+        if (recorder_) outbase_ = size_t(out_->tellp());  // positions are relative to the stream
+        curprecision_ = int(out_->precision());
+        curfloatfield_ = out_->flags() & std::ios::floatfield;
+      }
       streamname_ = streamname;
       lineno_ = lineno;
       needcomma_ = false;
@@ -574,33 +1175,49 @@ namespace ccuty {
       token1_.reserve(50);
       token2_.reserve(50);
       in_multiquotes_ = false;
-      tabs_.assign(40, tabchar_);
+      nesting_.clear();
+      cborcounts_.clear();
+      haspending_ = false;
       object_to_id_.clear();
       id_to_object_.clear();
       current_object_id_ = 0;
       delete jsonerror_; jsonerror_ = nullptr;
     }
     
-    void addTab() {if (++level_*indent_ >= tabs_.size()) tabs_.resize(tabs_.size() + 20, tabchar_);}
+    void addTab() {++level_;}
     void removeTab() {if (--level_ < 0) level_ = 0;}
-    void writeTabs() {out_->write(tabs_.data(), level_*indent_);}
+    void writeTabs() {buf_->append(level_*indent_, tabchar_);}
     
     JsonClasses& classes_;
     std::locale locale_{std::locale::classic()};
     std::istream *in_{nullptr};
     std::ostream *out_{nullptr};
+    std::string outbuf_, *buf_{&outbuf_};  // buf_ is outbuf_ or the buffer given to writeBuffer()
+    size_t outbase_{0};   // position of outbuf_ in out_
+    static const size_t FlushSize = 1 << 20;
+    int precision_{6}, curprecision_{6};
+    bool fixed_{false};
+    std::ios::fmtflags curfloatfield_{};
     unsigned char allow_{Comments};
     bool needcomma_{false}, in_multiquotes_{false}, sharing_{false};
+    bool opened_{false}, haspending_{false};
+    std::string nesting_;   // stack of { and [
+    std::vector<unsigned long long> cborcounts_;  // items left in CBOR containers (~0 if indefinite)
+    std::ostringstream numstream_;
+    Format format_{Json};
+    JsonEvent pending_;
     size_t lineno_{0};
     unsigned int indent_{2};
     int level_{0};
     char tabchar_{' '};
-    std::string streamname_, tabs_, token1_, token2_;
+    std::string streamname_, token1_, token2_;
     unsigned long current_object_id_{0};
     std::unordered_map<const void*, unsigned long> object_to_id_;
     std::unordered_map<unsigned long, ObjectPtr> id_to_object_;
     JsonError::Handler errhandler_{nullptr};
     JsonError* jsonerror_{nullptr};
+    Recorder recorder_{nullptr};
+    JsonArena* arena_{nullptr};
   };
 }
 
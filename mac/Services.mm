@@ -42,6 +42,7 @@ struct ServicesImpl {
   std::function<void()> wakeCallback;
   std::function<void()> sleepCallback;
   std::function<void(uint32_t hotkey)> hotkeyCallback;
+  std::function<void(const std::string&, const std::string&)> frontAppCallback;
   NSDictionary<NSString*,NSMutableArray*> *storedData{nil};
 };
 
@@ -159,6 +160,33 @@ bool Services::getBrowserTitle(std::string& url, const std::string& browser) {
   }
 }
 
+bool Services::getBrowserPage(std::string& url, std::string& title, const std::string& browser) {
+  const string& app = !browser.empty() ? browser : getDefaultWebBrowser();
+  string page;
+  bool ok = false;
+  url.clear();
+  title.clear();
+  
+  if (app == "Safari") {
+    ok = desk.system
+    ("osascript -e 'tell application \"Safari\" to return (URL of front document) & linefeed & (name of front document)'",
+     page) >= 0;
+  }
+  else if (app == "Google Chrome") {
+    ok = desk.system
+    ("osascript -e 'tell application \"Google Chrome\" to return (URL of active tab of front window) & linefeed & (title of active tab of front window)'",
+     page) >= 0;
+  }
+  else {
+    MarkPad::warning("getBrowserPage: " + app + " is not supported");
+    return false;
+  }
+  auto pos = page.find('\n');
+  url = page.substr(0, pos);
+  if (pos != string::npos) title = page.substr(pos+1);
+  return ok;
+}
+
 bool Services::getFinderFile(std::string& path) {
   return desk.system
   ("osascript -e 'tell application \"Finder\" to return POSIX path of (selection as alias)'",
@@ -183,6 +211,17 @@ bool Services::getFrontAppName(std::string& str) {
   return desk.getFrontAppName(str);
 }
 
+static void getAppNameAndPath(NSRunningApplication* a, std::string& name, std::string& path) {
+  NSURL* url = a ? [a executableURL] : nil;
+  name = url ? [[url lastPathComponent] UTF8String] : "";
+  path = url ? [url fileSystemRepresentation] : "";
+}
+
+bool Services::getFrontApp(std::string& name, std::string& path) {
+  getAppNameAndPath([[NSWorkspace sharedWorkspace] frontmostApplication], name, path);
+  return !name.empty();
+}
+
 void Services::openFile(const std::string& path) {
   desk.openFile(path);
 }
@@ -234,6 +273,10 @@ void Services::setHotkeyCallback(std::function<void(uint32_t hotkey)> fun) {
   impl.hotkeyCallback = fun;
 }
 
+void Services::setFrontAppCallback(std::function<void(const std::string&, const std::string&)> fun) {
+  impl.frontAppCallback = fun;
+}
+
 @implementation Notifier
 
 - (id)init {
@@ -261,13 +304,11 @@ void Services::setHotkeyCallback(std::function<void(uint32_t hotkey)> fun) {
     // detect when keys are pressed (local app events)
     [NSEvent addLocalMonitorForEventsMatchingMask: NSEventMaskFlagsChanged
                                           handler: ^(NSEvent* e){[self modifierChanged:e]; return e;}];
-    /*
-     // notification when an app is activated (and thus becomes the frontmost app)
-     [nc addObserver:self
-     selector:@selector(activateNotify:)
-     name:NSWorkspaceDidActivateApplicationNotification
-     object:nil];
-     */
+    // notification when an app is activated (and thus becomes the frontmost app)
+    [nc addObserver: self
+           selector: @selector(activateNotify:)
+               name: NSWorkspaceDidActivateApplicationNotification
+             object: nil];
     //keyMonitor1 = nil;
     //keyMonitor2 = nil;
   }
@@ -285,6 +326,14 @@ void Services::setHotkeyCallback(std::function<void(uint32_t hotkey)> fun) {
   }
 }
 
+// when an app is activated.
+- (void)activateNotify: (NSNotification*)note {
+  if (!impl.frontAppCallback) return;
+  std::string name, path;
+  getAppNameAndPath(note.userInfo[NSWorkspaceApplicationKey], name, path);
+  (impl.frontAppCallback)(name, path);
+}
+
 // when the computer is awakened.
 - (void)wakeNotify: (NSNotification*)note {
   if (impl.wakeCallback) (impl.wakeCallback)();
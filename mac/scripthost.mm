@@ -0,0 +1,118 @@
+//
+//  scripthost.mm (Mac version): host for ccuty::ScriptHost that runs AppleScripts
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Keeps the scripts compiled (NSAppleScript), so that running them again does not
+// start osascript nor compile them again. See ccuty/ccscripthost.hpp for the protocol.
+// The arguments are passed to the run handler of the script (on run argv).
+//
+// Built by the scripthost target of MarkPad.xcodeproj, which MarkPad depends on, and
+// copied to the Resources of MarkPad.app (MarkPad uses osascript if it is not there).
+// To build it by hand from the MarkPad directory:
+//   clang++ -std=c++14 -fobjc-arc -O2 -o scripthost mac/scripthost.mm
+//     -framework Foundation -framework Carbon
+
+#ifdef __APPLE__
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <Foundation/Foundation.h>
+#include <Carbon/Carbon.h>
+using namespace std;
+
+static void reply(int status, const string& output) {
+  size_t n = output.empty() ? 0 : std::count(output.begin(), output.end(), '\n') + 1;
+  cout << status << ' ' << n << '\n';
+  if (n > 0) cout << output << '\n';
+  cout.flush();
+}
+
+static string errorMessage(NSDictionary* error) {
+  NSString* msg = error[NSAppleScriptErrorMessage];
+  return msg ? string(msg.UTF8String) : string("AppleScript error");
+}
+
+static NSString* toNSString(const string& s) {
+  NSString* ns = [NSString stringWithUTF8String:s.c_str()];
+  return ns ? ns : @"";
+}
+
+int main() {
+  @autoreleasepool {
+    NSMutableDictionary<NSString*, NSAppleScript*>* scripts = [NSMutableDictionary new];
+    string line;
+
+    while (getline(cin, line)) {
+      @autoreleasepool {
+        istringstream header(line);
+        string kind, hash;
+        size_t count = 0;
+        header >> kind >> hash >> count;
+        vector<string> lines(count);
+        for (auto& l : lines) if (!getline(cin, l)) return 0;
+        NSString* key = toNSString(hash);
+        NSDictionary* error = nil;
+
+        if (kind == "S" || kind == "F") {
+          NSAppleScript* script = nil;
+          if (kind == "S") {
+            string source;
+            for (auto& l : lines) source += l + '\n';
+            script = [[NSAppleScript alloc] initWithSource:toNSString(source)];
+          }
+          else if (count == 1) {
+            NSURL* url = [NSURL fileURLWithPath:toNSString(lines[0])];
+            script = [[NSAppleScript alloc] initWithContentsOfURL:url error:&error];
+          }
+          if (!script) reply(1, error ? errorMessage(error) : "Invalid script");
+          else if (!script.isCompiled && ![script compileAndReturnError:&error])
+            reply(1, errorMessage(error));
+          else {
+            scripts[key] = script;
+            reply(0, "");
+          }
+        }
+
+        else if (kind == "R") {
+          NSAppleScript* script = scripts[key];
+          NSAppleEventDescriptor* result = nil;
+          if (!script) {
+            reply(1, "Undefined script");
+            continue;
+          }
+          if (lines.empty()) result = [script executeAndReturnError:&error];
+          else {
+            // run event with the list of arguments
+            NSAppleEventDescriptor* args = [NSAppleEventDescriptor listDescriptor];
+            for (size_t k = 0; k < lines.size(); ++k) {
+              [args insertDescriptor:[NSAppleEventDescriptor descriptorWithString:toNSString(lines[k])]
+                             atIndex:NSInteger(k + 1)];
+            }
+            NSAppleEventDescriptor* event =
+            [NSAppleEventDescriptor appleEventWithEventClass:kCoreEventClass
+                                                     eventID:kAEOpenApplication
+                                            targetDescriptor:[NSAppleEventDescriptor currentProcessDescriptor]
+                                                    returnID:kAutoGenerateReturnID
+                                               transactionID:kAnyTransactionID];
+            [event setParamDescriptor:args forKeyword:keyDirectObject];
+            result = [script executeAppleEvent:event error:&error];
+          }
+          if (!result) reply(1, errorMessage(error));
+          else reply(0, result.stringValue ? string(result.stringValue.UTF8String) : string());
+        }
+
+        else reply(1, "Invalid request");
+      }
+    }
+  }
+  return 0;
+}
+
+#endif
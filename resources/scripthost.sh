@@ -0,0 +1,76 @@
+#!/bin/sh
+#
+#  scripthost.sh: host for ccuty::ScriptHost that runs shell scripts
+#  MarkPad Project
+#
+# Each script is defined as a shell function, so that it is parsed once, and is
+# run in a subshell (no new interpreter is started). See ccuty/ccscripthost.hpp
+# for the protocol. Only uses builtins, except to check the syntax of new scripts.
+
+NL='
+'
+
+# reply status output: sends the status and the number of lines of the output
+reply() {
+  if [ -z "$2" ]; then
+    echo "$1 0"
+    return
+  fi
+  n=1
+  rest=$2
+  while :; do
+    case $rest in
+      *"$NL"*) rest=${rest#*"$NL"}; n=$((n+1)) ;;
+      *) break ;;
+    esac
+  done
+  printf '%s %d\n%s\n' "$1" "$n" "$2"
+}
+
+while IFS=' ' read -r kind hash count; do
+  case $hash in
+    ''|*[!0-9a-f]*) reply 1 "Invalid request"; continue ;;
+  esac
+  case $count in
+    ''|*[!0-9]*) reply 1 "Invalid request"; continue ;;
+  esac
+
+  # the lines of the request
+  lines=
+  set --
+  i=0
+  while [ $i -lt "$count" ] && IFS= read -r line; do
+    lines=$lines$line$NL
+    set -- "$@" "$line"
+    i=$((i+1))
+  done
+
+  case $kind in
+    S)
+      body=":$NL$lines"
+      if (eval "s_$hash() {$NL$body}") 2>/dev/null; then
+        eval "s_$hash() {$NL$body}"
+        eval "def_$hash=1"
+        reply 0 ""
+      else
+        reply 1 "Syntax error"
+      fi ;;
+
+    F)
+      eval "file_$hash=\$1"
+      eval "s_$hash() { . \"\$file_$hash\"; }"
+      eval "def_$hash=1"
+      reply 0 "" ;;
+
+    R)
+      if eval "[ -n \"\${def_$hash}\" ]"; then
+        output=$("s_$hash" "$@" 2>&1)
+        reply $? "$output"
+      else
+        reply 1 "Undefined script"
+      fi ;;
+
+    *)
+      reply 1 "Invalid request" ;;
+  esac
+done
@@ -0,0 +1,238 @@
+//
+//  confbench.cpp: benchmark for reading and writing configuration files
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Reads and writes the shipped configuration and synthetic configurations
+// (10 to 100000 shortcuts, submenu depth 1 to 6, long actions with escaped
+// characters, @id members and comments) with the classes declared by Conf.cpp.
+// Prints read/write throughput, allocations per object and peak memory.
+// Read times include destroying the menus, either one by one (read) or by
+// releasing the arena they were allocated in (arena).
+//
+// Build from the MarkPad directory (no GUI or touchpad needed, see headless.cpp):
+//   c++ -std=c++14 -O2 -I. -Icore -Igui -Iccuty -o confbench tools/confbench.cpp
+//     tools/headless.cpp core/Conf.cpp core/Shortcut.cpp core/Journal.cpp
+//     core/Actions.cpp core/CurrentAction.cpp core/MarkPad.cpp core/Pad.cpp
+//     core/Strings.cpp core/DataLogger.cpp core/Trajectory.cpp core/GestureStore.cpp
+//     core/DesktopState.cpp
+//     ccuty/ccsocket.cpp ccuty/ccwatcher.cpp ccuty/ccarchive.cpp ccuty/ccexecutor.cpp
+//     ccuty/cclauncher.cpp ccuty/ccscripthost.cpp ccuty/cclineconnection.cpp -lpthread -lz
+//
+// Usage: confbench [-quick] [config files...]
+// (the shipped configuration is resources/Shortcuts.json if no file is given).
+
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <new>
+#include <sys/resource.h>
+#include "Conf.h"
+#include "Shortcut.h"
+using namespace std;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+  allocations++;
+  if (void* p = malloc(size ? size : 1)) return p;
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {free(p);}
+void operator delete(void* p, size_t) noexcept {free(p);}
+
+static double peakRSS() {   // in MB
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024. * 1024.);  // bytes
+#else
+  return usage.ru_maxrss / 1024.;            // kilobytes
+#endif
+}
+
+static double now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+/// generates a configuration with _count_ shortcuts and submenus of depth _depth_.
+class Generator {
+public:
+  Generator(size_t count, int depth) : remaining_(count), depth_(depth) {
+    // enough shortcuts per menu to reach the requested depth
+    fanout_ = 2;
+    size_t total = 2;
+    while (total < count && depth > 1) {
+      total = 1;
+      for (int k = 0; k < depth; ++k) total *= fanout_;
+      if (total < count) fanout_++;
+    }
+    if (depth <= 1) fanout_ = count;
+  }
+
+  string generate() {
+    out_ << "// MarkPad Configuration File\n// Generated by confbench\n\n"
+    << "{\n  \"fileVersion\": \"5.0\",\n  \"theme\": \"dark\",\n"
+    << "  /* settings that are not given have their default value */\n"
+    << "  \"mainMenu\": {\n    \"shortcuts\": [\n";
+    menu(1, "      ");
+    out_ << "    ]\n  }\n}\n";
+    return out_.str();
+  }
+
+private:
+  void menu(int level, const string& tabs) {
+    objects_++;
+    for (size_t k = 0; k < fanout_ && remaining_ > 0; ++k) {
+      remaining_--;
+      shortcut(level, tabs);
+      out_ << (k+1 < fanout_ && remaining_ > 0 ? ",\n" : "\n");
+    }
+  }
+
+  void shortcut(int level, const string& tabs) {
+    size_t n = ++objects_;
+    out_ << tabs << "{\n";
+    if (n % 7 == 0) out_ << tabs << "  \"@id\": " << n << ",\n";
+    if (n % 5 == 0) out_ << tabs << "  // shortcut " << n << "\n";
+    out_ << tabs << "  \"name\": \"Shortcut " << n << (n % 3 ? "" : " \\\"quoted\\\"") << "\",\n";
+    if (n % 4 == 0) out_ << tabs << "  \"modes\": \"DontOpenMenu\",\n";
+    if (n % 10 == 0) {
+      // long string with escaped characters
+      out_ << tabs << "  \"action\": \"!write ";
+      for (size_t k = 0; k < 8 + n % 24; ++k)
+        out_ << "tell application \\\"Finder\\\" to open POSIX file \\\"/Users/me/Doc\\\\" << k << "\\\"\\n\\t";
+      out_ << "\",\n";
+    }
+    else out_ << tabs << "  \"action\": \"!openhideapp /Applications/App" << n % 50 << ".app\",\n";
+    if (n % 6 == 0) out_ << tabs << "  \"feedback\": \"Opened " << n << "\",\n";
+    out_ << tabs << "  \"area\": \"0." << (1000 + n % 9000) << " 0.2500 0.1500 0.2000\",\n"
+    << tabs << "  \"nameArea\": \"0.0100 0.0200\"";
+    if (level < depth_ && remaining_ > 0) {
+      out_ << ",\n" << tabs << "  \"submenu\": {\n" << tabs << "    \"shortcuts\": [\n";
+      menu(level+1, tabs + "      ");
+      out_ << tabs << "    ]\n" << tabs << "  }";
+    }
+    out_ << "\n" << tabs << "}";
+  }
+
+  ostringstream out_;
+  size_t remaining_, fanout_{2}, objects_{0};
+  int depth_;
+};
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static size_t countObjects(const ShortcutMenu* menu) {
+  if (!menu) return 0;
+  size_t count = 1;
+  for (auto s : menu->shortcuts()) count += 1 + countObjects(s->menu());
+  return count;
+}
+
+/// reads and writes _json_ several times, prints the results.
+static bool bench(const string& title, const string& json, bool quick) {
+  size_t reps = max<size_t>(1, (quick ? 2000000 : 20000000) / max<size_t>(1, json.size()));
+  double mb = json.size() / (1024. * 1024.);
+  string errors;
+  size_t objects = 0, allocs = 0;
+  double readTime = 0, arenaTime = 0, writeTime = 0;
+  string written;
+
+  for (size_t r = 0; r < reps; ++r) {
+    CConf conf;
+    istringstream in(json);
+    size_t a = allocations;
+    double t = now();
+    if (!Conf::readConf(conf, in, title, errors)) {
+      cerr << title << ": " << errors << endl;
+      return false;
+    }
+    readTime += now() - t;
+    allocs = allocations - a;
+    objects = countObjects(conf.mainMenu_);
+
+    ostringstream out;
+    t = now();
+    Conf::writeConf(conf, out, errors);
+    writeTime += now() - t;
+    if (r == 0) written = out.str();
+    t = now();
+    delete conf.mainMenu_;
+    readTime += now() - t;
+  }
+
+  for (size_t r = 0; r < reps; ++r) {
+    CConf conf;
+    istringstream in(json);
+    double t = now();
+    MenuArena* arena = new MenuArena;
+    Conf::readConf(conf, in, title, errors, arena);
+    arena->close();
+    delete conf.mainMenu_;   // calls destructors, memory is freed with the last object
+    arenaTime += now() - t;
+  }
+
+  // what is written must be read back identically
+  CConf conf;
+  istringstream in(written);
+  ostringstream out;
+  bool same = Conf::readConf(conf, in, title, errors) && Conf::writeConf(conf, out, errors)
+  && out.str() == written;
+  delete conf.mainMenu_;
+
+  printf("%-22s %9.1f %7zu %10.1f %10.1f %10.1f %9.1f %9.1f%s\n",
+         title.c_str(), json.size() / 1024., objects,
+         mb * reps / readTime, mb * reps / arenaTime, written.size() / (1024.*1024.) * reps / writeTime,
+         objects ? double(allocs) / objects : 0., peakRSS(),
+         same ? "" : "  (not stable)");
+  return same;
+}
+
+int main(int argc, char* argv[]) {
+  bool quick = false;
+  vector<string> files;
+  for (int k = 1; k < argc; ++k) {
+    if (string(argv[k]) == "-quick") quick = true;
+    else files.push_back(argv[k]);
+  }
+  if (files.empty()) files.push_back("resources/Shortcuts.json");
+
+  printf("%-22s %9s %7s %10s %10s %10s %9s %9s\n", "configuration", "size(KB)", "objects",
+         "read MB/s", "arena MB/s", "write MB/s", "alloc/obj", "peak MB");
+  bool ok = true;
+
+  for (auto& f : files) {
+    ifstream in(f, ios::binary);
+    if (!in) {cerr << "Can't read: " << f << endl; ok = false; continue;}
+    stringstream content;
+    content << in.rdbuf();
+    auto pos = f.find_last_of('/');
+    ok &= bench(pos == string::npos ? f : f.substr(pos+1), content.str(), quick);
+  }
+
+  for (size_t count : {10, 100, 1000, 10000, 100000}) {
+    for (int depth : {1, 3, 6}) {
+      if (quick && count > 10000) continue;
+      Generator gen(count, depth);
+      string json = gen.generate();
+      ok &= bench(to_string(count) + " depth " + to_string(depth), json, quick);
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+//
+//  gesturequery.cpp: queries on the gestures stored by DataLogger
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Reads the gestures.store files of one or several users (see GestureStore.h),
+// and their tail file if any.
+// Blocks are read in parallel by all cores, blocks that are out of the requested
+// dates are skipped using their statistics. Prints CSV:
+// - counts:  number of uses of each shortcut
+// - latency: duration of the gestures (from touch to release) for each shortcut, in seconds
+// - errors:  for each day, number of gestures, of cancelled gestures (released without
+//            selecting a shortcut) and of gestures for which the menu was shown
+//
+// Build from the MarkPad directory:
+//   c++ -std=c++14 -O2 -Icore -o gesturequery tools/gesturequery.cpp core/GestureStore.cpp -lpthread
+//
+// Usage: gesturequery [-from YYYY-MM-DD] [-to YYYY-MM-DD] [-threads N]
+//                     counts|latency|errors files...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "GestureStore.h"
+using namespace std;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+/// durations of the gestures of a shortcut.
+struct Latency {
+  static const int Buckets = 1000;       // 10ms each, the last one for longer gestures
+  uint64_t count{};
+  double sum{}, min{numeric_limits<double>::max()}, max{};
+  vector<uint32_t> histogram = vector<uint32_t>(Buckets);
+
+  void add(float d) {
+    count++;
+    sum += d;
+    if (d < min) min = d;
+    if (d > max) max = d;
+    histogram[size_t(std::min(std::max(d * 100.f, 0.f), float(Buckets-1)))]++;
+  }
+
+  void merge(const Latency& l) {
+    count += l.count;
+    sum += l.sum;
+    min = std::min(min, l.min);
+    max = std::max(max, l.max);
+    for (int k = 0; k < Buckets; ++k) histogram[k] += l.histogram[k];
+  }
+
+  double percentile(double p) const {   // upper bound of the bucket
+    uint64_t n = 0, rank = uint64_t(p * count);
+    for (int k = 0; k < Buckets; ++k) if ((n += histogram[k]) > rank) return (k+1) / 100.;
+    return max;
+  }
+};
+
+struct DayErrors {
+  uint64_t gestures{}, cancelled{}, menushown{};
+  void merge(const DayErrors& d) {
+    gestures += d.gestures;
+    cancelled += d.cancelled;
+    menushown += d.menushown;
+  }
+};
+
+/// results of a thread (merged at the end).
+struct Results {
+  unordered_map<string, uint64_t> counts;
+  unordered_map<string, Latency> latency;
+  map<string, DayErrors> errors;
+};
+
+/// local day of a time in milliseconds (localtime_r() is only called when the day changes).
+class Days {
+public:
+  const string& day(int64_t time) {
+    if (time < begin_ || time >= end_) {
+      time_t t = time_t(time / 1000);
+      struct tm tm;
+      ::localtime_r(&t, &tm);
+      char buf[32];
+      strftime(buf, sizeof(buf), "%Y-%m-%d", &tm);
+      day_ = buf;
+      tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+      tm.tm_isdst = -1;
+      begin_ = int64_t(mktime(&tm)) * 1000;
+      tm.tm_mday++;
+      tm.tm_isdst = -1;
+      end_ = int64_t(mktime(&tm)) * 1000;
+    }
+    return day_;
+  }
+
+private:
+  int64_t begin_{1}, end_{0};
+  string day_;
+};
+
+enum Query {Counts, Latencies, Errors};
+
+struct Task {
+  int fd;
+  uint64_t offset;
+  GestureStore::BlockHeader header;
+};
+
+static void run(Query query, const vector<Task>& tasks, atomic<size_t>& next,
+                int64_t from, int64_t to, Results& r, atomic<bool>& failed) {
+  GestureStore::Block b;
+  Days days;
+  size_t k;
+  while ((k = next++) < tasks.size()) {
+    auto& t = tasks[k];
+    bool whole = t.header.mintime >= from && t.header.maxtime < to;
+
+    // the statistics of the block are enough if it is within a single day
+    if (query == Errors && whole) {
+      string day = days.day(t.header.mintime);
+      if (days.day(t.header.maxtime) == day) {
+        auto& e = r.errors[day];
+        e.gestures += t.header.rows;
+        e.cancelled += t.header.cancelled;
+        e.menushown += t.header.menushown;
+        continue;
+      }
+    }
+
+    if (!GestureStore::readBlock(t.fd, t.offset, b)) {failed = true; continue;}
+    for (size_t row = 0; row < b.time.size(); ++row) {
+      if (!whole && (b.time[row] < from || b.time[row] >= to)) continue;
+      bool cancelled = b.flags[row] & GestureStore::Cancelled;
+      switch (query) {
+        case Counts:
+          if (!cancelled) r.counts[b.names[b.end[row]]]++;
+          break;
+        case Latencies:
+          if (!cancelled) r.latency[b.names[b.end[row]]].add(b.duration[row]);
+          break;
+        case Errors: {
+          auto& e = r.errors[days.day(b.time[row])];
+          e.gestures++;
+          if (cancelled) e.cancelled++;
+          if (b.flags[row] & GestureStore::MenuShown) e.menushown++;
+        } break;
+      }
+    }
+  }
+}
+
+static int64_t parseDay(const char* s) {   // local midnight in milliseconds
+  struct tm tm{};
+  if (sscanf(s, "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) {
+    cerr << "Invalid date (YYYY-MM-DD expected): " << s << endl;
+    exit(2);
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  tm.tm_isdst = -1;
+  return int64_t(mktime(&tm)) * 1000;
+}
+
+static string csvName(const string& s) {
+  if (s.find_first_of(",\"\n") == string::npos) return s;
+  string q = "\"";
+  for (char c : s) q += (c == '"') ? string("\"\"") : string(1, c);
+  return q + '"';
+}
+
+int main(int argc, char* argv[]) {
+  int64_t from = numeric_limits<int64_t>::min(), to = numeric_limits<int64_t>::max();
+  unsigned int nthreads = max(1u, thread::hardware_concurrency());
+  int k = 1;
+  for (; k+1 < argc && argv[k][0] == '-'; k += 2) {
+    string opt = argv[k];
+    if (opt == "-from") from = parseDay(argv[k+1]);
+    else if (opt == "-to") to = parseDay(argv[k+1]) + 24*3600*1000LL;  // included
+    else if (opt == "-threads") nthreads = max(1, atoi(argv[k+1]));
+    else break;
+  }
+  if (k+1 >= argc) {
+    cerr << "Usage: gesturequery [-from YYYY-MM-DD] [-to YYYY-MM-DD] [-threads N] "
+    << "counts|latency|errors files..." << endl;
+    return 2;
+  }
+  string q = argv[k++];
+  Query query = q == "counts" ? Counts : q == "latency" ? Latencies : Errors;
+  if (q != "counts" && q != "latency" && q != "errors") {
+    cerr << "Unknown query: " << q << endl;
+    return 2;
+  }
+
+  // blocks to read (the headers are small and at known places)
+  vector<Task> tasks;
+  vector<int> fds;
+  bool ok = true;
+  for (; k < argc; ++k) {
+    vector<pair<GestureStore::BlockHeader,uint64_t>> headers;
+    int fd = ::open(argv[k], O_RDONLY);
+    if (fd < 0 || !GestureStore::readHeaders(argv[k], headers)) {
+      cerr << "Can't read: " << argv[k] << endl;
+      if (fd >= 0) ::close(fd);
+      ok = false;
+      continue;
+    }
+    fds.push_back(fd);
+    for (auto& h : headers) {
+      if (h.first.maxtime >= from && h.first.mintime < to) tasks.push_back({fd, h.second, h.first});
+    }
+    GestureStore::BlockHeader th;
+    int tfd = GestureStore::openTail(argv[k], th);
+    if (tfd >= 0) {
+      fds.push_back(tfd);
+      if (th.maxtime >= from && th.mintime < to) tasks.push_back({tfd, GestureStore::TailOffset, th});
+    }
+  }
+
+  nthreads = max(1u, min(nthreads, unsigned(tasks.size())));
+  vector<Results> results(nthreads);
+  vector<thread> threads;
+  atomic<size_t> next{0};
+  atomic<bool> failed{false};
+  for (unsigned int t = 0; t < nthreads; ++t) {
+    threads.emplace_back(run, query, cref(tasks), ref(next), from, to, ref(results[t]), ref(failed));
+  }
+  for (auto& t : threads) t.join();
+  for (int fd : fds) ::close(fd);
+  if (failed) {cerr << "Some blocks could not be read" << endl; ok = false;}
+
+  Results& all = results[0];
+  for (size_t t = 1; t < results.size(); ++t) {
+    for (auto& c : results[t].counts) all.counts[c.first] += c.second;
+    for (auto& l : results[t].latency) all.latency[l.first].merge(l.second);
+    for (auto& e : results[t].errors) all.errors[e.first].merge(e.second);
+  }
+
+  if (query == Counts) {
+    vector<pair<string,uint64_t>> counts(all.counts.begin(), all.counts.end());
+    sort(counts.begin(), counts.end(), [](const pair<string,uint64_t>& a, const pair<string,uint64_t>& b) {
+      return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    printf("shortcut,count\n");
+    for (auto& c : counts) printf("%s,%llu\n", csvName(c.first).c_str(), (unsigned long long)c.second);
+  }
+  else if (query == Latencies) {
+    map<string, Latency> latency(all.latency.begin(), all.latency.end());
+    printf("shortcut,count,mean,min,median,p90,max\n");
+    for (auto& l : latency) {
+      auto& v = l.second;
+      printf("%s,%llu,%.3f,%.3f,%.2f,%.2f,%.3f\n", csvName(l.first).c_str(),
+             (unsigned long long)v.count, v.sum / v.count, v.min,
+             v.percentile(0.5), v.percentile(0.9), v.max);
+    }
+  }
+  else {
+    printf("day,gestures,cancelled,error_rate,menu_shown\n");
+    for (auto& e : all.errors) {
+      auto& d = e.second;
+      printf("%s,%llu,%llu,%.4f,%llu\n", e.first.c_str(), (unsigned long long)d.gestures,
+             (unsigned long long)d.cancelled, d.gestures ? double(d.cancelled) / d.gestures : 0.,
+             (unsigned long long)d.menushown);
+    }
+  }
+  return ok ? 0 : 1;
+}
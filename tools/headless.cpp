@@ -0,0 +1,236 @@
+//
+//  headless.cpp: GUI and system services that do nothing
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Replaces gui/, cocoa/ and mac/ so that the functional core (core/ and ccuty/)
+// can run without a screen or a touchpad, e.g. in benchmarks (see confbench.cpp).
+// Postponed functions are called immediately. Alerts are printed on std::cerr.
+// Set MARKPAD_CONFDIR to choose the configuration directory (/tmp by default).
+// The state of the desktop is a mock that can be changed (see mockdesktop.h).
+
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include "GUI.h"
+#include "Services.h"
+#include "MarkPad.h"
+#include "mockdesktop.h"
+using namespace std;
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+class Settings {};
+class Editor {};
+static Settings settings;
+static Editor editor;
+
+GUI GUI::instance;
+MarkPad& GUI::mp = MarkPad::instance;
+
+GUI::GUI() : settings(::settings), edit(::editor) {}
+void GUI::init() {}
+
+int GUI::alert(const string& msg, const string& info, const string& buttons) {
+  cerr << "Alert: " << msg << "\n" << info << endl;
+  return 0;
+}
+
+int GUI::alert(const string& msg, const string& info, const string& buttons,
+               float xpos, float ypos) {
+  return alert(msg, info, buttons);
+}
+
+bool GUI::isMouseDown() {return false;}
+MTPoint GUI::currentMousePos() {return MTPoint{0, 0};}
+void GUI::initOverlayGeometry(Pad*) {}
+void GUI::showFeedback(const string&) {}
+void GUI::showOverlay(OverlayMode) {}
+void GUI::updateOverlay(bool) {}
+void GUI::openCloseMenu() {}
+void GUI::openManual() {}
+void GUI::openURL(const string&) {}
+void GUI::openFinder() {}
+void GUI::openWebBrowser() {}
+void GUI::showHelp() {}
+void GUI::showDesktop(bool) {}
+void GUI::closeSettings() {}
+void GUI::completeShortcutCreation(ShortcutMenu&, Shortcut&) {}
+void GUI::layoutShortcut(Shortcut&) {}
+void GUI::updateShortcut(Shortcut*) {}
+void GUI::updateShortcutSize(Shortcut*) {}
+void GUI::updateRunState(bool) {}
+void GUI::editCB(bool) {}
+void GUI::hideEditorCB(bool) {}
+void GUI::keyOnOverlayCB(uint32_t, uint16_t, uint32_t) {}
+void GUI::doubleClickOnOverlayCB(const Shortcut*, const MTPoint&, BoxPart::Value) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+int MTReader::start(MarkPad&) {return 0;}
+void MTReader::stop(MarkPad&) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void Services::init() {}
+void Services::log(const string& msg) {cerr << msg << endl;}
+
+string Services::getResourceDir() {return "resources/";}
+
+string Services::getUserConfDir() {
+  const char* dir = getenv("MARKPAD_CONFDIR");
+  return dir ? dir : "/tmp/";
+}
+
+void Services::postpone(function<void()> fun) {fun();}
+void Services::setWakeCallback(function<void()>) {}
+void Services::setSleepCallback(function<void()>) {}
+void Services::setHotkeyCallback(function<void(uint32_t)>) {}
+bool Services::askAccessibility() {return false;}
+bool Services::isAccessibilityEnabled() {return false;}
+void Services::autoHideMenubarAndDock() {}
+void Services::disableDeviceForCursor(MTDevice*) {}
+void Services::enableDeviceForCursor(MTDevice*) {}
+void Services::makeMarkPadFront() {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static struct {
+  std::mutex mutex;
+  string appName, appPath, finderFile, url, title;
+  int frontAppQueries{0}, finderQueries{0}, browserQueries{0};
+  function<void(const string&, const string&)> frontAppCallback;
+} mock;
+
+void MockDesktop::setFrontApp(const string& name, const string& path, bool notify) {
+  function<void(const string&, const string&)> callback;
+  {
+    lock_guard<mutex> lock(mock.mutex);
+    mock.appName = name;
+    mock.appPath = path;
+    if (notify) callback = mock.frontAppCallback;
+  }
+  if (callback) callback(name, path);
+}
+
+void MockDesktop::setFinderFile(const string& path) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.finderFile = path;
+}
+
+void MockDesktop::setBrowserPage(const string& url, const string& title) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.url = url;
+  mock.title = title;
+}
+
+int MockDesktop::frontAppQueries() {lock_guard<mutex> lock(mock.mutex); return mock.frontAppQueries;}
+int MockDesktop::finderQueries() {lock_guard<mutex> lock(mock.mutex); return mock.finderQueries;}
+int MockDesktop::browserQueries() {lock_guard<mutex> lock(mock.mutex); return mock.browserQueries;}
+
+void Services::setFrontAppCallback(function<void(const string&, const string&)> fun) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.frontAppCallback = fun;
+}
+
+bool Services::getFrontApp(string& name, string& path) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.frontAppQueries++;
+  name = mock.appName;
+  path = mock.appPath;
+  return !name.empty();
+}
+
+bool Services::getFrontAppPath(string& path) {
+  string name;
+  return getFrontApp(name, path);
+}
+
+bool Services::getFrontAppName(string& name) {
+  string path;
+  return getFrontApp(name, path);
+}
+
+bool Services::getFinderFile(string& path) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.finderQueries++;
+  path = mock.finderFile;
+  return !path.empty();
+}
+
+bool Services::getBrowserPage(string& url, string& title, const string&) {
+  lock_guard<mutex> lock(mock.mutex);
+  mock.browserQueries++;
+  url = mock.url;
+  title = mock.title;
+  return !url.empty();
+}
+
+bool Services::getBrowserUrl(string& url, const string& browser) {
+  string title;
+  return getBrowserPage(url, title, browser);
+}
+
+bool Services::getBrowserTitle(string& title, const string& browser) {
+  string url;
+  return getBrowserPage(url, title, browser) && !title.empty();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+const string& Services::getDefaultWebBrowser() {
+  static string browser;
+  return browser;
+}
+
+void Services::openDefaultWebBrowser() {}
+bool Services::setBrowserUrl(const string&, const string&) {return false;}
+
+void Services::openFile(const string&) {}
+void Services::openUrl(const string&) {}
+void Services::openApp(const string&) {}
+void Services::openApp(const string&, const string&) {}
+void Services::hideApp(const string&) {}
+void Services::tellApp(const string&, const string&) {}
+void Services::changeVolume(int) {}
+void Services::setVolume(unsigned int) {}
+void Services::muteVolume() {}
+
+void Services::copyWithoutStyle() {}
+void Services::pasteWithoutStyle() {}
+void Services::copyToBuffer(const string&) {}
+void Services::pasteFromBuffer(const string&) {}
+void Services::pasteString(const string&) {}
+
+uint32_t Services::stringToModifiers(const string& hotkey, uint8_t& modifiers, string& chars) {
+  modifiers = 0;
+  chars = hotkey;
+  return 0;
+}
+
+uint32_t Services::modifiersToString(uint8_t, string& hotkey) {
+  hotkey.clear();
+  return 0;
+}
+
+void Services::modStringToModifiers(const string& modchars, uint8_t& modifiers, string& chars) {
+  modifiers = 0;
+  chars = modchars;
+}
+
+void Services::modifiersToModString(uint8_t, string& hotkey) {hotkey.clear();}
+
+void Services::appleModStringToModifiers(const string& modchars, uint8_t& modifiers, string& chars) {
+  modifiers = 0;
+  chars = modchars;
+}
+
+void Services::sendChar(char, uint8_t) {}
+void Services::sendChars(const string&, uint8_t) {}
+void Services::sendModChars(const string&) {}
+void Services::sendKeycode(uint32_t, uint8_t) {}
+uint32_t Services::charToKeycode(char) {return 0;}
+void Services::printKeyCodes() {}
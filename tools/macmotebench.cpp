@@ -0,0 +1,150 @@
+//
+//  macmotebench.cpp: measures how the commands reach the media server
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Sends bursts of commands with CurrentAction::macmote() (as when the volume wheel
+// is turned) to a local MockMacMote, without and with faults, and prints how many
+// commands were received, whether they were in order, the throughput, and the
+// latency between macmote() and the server. The size of the queue of the connection
+// is MediaQueueSize in CurrentAction.cpp, see ccuty::LineConnection for the retries.
+//
+// Build from the MarkPad directory (no GUI or touchpad needed, see headless.cpp):
+//   c++ -std=c++14 -O2 -I. -Icore -Igui -Iccuty -o macmotebench tools/macmotebench.cpp
+//     tools/mockmacmote.cpp tools/headless.cpp core/Conf.cpp core/Shortcut.cpp
+//     core/Journal.cpp core/Actions.cpp core/CurrentAction.cpp core/MarkPad.cpp
+//     core/Pad.cpp core/Strings.cpp core/DataLogger.cpp core/Trajectory.cpp
+//     core/GestureStore.cpp core/DesktopState.cpp
+//     ccuty/ccsocket.cpp ccuty/ccwatcher.cpp ccuty/ccarchive.cpp ccuty/ccexecutor.cpp
+//     ccuty/cclauncher.cpp ccuty/ccscripthost.cpp ccuty/cclineconnection.cpp -lpthread -lz
+//
+// Usage: macmotebench [-bursts count] [-burst commands] [-pause ms]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Conf.h"
+#include "CurrentAction.h"
+#include "mockmacmote.h"
+using namespace std;
+using Clock = MockMacMote::Clock;
+
+static const int IdleTimeout = 1000;   // ms without commands after which a run ends
+
+struct Scenario {
+  const char* name;
+  MockMacMote::Faults faults;
+};
+
+struct Result {
+  const char* name;
+  int sent{0}, received{0}, connections{0};
+  bool inOrder{true};
+  double rate{0}, p50{0}, p99{0}, max{0};
+};
+
+static double ms(Clock::duration d) {
+  return chrono::duration<double, milli>(d).count();
+}
+
+static Result run(CurrentAction& current, MockMacMote& server, int scenario,
+                  const Scenario& s, int bursts, int burst, int pause) {
+  Result r;
+  r.name = s.name;
+  server.setFaults(s.faults);
+  server.clear();
+  int connections = server.connections();
+  vector<Clock::time_point> sent(size_t(bursts * burst));
+
+  for (int b = 0, id = 0; b < bursts; ++b) {
+    for (int k = 0; k < burst; ++k, ++id) {
+      sent[size_t(id)] = Clock::now();
+      current.macmote("bench " + to_string(scenario) + " " + to_string(id));
+    }
+    this_thread::sleep_for(chrono::milliseconds(pause));
+  }
+  r.sent = int(sent.size());
+  server.waitFor(sent.size(), IdleTimeout);
+  r.connections = server.connections() - connections;
+
+  // the commands of the previous scenarios that arrive late are ignored
+  vector<double> latencies;
+  Clock::time_point last = sent.front();
+  int previous = -1;
+  for (auto& c : server.commands()) {
+    int sc = -1, id = -1;
+    if (sscanf(c.line.c_str(), ">bench %d %d", &sc, &id) != 2 || sc != scenario
+        || id < 0 || id >= r.sent)
+      continue;
+    if (id <= previous) r.inOrder = false;
+    previous = id;
+    latencies.push_back(ms(c.time - sent[size_t(id)]));
+    last = max(last, c.time);
+  }
+
+  r.received = int(latencies.size());
+  if (r.received > 0) {
+    sort(latencies.begin(), latencies.end());
+    r.p50 = latencies[latencies.size() / 2];
+    r.p99 = latencies[min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    r.max = latencies.back();
+    double elapsed = ms(last - sent.front());
+    r.rate = elapsed > 0 ? r.received * 1000. / elapsed : 0;
+  }
+  return r;
+}
+
+int main(int argc, char* argv[]) {
+  int bursts = 20, burst = 32, pause = 20;
+  for (int k = 1; k < argc; k += 2) {
+    if (k+1 < argc && !strcmp(argv[k], "-bursts")) bursts = max(1, atoi(argv[k+1]));
+    else if (k+1 < argc && !strcmp(argv[k], "-burst")) burst = max(1, atoi(argv[k+1]));
+    else if (k+1 < argc && !strcmp(argv[k], "-pause")) pause = max(0, atoi(argv[k+1]));
+    else {
+      cerr << "Usage: macmotebench [-bursts count] [-burst commands] [-pause ms]" << endl;
+      return 2;
+    }
+  }
+
+  MockMacMote server;
+  int port = server.start();
+  if (port < 0) {
+    cerr << "Can't start the server" << endl;
+    return 1;
+  }
+  Conf::instance.mediaHost = "127.0.0.1:" + to_string(port);
+
+  CurrentAction current;
+  current.connect();   // sends "getstatus"
+  if (server.waitFor(1, 3000) == 0) {
+    cerr << "Can't connect to the server" << endl;
+    return 1;
+  }
+
+  // the last one, so that the others are not disturbed by reconnections
+  vector<Scenario> scenarios = {
+    {"clean", {}},
+    {"latency_1ms", {1, 0, 0, 0}},
+    {"slow_reads", {0, 0, 16, 1}},
+    {"disconnects", {0, 100, 0, 0}},
+  };
+  vector<Result> results;
+  for (size_t k = 0; k < scenarios.size(); ++k) {
+    results.push_back(run(current, server, int(k), scenarios[k], bursts, burst, pause));
+  }
+
+  printf("scenario,sent,received,in_order,commands_per_second,p50_ms,p99_ms,max_ms,connections\n");
+  for (auto& r : results) {
+    printf("%s,%d,%d,%s,%.0f,%.2f,%.2f,%.2f,%d\n", r.name, r.sent, r.received,
+           r.inOrder ? "yes" : "no", r.rate, r.p50, r.p99, r.max, r.connections);
+  }
+  return 0;
+}
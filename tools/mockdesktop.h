@@ -0,0 +1,31 @@
+//
+//  mockdesktop.h: state of the desktop returned by the headless services
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Lets programs that are linked with headless.cpp (e.g. on Linux) simulate the
+// frontmost app, the Finder selection and the browser page, and count the queries
+// of the services, e.g. to check DesktopState.
+
+#ifndef MarkPad_MockDesktop
+#define MarkPad_MockDesktop
+
+#include <string>
+
+struct MockDesktop {
+  /// changes the frontmost app, calls the callback of Services::setFrontAppCallback()
+  /// if _notify_ is true (as when an app is activated).
+  static void setFrontApp(const std::string& name, const std::string& path, bool notify = true);
+  static void setFinderFile(const std::string& path);
+  static void setBrowserPage(const std::string& url, const std::string& title);
+
+  /// number of times the services queried the frontmost app, the Finder or the browser.
+  static int frontAppQueries();
+  static int finderQueries();
+  static int browserQueries();
+};
+
+#endif
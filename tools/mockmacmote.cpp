@@ -0,0 +1,143 @@
+//
+//  mockmacmote.cpp: local stand-in for the MacMote media server
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+
+#include <algorithm>
+#include <poll.h>
+#include "mockmacmote.h"
+using namespace std;
+
+static const int StopPoll = 50;   // ms, how often the server checks whether it must stop
+
+static void sleepFor(int ms) {
+  if (ms > 0) this_thread::sleep_for(chrono::milliseconds(ms));
+}
+
+// waits until _fd_ is readable, false if the timeout expired
+static bool readable(int fd, int timeout) {
+  struct pollfd p = {fd, POLLIN, 0};
+  return ::poll(&p, 1, timeout) > 0;
+}
+
+MockMacMote::MockMacMote() {}
+
+MockMacMote::~MockMacMote() {
+  stop();
+}
+
+int MockMacMote::start(int port) {
+  server_.setReuseAddress(true);
+  if (server_.bind("127.0.0.1", port) < 0) return -1;
+  thread_ = thread(&MockMacMote::run, this);
+  return server_.getLocalPort();
+}
+
+void MockMacMote::stop() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  if (thread_.joinable()) thread_.join();
+  server_.close();
+}
+
+bool MockMacMote::stopped() const {
+  lock_guard<mutex> lock(mutex_);
+  return stopped_;
+}
+
+void MockMacMote::setFaults(const Faults& faults) {
+  lock_guard<mutex> lock(mutex_);
+  faults_ = faults;
+}
+
+vector<MockMacMote::Command> MockMacMote::commands() const {
+  lock_guard<mutex> lock(mutex_);
+  return commands_;
+}
+
+size_t MockMacMote::count() const {
+  lock_guard<mutex> lock(mutex_);
+  return commands_.size();
+}
+
+int MockMacMote::connections() const {
+  lock_guard<mutex> lock(mutex_);
+  return connections_;
+}
+
+void MockMacMote::clear() {
+  lock_guard<mutex> lock(mutex_);
+  commands_.clear();
+}
+
+size_t MockMacMote::waitFor(size_t count, int timeout) const {
+  unique_lock<mutex> lock(mutex_);
+  while (commands_.size() < count) {
+    size_t before = commands_.size();
+    if (!received_.wait_for(lock, chrono::milliseconds(timeout),
+                            [&] {return commands_.size() != before;}))
+      break;   // nothing received in time
+  }
+  return commands_.size();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// one connection at a time, as the media server
+void MockMacMote::run() {
+  while (!stopped()) {
+    if (!readable(server_.descriptor(), StopPoll)) continue;
+    ccuty::Socket* sock = server_.accept();
+    if (!sock) continue;
+    {
+      lock_guard<mutex> lock(mutex_);
+      connections_++;
+    }
+    serve(*sock);
+    delete sock;   // closes the connection
+  }
+}
+
+void MockMacMote::serve(ccuty::Socket& sock) {
+  string input;
+  int lines = 0;
+  char buf[4096];
+
+  while (!stopped()) {
+    if (!readable(sock.descriptor(), StopPoll)) continue;
+    Faults faults;
+    int connection;
+    {
+      lock_guard<mutex> lock(mutex_);
+      faults = faults_;
+      connection = connections_;
+    }
+    size_t size = faults.readSize > 0 ? min(sizeof(buf), size_t(faults.readSize)) : sizeof(buf);
+    ssize_t received = sock.receive(buf, size);
+    if (received <= 0) return;    // closed by the client
+    input.append(buf, size_t(received));
+
+    size_t pos;
+    while ((pos = input.find('\n')) != string::npos) {
+      string line = input.substr(0, pos);
+      input.erase(0, pos + 1);
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      sleepFor(faults.latency);
+      {
+        lock_guard<mutex> lock(mutex_);
+        commands_.push_back({line, Clock::now(), connection});
+      }
+      received_.notify_all();
+      if (faults.disconnectAfter > 0 && ++lines >= faults.disconnectAfter) {
+        return;   // the lines that were not handled are lost, as with a real server
+      }
+    }
+    sleepFor(faults.readDelay);
+  }
+}
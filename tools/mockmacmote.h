@@ -0,0 +1,87 @@
+//
+//  mockmacmote.h: local stand-in for the MacMote media server
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Listens on the loopback interface and speaks the protocol of the media server
+// (one command per line, preceded by '>', see CurrentAction::macmote()), so that
+// the connection to the media server can be tested and tuned without a MacMote
+// box (see macmotebench.cpp). Faults can be injected to see how the client behaves.
+
+#ifndef MarkPad_MockMacMote
+#define MarkPad_MockMacMote
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ccsocket.hpp"
+
+class MockMacMote {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// a line received by the server (without separator).
+  struct Command {
+    std::string line;
+    Clock::time_point time;   // when it was handled (after Faults::latency)
+    int connection;           // number of the connection, starting from 1
+  };
+
+  struct Faults {
+    int latency{0};           ///< ms waited before handling each line (a busy server).
+    int disconnectAfter{0};   ///< closes the connection after this number of lines (0: never).
+    int readSize{0};          ///< bytes read at once (0: as many as available).
+    int readDelay{0};         ///< ms waited after each read (with readSize: a slow reader).
+  };
+
+  MockMacMote();
+  ~MockMacMote();
+
+  /// starts the server on 127.0.0.1, returns the port (chosen by the system if 0)
+  /// or a negative value on error.
+  int start(int port = 0);
+
+  /// closes the connection and stops the server.
+  void stop();
+
+  /// the faults apply to the lines that are received afterwards.
+  void setFaults(const Faults&);
+
+  /// the lines received so far.
+  std::vector<Command> commands() const;
+  size_t count() const;
+
+  /// number of connections accepted so far.
+  int connections() const;
+
+  /// forgets the lines received so far.
+  void clear();
+
+  /// waits until at least _count_ lines were received, or until no line was received
+  /// for _timeout_ milliseconds, returns the number of lines received.
+  size_t waitFor(size_t count, int timeout) const;
+
+private:
+  MockMacMote(const MockMacMote&) = delete;
+  MockMacMote& operator=(const MockMacMote&) = delete;
+  void run();
+  void serve(ccuty::Socket&);
+  bool stopped() const;
+
+  ccuty::ServerSocket server_;
+  std::thread thread_;
+  Faults faults_;
+  bool stopped_{false};
+  int connections_{0};
+  std::vector<Command> commands_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable received_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+//
+//  spawnbench.cpp: measures how many programs per second can be started
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Starts a program (/bin/true by default) _n_ times with system() (as the actions
+// used to do), with ccuty::Launcher and posix_spawn(), and with the pre-forked
+// helper of ccuty::Launcher. At most 32 programs run at the same time.
+// -mem allocates (and touches) memory before starting, so that the benchmark
+// process is about as big as MarkPad with a large configuration.
+//
+// Build from the MarkPad directory:
+//   c++ -std=c++14 -O2 -Iccuty -o spawnbench tools/spawnbench.cpp ccuty/cclauncher.cpp -lpthread
+//
+// Usage: spawnbench [-n count] [-mem megabytes] [program args...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cclauncher.hpp"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static const size_t MaxRunning = 32;
+
+static double rate(int n, Clock::time_point start) {
+  return n / chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double benchSystem(const string& command, int n) {
+  auto start = Clock::now();
+  for (int k = 0; k < n; ++k) {
+    if (system(command.c_str()) != 0) {cerr << "Failed: " << command << endl; exit(1);}
+  }
+  return rate(n, start);
+}
+
+static double benchLauncher(ccuty::Launcher& launcher, const vector<string>& argv, int n) {
+  atomic<int> done{0}, failed{0};
+  auto start = Clock::now();
+  for (int k = 0; k < n; ++k) {
+    while (launcher.running() >= MaxRunning) this_thread::sleep_for(chrono::microseconds(50));
+    if (!launcher.spawn(argv, [&](int status) {if (status != 0) failed++; done++;})) {
+      cerr << "Can't start: " << argv[0] << endl;
+      exit(1);
+    }
+  }
+  while (done < n) this_thread::sleep_for(chrono::microseconds(50));
+  if (failed) cerr << failed << " programs failed" << endl;
+  return rate(n, start);
+}
+
+int main(int argc, char* argv[]) {
+  int n = 1000, k = 1;
+  size_t mem = 0;
+  for (; k+1 < argc && argv[k][0] == '-'; k += 2) {
+    if (!strcmp(argv[k], "-n")) n = max(1, atoi(argv[k+1]));
+    else if (!strcmp(argv[k], "-mem")) mem = size_t(atol(argv[k+1])) << 20;
+    else {
+      cerr << "Usage: spawnbench [-n count] [-mem megabytes] [program args...]" << endl;
+      return 2;
+    }
+  }
+  vector<string> args(argv + k, argv + argc);
+  if (args.empty()) args.push_back("/bin/true");
+  string command;
+  for (auto& a : args) command += "'" + a + "' ";
+
+  // the helper is forked first, when the process is small and has a single thread
+  ccuty::Launcher helper(true), direct(false);
+  if (!helper.hasHelper()) cerr << "Can't start the helper" << endl;
+
+  vector<char> memory(mem, 1);
+  for (size_t i = 0; i < memory.size(); i += 4096) memory[i] = char(i);
+
+  printf("method,spawns_per_second\n");
+  printf("system,%.0f\n", benchSystem(command, n));
+  printf("posix_spawn,%.0f\n", benchLauncher(direct, args, n));
+  if (helper.hasHelper()) printf("helper,%.0f\n", benchLauncher(helper, args, n));
+  return 0;
+}
@@ -0,0 +1,66 @@
+//
+//  trajexport.cpp: exports the trajectories recorded by DataLogger as CSV
+//  MarkPad Project
+//
+//  (c) Eric Lecolinet - http://www.telecom-paris.fr/~elc
+//  (c) Bruno Fruchard - http://brunofruchard.com/
+//  Copyright (c) 2017/2020. All rights reserved.
+//
+// Prints one line per frame: the gesture number and date (as in gestures_log.csv),
+// the timestamp of the frame, the normalized position and velocity, and the size
+// of the touch (see Trajectory.h for the binary format).
+//
+// Build from the MarkPad directory:
+//   c++ -std=c++14 -O2 -Icore -o trajexport tools/trajexport.cpp core/Trajectory.cpp
+//
+// Usage: trajexport [trajectories.bin] > trajectories.csv
+// (the file is read from the standard input if not given).
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Trajectory.h"
+using namespace std;
+
+int main(int argc, char* argv[]) {
+  stringstream content;
+  if (argc > 1) {
+    ifstream in(argv[1], ios::binary);
+    if (!in) {cerr << "Can't read: " << argv[1] << endl; return 1;}
+    content << in.rdbuf();
+  }
+  else content << cin.rdbuf();
+  string data = content.str();
+
+  const char* p = data.data();
+  const char* end = p + data.size();
+  if (data.size() < sizeof(TrajectoryFile::Magic)
+      || ::memcmp(p, TrajectoryFile::Magic, sizeof(TrajectoryFile::Magic)) != 0) {
+    cerr << "Not a trajectory file" << endl;
+    return 1;
+  }
+  p += sizeof(TrajectoryFile::Magic);
+
+  printf("gesture,day,hour,time,x,y,vx,vy,size\n");
+  TrajectoryFile::Gesture g;
+  char day[32], hour[32];
+  while (p < end) {
+    if (!TrajectoryFile::decode(p, end, g)) {
+      cerr << "Truncated or invalid data after gesture " << g.num << endl;
+      return 1;
+    }
+    struct tm t;
+    ::localtime_r(&g.date, &t);
+    strftime(day, sizeof(day), "%Y-%m-%d", &t);
+    strftime(hour, sizeof(hour), "%H:%M:%S", &t);
+    for (auto& s : g.samples) {
+      printf("%lu,%s,%s,%.6f,%.5f,%.5f,%.4f,%.4f,%.5f\n", g.num, day, hour, s.time,
+             s.norm.pos.x, s.norm.pos.y, s.norm.velocity.x, s.norm.velocity.y, s.size);
+    }
+  }
+  return 0;
+}